@@ -0,0 +1,54 @@
+#!/usr/bin/env python
+
+# Copyright 2026-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Run the SCRAM authentication benchmarks against a local mongod --auth.
+
+The mongod starts with no users, so the auth suite creates its own user
+administrator through the localhost exception."""
+
+import argparse
+
+from mongod_launcher import Mongod, run_benchmarks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('test_dir', help='path to performance-testdata')
+    parser.add_argument('--binary', default='./mongo-c-performance',
+                        help='path to mongo-c-performance')
+    parser.add_argument('--mongod', default='mongod',
+                        help='path to mongod')
+    parser.add_argument('--port', type=int, default=27100)
+    parser.add_argument('--output', default='auth-results',
+                        help='directory for results.json')
+    parser.add_argument('--quick', action='store_true')
+    args = parser.parse_args()
+
+    extra_args = ['--quick'] if args.quick else []
+    mongod = Mongod(args.mongod, args.port, ['--auth'])
+    try:
+        run_benchmarks(args.binary,
+                       args.test_dir,
+                       'mongodb://%s/' % mongod.host,
+                       ['auth'],
+                       args.output,
+                       extra_args)
+    finally:
+        mongod.stop()
+
+
+if __name__ == '__main__':
+    main()
@@ -20,20 +20,30 @@ import argparse
 import json
 
 
+def ops_per_sec(result):
+    for metric in result['metrics']:
+        if metric['name'] == 'ops_per_sec':
+            return metric['value']
+
+
 def compare(files):
     data = {}
-    jsons = [json.load(f)['results'] for f in files]
+    jsons = [json.load(f) for f in files]
     for j in jsons:
         for result in j:
-            data[result['name']] = []
+            data[result['info']['test_name']] = []
 
+    # only compare tests that every run has results for
     for j in jsons:
         for name in data:
             for result in j:
-                if result['name'] == name:
-                    data[name].append(result['results']['1']['ops_per_sec'])
+                if result['info']['test_name'] == name:
+                    data[name].append(ops_per_sec(result))
                     break
 
+    data = dict((name, values) for name, values in data.items()
+                if len(values) == len(jsons))
+
     col_width = 2 + max(len(name) for name in data)
     file_width = 2 + max(len(f.name) for f in files)
     print(" " * file_width + "".join(name.ljust(col_width) for name in data))
@@ -0,0 +1,126 @@
+# Copyright 2026-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Start and stop throwaway local mongod processes for benchmark modes."""
+
+import json
+import os
+import shutil
+import socket
+import subprocess
+import tempfile
+import time
+from os.path import join
+
+
+class Mongod(object):
+    """A mongod on localhost with its own temporary dbpath."""
+
+    def __init__(self, mongod, port, extra_args=()):
+        self.port = port
+        self.dbpath = tempfile.mkdtemp(prefix='mongo-c-performance-')
+        self.logpath = join(self.dbpath, 'mongod.log')
+        args = [mongod,
+                '--port', str(port),
+                '--bind_ip', 'localhost',
+                '--dbpath', self.dbpath,
+                '--logpath', self.logpath]
+        args.extend(extra_args)
+        print('Starting %s' % ' '.join(args))
+        self.proc = subprocess.Popen(args)
+        wait_for_port(port, self.proc, self.logpath)
+
+    @property
+    def host(self):
+        return 'localhost:%d' % self.port
+
+    def stop(self):
+        if self.proc.poll() is None:
+            self.proc.terminate()
+            self.proc.wait()
+
+        shutil.rmtree(self.dbpath, ignore_errors=True)
+
+
+class ReplicaSet(object):
+    """Local mongods on consecutive ports, initiated as a replica set.
+
+    Each member gets a "dc" tag from dc_tags. Initiating needs mongosh."""
+
+    def __init__(self, mongod, mongosh, port, name='perf',
+                 dc_tags=('east', 'east', 'west')):
+        self.name = name
+        self.members = []
+        try:
+            for i in range(len(dc_tags)):
+                self.members.append(
+                    Mongod(mongod, port + i, ['--replSet', name]))
+
+            config = {
+                '_id': name,
+                'members': [{'_id': i, 'host': m.host, 'tags': {'dc': dc}}
+                            for i, (m, dc) in enumerate(zip(self.members,
+                                                            dc_tags))],
+            }
+
+            script = ('rs.initiate(%s);'
+                      'while (!db.hello().isWritablePrimary) { sleep(100); }'
+                      % json.dumps(config))
+            subprocess.check_call([mongosh, '--quiet', '--port', str(port),
+                                   '--eval', script])
+        except Exception:
+            self.stop()
+            raise
+
+    @property
+    def uri(self):
+        return 'mongodb://%s/?replicaSet=%s' % (
+            ','.join(m.host for m in self.members), self.name)
+
+    def stop(self):
+        for member in self.members:
+            member.stop()
+
+
+def wait_for_port(port, proc, logpath, timeout=60):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if proc.poll() is not None:
+            raise Exception('mongod exited with %d, see %s'
+                            % (proc.returncode, logpath))
+
+        try:
+            socket.create_connection(('localhost', port), 1).close()
+            return
+        except socket.error:
+            time.sleep(0.1)
+
+    raise Exception('mongod did not listen on port %d, see %s'
+                    % (port, logpath))
+
+
+def run_benchmarks(binary, test_dir, uri, suites, output_dir, extra_args=()):
+    """Run mongo-c-performance, leaving results.json in output_dir."""
+    if not os.path.isdir(output_dir):
+        os.makedirs(output_dir)
+
+    args = [os.path.realpath(binary), '--uri', uri]
+    args.extend(extra_args)
+    for suite in suites:
+        args.extend(['--suite', suite])
+
+    args.append(os.path.realpath(test_dir))
+    print('Running %s' % ' '.join(args))
+    subprocess.check_call(args, cwd=output_dir)
+    return join(output_dir, 'results.json')
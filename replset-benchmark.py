@@ -0,0 +1,58 @@
+#!/usr/bin/env python
+
+# Copyright 2026-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Run the read preference benchmarks against a local replica set.
+
+Starts three mongods tagged dc:east, dc:east and dc:west on consecutive
+ports, initiates them as a replica set with mongosh, and runs the replset
+suite against it."""
+
+import argparse
+
+from mongod_launcher import ReplicaSet, run_benchmarks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('test_dir', help='path to performance-testdata')
+    parser.add_argument('--binary', default='./mongo-c-performance',
+                        help='path to mongo-c-performance')
+    parser.add_argument('--mongod', default='mongod',
+                        help='path to mongod')
+    parser.add_argument('--mongosh', default='mongosh',
+                        help='path to mongosh')
+    parser.add_argument('--port', type=int, default=27100,
+                        help='first member\'s port, the others use the next')
+    parser.add_argument('--output', default='replset-results',
+                        help='directory for results.json')
+    parser.add_argument('--quick', action='store_true')
+    args = parser.parse_args()
+
+    extra_args = ['--quick'] if args.quick else []
+    replica_set = ReplicaSet(args.mongod, args.mongosh, args.port)
+    try:
+        run_benchmarks(args.binary,
+                       args.test_dir,
+                       replica_set.uri,
+                       ['replset'],
+                       args.output,
+                       extra_args)
+    finally:
+        replica_set.stop()
+
+
+if __name__ == '__main__':
+    main()
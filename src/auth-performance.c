@@ -0,0 +1,517 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests the cost of SCRAM authentication when connecting to a mongod started
+ * with --auth. The suite creates its own users; the --uri must either have
+ * credentials for a user administrator, or point at a mongod with no users
+ * yet, so the localhost exception lets the suite create its first user.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <pthread.h>
+
+
+/* the suite's user administrator, which the cache-hit tests also log in as */
+#define AUTH_USER "perf-auth"
+#define AUTH_PASSWORD "perf-auth-password"
+
+/* AUTH_CONNECTION_COUNT is the number of connections opened per iteration. */
+static const int AUTH_CONNECTION_COUNT = 20;
+
+/* AUTH_POOL_THREADS is the number of threads that warm a pool. */
+static const int AUTH_POOL_THREADS = 100;
+
+/* makes each cache-miss user name unique */
+static int64_t g_auth_user_counter;
+
+static mongoc_uri_t *
+_auth_uri_new (const char *user, const char *mechanism)
+{
+   mongoc_uri_t *uri;
+
+   uri = perf_uri_new ();
+   if (!mongoc_uri_set_username (uri, user) ||
+       !mongoc_uri_set_password (uri, AUTH_PASSWORD) ||
+       !mongoc_uri_set_auth_source (uri, "admin") ||
+       !mongoc_uri_set_auth_mechanism (uri, mechanism)) {
+      MONGOC_ERROR ("could not set credentials for %s\n", user);
+      abort ();
+   }
+
+   return uri;
+}
+
+static mongoc_client_t *
+_auth_admin_client_new (void)
+{
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+
+   uri = _auth_uri_new (AUTH_USER, "SCRAM-SHA-256");
+   client = mongoc_client_new_from_uri (uri);
+   mongoc_uri_destroy (uri);
+
+   return client;
+}
+
+
+/* mechanism NULL means both SCRAM-SHA-1 and SCRAM-SHA-256 */
+static bool
+_auth_create_user (mongoc_client_t *client,
+                   const char *user,
+                   const char *role,
+                   const char *mechanism,
+                   bson_error_t *error)
+{
+   bson_t cmd;
+   bson_t roles;
+   bson_t mechanisms;
+   bool r;
+
+   bson_init (&cmd);
+   BSON_APPEND_UTF8 (&cmd, "createUser", user);
+   BSON_APPEND_UTF8 (&cmd, "pwd", AUTH_PASSWORD);
+   BSON_APPEND_ARRAY_BEGIN (&cmd, "roles", &roles);
+   if (role) {
+      BCON_APPEND (&roles,
+                   "0",
+                   "{",
+                   "role",
+                   BCON_UTF8 (role),
+                   "db",
+                   BCON_UTF8 ("admin"),
+                   "}");
+   }
+
+   bson_append_array_end (&cmd, &roles);
+   BSON_APPEND_ARRAY_BEGIN (&cmd, "mechanisms", &mechanisms);
+   if (mechanism) {
+      BSON_APPEND_UTF8 (&mechanisms, "0", mechanism);
+   } else {
+      BSON_APPEND_UTF8 (&mechanisms, "0", "SCRAM-SHA-1");
+      BSON_APPEND_UTF8 (&mechanisms, "1", "SCRAM-SHA-256");
+   }
+
+   bson_append_array_end (&cmd, &mechanisms);
+
+   r = mongoc_client_command_simple (
+      client, "admin", &cmd, NULL /* read prefs */, NULL /* reply */, error);
+
+   bson_destroy (&cmd);
+
+   return r;
+}
+
+static void
+_auth_drop_user (mongoc_client_t *client, const char *user)
+{
+   bson_t *cmd;
+
+   /* ignore errors, e.g. the user doesn't exist */
+   cmd = BCON_NEW ("dropUser", BCON_UTF8 (user));
+   mongoc_client_command_simple (
+      client, "admin", cmd, NULL /* read prefs */, NULL /* reply */, NULL);
+   bson_destroy (cmd);
+}
+
+static void
+_auth_ping (mongoc_client_t *client)
+{
+   bson_t *ping;
+   bson_error_t error;
+
+   ping = BCON_NEW ("ping", BCON_INT32 (1));
+   if (!mongoc_client_command_simple (client,
+                                      "admin",
+                                      ping,
+                                      NULL /* read prefs */,
+                                      NULL /* reply */,
+                                      &error)) {
+      MONGOC_ERROR ("ping: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (ping);
+}
+
+
+/* create the suite's user administrator with the --uri's credentials, or
+ * with the localhost exception if the server has no users yet */
+static void
+auth_users_setup (void)
+{
+   mongoc_client_t *client;
+   bson_error_t error;
+
+   client = perf_client_new ();
+   _auth_drop_user (client, AUTH_USER);
+   if (!_auth_create_user (client, AUTH_USER, "root", NULL, &error)) {
+      MONGOC_ERROR ("createUser: %s\n"
+                    "the auth suite needs a mongod started with --auth and"
+                    " either no users or a --uri with admin credentials\n",
+                    error.message);
+      abort ();
+   }
+
+   mongoc_client_destroy (client);
+}
+
+static void
+auth_users_teardown (void)
+{
+   mongoc_client_t *client;
+
+   /* leave a server with no users to the next run's localhost exception */
+   client = _auth_admin_client_new ();
+   _auth_drop_user (client, AUTH_USER);
+   mongoc_client_destroy (client);
+}
+
+
+/*
+ *  -------- AUTH HANDSHAKE BENCHMARKS ----------------------------------------
+ */
+
+/* libmongoc caches the SCRAM keys it derives from a password, salt and
+ * iteration count with PBKDF2. "Cache:Hit" connects as the same user again
+ * and again, "Cache:Miss" connects as users created in "before", whose new
+ * salts the cache has not seen. */
+
+typedef struct {
+   perf_test_t base;
+   const char *mechanism;
+   bool cache_miss;
+   mongoc_client_t *admin_client;
+   mongoc_uri_t *uri;
+   mongoc_uri_t **miss_uris;
+   char **miss_users;
+   perf_latencies_t latencies;
+   char name[128];
+} auth_handshake_test_t;
+
+static void
+auth_handshake_setup (perf_test_t *test)
+{
+   auth_handshake_test_t *auth_test;
+
+   perf_test_setup (test);
+
+   auth_test = (auth_handshake_test_t *) test;
+   auth_test->admin_client = _auth_admin_client_new ();
+   auth_test->uri = _auth_uri_new (AUTH_USER, auth_test->mechanism);
+   auth_test->miss_uris = (mongoc_uri_t **) bson_malloc0 (
+      AUTH_CONNECTION_COUNT * sizeof (mongoc_uri_t *));
+   auth_test->miss_users =
+      (char **) bson_malloc0 (AUTH_CONNECTION_COUNT * sizeof (char *));
+   perf_latencies_init (&auth_test->latencies);
+}
+
+static void
+auth_handshake_before (perf_test_t *test)
+{
+   auth_handshake_test_t *auth_test;
+   bson_error_t error;
+   int i;
+
+   perf_test_before (test);
+
+   auth_test = (auth_handshake_test_t *) test;
+   if (!auth_test->cache_miss) {
+      return;
+   }
+
+   for (i = 0; i < AUTH_CONNECTION_COUNT; i++) {
+      auth_test->miss_users[i] =
+         bson_strdup_printf ("perf-auth-miss-%" PRId64, g_auth_user_counter++);
+
+      if (!_auth_create_user (auth_test->admin_client,
+                              auth_test->miss_users[i],
+                              NULL /* role */,
+                              auth_test->mechanism,
+                              &error)) {
+         MONGOC_ERROR ("createUser: %s\n", error.message);
+         abort ();
+      }
+
+      auth_test->miss_uris[i] =
+         _auth_uri_new (auth_test->miss_users[i], auth_test->mechanism);
+   }
+}
+
+static void
+auth_handshake_task (perf_test_t *test)
+{
+   auth_handshake_test_t *auth_test;
+   mongoc_client_t *client;
+   int64_t start;
+   int i;
+
+   auth_test = (auth_handshake_test_t *) test;
+
+   for (i = 0; i < AUTH_CONNECTION_COUNT; i++) {
+      start = bson_get_monotonic_time ();
+      client = mongoc_client_new_from_uri (
+         auth_test->cache_miss ? auth_test->miss_uris[i] : auth_test->uri);
+
+      _auth_ping (client);
+      perf_latencies_add (&auth_test->latencies,
+                          bson_get_monotonic_time () - start);
+      mongoc_client_destroy (client);
+   }
+}
+
+static void
+auth_handshake_after (perf_test_t *test)
+{
+   auth_handshake_test_t *auth_test;
+   int i;
+
+   auth_test = (auth_handshake_test_t *) test;
+   if (auth_test->cache_miss) {
+      for (i = 0; i < AUTH_CONNECTION_COUNT; i++) {
+         _auth_drop_user (auth_test->admin_client, auth_test->miss_users[i]);
+         bson_free (auth_test->miss_users[i]);
+         mongoc_uri_destroy (auth_test->miss_uris[i]);
+         auth_test->miss_users[i] = NULL;
+         auth_test->miss_uris[i] = NULL;
+      }
+   }
+
+   perf_test_after (test);
+}
+
+static void
+auth_handshake_teardown (perf_test_t *test)
+{
+   auth_handshake_test_t *auth_test;
+
+   auth_test = (auth_handshake_test_t *) test;
+   perf_latencies_report (test, NULL, &auth_test->latencies);
+   perf_latencies_destroy (&auth_test->latencies);
+   mongoc_uri_destroy (auth_test->uri);
+   mongoc_client_destroy (auth_test->admin_client);
+   bson_free (auth_test->miss_uris);
+   bson_free (auth_test->miss_users);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+auth_handshake_perf_new (const char *mechanism, bool cache_miss)
+{
+   auth_handshake_test_t *auth_test;
+   perf_test_t *test;
+
+   auth_test =
+      (auth_handshake_test_t *) bson_malloc0 (sizeof (auth_handshake_test_t));
+   test = (perf_test_t *) auth_test;
+   auth_test->mechanism = mechanism;
+   auth_test->cache_miss = cache_miss;
+   bson_snprintf (auth_test->name,
+                  sizeof (auth_test->name),
+                  "TestAuthHandshake/Mechanism:%s/Cache:%s",
+                  mechanism,
+                  cache_miss ? "Miss" : "Hit");
+
+   /* ops_per_sec is authenticated connections per second */
+   perf_test_init (
+      test, auth_test->name, NULL /* data path */, AUTH_CONNECTION_COUNT);
+   test->setup = auth_handshake_setup;
+   test->before = auth_handshake_before;
+   test->task = auth_handshake_task;
+   test->after = auth_handshake_after;
+   test->teardown = auth_handshake_teardown;
+
+   return test;
+}
+
+
+/*
+ *  -------- AUTH POOL WARMUP BENCHMARK ---------------------------------------
+ */
+
+/* AUTH_POOL_THREADS threads each pop a client from a new pool and ping, so
+ * the pool opens and authenticates that many connections at once. */
+
+typedef struct _auth_pool_test_t auth_pool_test_t;
+
+typedef struct {
+   auth_pool_test_t *test;
+   int64_t latency;
+} auth_pool_thread_context_t;
+
+struct _auth_pool_test_t {
+   perf_test_t base;
+   const char *mechanism;
+   mongoc_uri_t *uri;
+   mongoc_client_pool_t *pool;
+   auth_pool_thread_context_t *contexts;
+   perf_workers_t workers;
+   int64_t start;
+   perf_latencies_t latencies;
+   char name[128];
+};
+
+static void
+auth_pool_setup (perf_test_t *test)
+{
+   auth_pool_test_t *auth_test;
+   int i;
+
+   perf_test_setup (test);
+
+   auth_test = (auth_pool_test_t *) test;
+   auth_test->uri = _auth_uri_new (AUTH_USER, auth_test->mechanism);
+   auth_test->contexts = (auth_pool_thread_context_t *) bson_malloc0 (
+      AUTH_POOL_THREADS * sizeof (auth_pool_thread_context_t));
+   for (i = 0; i < AUTH_POOL_THREADS; i++) {
+      auth_test->contexts[i].test = auth_test;
+   }
+
+   perf_workers_init (&auth_test->workers, AUTH_POOL_THREADS);
+   perf_latencies_init (&auth_test->latencies);
+}
+
+static void
+auth_pool_before (perf_test_t *test)
+{
+   auth_pool_test_t *auth_test;
+
+   perf_test_before (test);
+
+   auth_test = (auth_pool_test_t *) test;
+   /* the default maxPoolSize of 100 fits all the threads */
+   auth_test->pool = mongoc_client_pool_new (auth_test->uri);
+}
+
+static void *
+_auth_pool_thread (void *p)
+{
+   auth_pool_thread_context_t *ctx;
+   mongoc_client_t *client;
+
+   ctx = (auth_pool_thread_context_t *) p;
+
+   client = mongoc_client_pool_pop (ctx->test->pool);
+   _auth_ping (client);
+   ctx->latency = bson_get_monotonic_time () - ctx->test->start;
+   mongoc_client_pool_push (ctx->test->pool, client);
+
+   return NULL;
+}
+
+static void
+auth_pool_task (perf_test_t *test)
+{
+   auth_pool_test_t *auth_test;
+
+   auth_test = (auth_pool_test_t *) test;
+   auth_test->start = bson_get_monotonic_time ();
+   perf_workers_run (&auth_test->workers,
+                     _auth_pool_thread,
+                     auth_test->contexts,
+                     sizeof (auth_pool_thread_context_t));
+}
+
+static void
+auth_pool_after (perf_test_t *test)
+{
+   auth_pool_test_t *auth_test;
+   int i;
+
+   auth_test = (auth_pool_test_t *) test;
+   for (i = 0; i < AUTH_POOL_THREADS; i++) {
+      perf_latencies_add (&auth_test->latencies,
+                          auth_test->contexts[i].latency);
+   }
+
+   mongoc_client_pool_destroy (auth_test->pool);
+   auth_test->pool = NULL;
+
+   perf_test_after (test);
+}
+
+static void
+auth_pool_teardown (perf_test_t *test)
+{
+   auth_pool_test_t *auth_test;
+
+   auth_test = (auth_pool_test_t *) test;
+   perf_workers_destroy (&auth_test->workers);
+   perf_latencies_report (test, NULL, &auth_test->latencies);
+   perf_latencies_destroy (&auth_test->latencies);
+   mongoc_uri_destroy (auth_test->uri);
+   bson_free (auth_test->contexts);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+auth_pool_perf_new (const char *mechanism)
+{
+   auth_pool_test_t *auth_test;
+   perf_test_t *test;
+
+   auth_test = (auth_pool_test_t *) bson_malloc0 (sizeof (auth_pool_test_t));
+   test = (perf_test_t *) auth_test;
+   auth_test->mechanism = mechanism;
+   bson_snprintf (auth_test->name,
+                  sizeof (auth_test->name),
+                  "TestAuthPoolWarm/Mechanism:%s/Threads:%d",
+                  mechanism,
+                  AUTH_POOL_THREADS);
+
+   /* ops_per_sec is authenticated connections per second */
+   perf_test_init (
+      test, auth_test->name, NULL /* data path */, AUTH_POOL_THREADS);
+   test->setup = auth_pool_setup;
+   test->before = auth_pool_before;
+   test->task = auth_pool_task;
+   test->after = auth_pool_after;
+   test->teardown = auth_pool_teardown;
+
+   return test;
+}
+
+
+void
+auth_perf (void)
+{
+   const char *mechanisms[] = {"SCRAM-SHA-1", "SCRAM-SHA-256"};
+   perf_test_t *tests[2 * 3 + 1];
+   size_t n;
+   size_t i;
+
+   auth_users_setup ();
+
+   n = 0;
+   for (i = 0; i < sizeof (mechanisms) / sizeof (mechanisms[0]); i++) {
+      tests[n++] = auth_handshake_perf_new (mechanisms[i], false);
+      tests[n++] = auth_handshake_perf_new (mechanisms[i], true);
+      tests[n++] = auth_pool_perf_new (mechanisms[i]);
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+
+   auth_users_teardown ();
+}
@@ -0,0 +1,450 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests the cost of establishing connections: the TCP connect, the MongoDB
+ * handshake, plus TLS and authentication when the URI enables them.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <pthread.h>
+
+
+/*
+ *  -------- CONNECTION HANDSHAKE BENCHMARK -----------------------------------
+ */
+
+/* CONNECTION_COUNT is the number of connections opened per iteration. */
+static const int CONNECTION_COUNT = 100;
+
+typedef struct {
+   perf_test_t base;
+   mongoc_uri_t *uri;
+   bson_t ping;
+   perf_latencies_t latencies;
+} handshake_test_t;
+
+
+static void
+_ping (mongoc_client_t *client, const bson_t *ping)
+{
+   bson_error_t error;
+
+   if (!mongoc_client_command_simple (client,
+                                      "admin",
+                                      ping,
+                                      NULL /* read prefs */,
+                                      NULL /* reply */,
+                                      &error)) {
+      MONGOC_ERROR ("ping: %s\n", error.message);
+      abort ();
+   }
+}
+
+static void
+handshake_setup (perf_test_t *test)
+{
+   handshake_test_t *handshake_test;
+
+   perf_test_setup (test);
+
+   handshake_test = (handshake_test_t *) test;
+   handshake_test->uri = perf_uri_new ();
+   bson_init (&handshake_test->ping);
+   BSON_APPEND_INT32 (&handshake_test->ping, "ping", 1);
+   perf_latencies_init (&handshake_test->latencies);
+}
+
+static void
+handshake_task (perf_test_t *test)
+{
+   handshake_test_t *handshake_test;
+   mongoc_client_t *client;
+   bson_error_t error;
+   int64_t start;
+   int i;
+
+   handshake_test = (handshake_test_t *) test;
+
+   /* a single-threaded client connects on its first command, and uses the
+    * connection it handshook on to run the command. the latencies are the
+    * time to first operation of mongoc_client_new. */
+   for (i = 0; i < CONNECTION_COUNT; i++) {
+      start = bson_get_monotonic_time ();
+      client = mongoc_client_new_from_uri_with_error (handshake_test->uri,
+                                                      &error);
+      if (!client) {
+         MONGOC_ERROR ("client_new: %s\n", error.message);
+         abort ();
+      }
+
+      _ping (client, &handshake_test->ping);
+      perf_latencies_add (&handshake_test->latencies,
+                          bson_get_monotonic_time () - start);
+      mongoc_client_destroy (client);
+   }
+}
+
+static void
+handshake_teardown (perf_test_t *test)
+{
+   handshake_test_t *handshake_test;
+
+   handshake_test = (handshake_test_t *) test;
+   perf_latencies_report (test, NULL, &handshake_test->latencies);
+   perf_latencies_destroy (&handshake_test->latencies);
+   mongoc_uri_destroy (handshake_test->uri);
+   bson_destroy (&handshake_test->ping);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+handshake_perf_new (void)
+{
+   handshake_test_t *handshake_test;
+   perf_test_t *test;
+
+   handshake_test =
+      (handshake_test_t *) bson_malloc0 (sizeof (handshake_test_t));
+   test = (perf_test_t *) handshake_test;
+
+   /* ops_per_sec is connections per second */
+   perf_test_init (
+      test, "TestConnectionHandshake", NULL /* data path */, CONNECTION_COUNT);
+   test->setup = handshake_setup;
+   test->task = handshake_task;
+   test->teardown = handshake_teardown;
+
+   return test;
+}
+
+
+/*
+ *  -------- POOL COLD-START BENCHMARKS ---------------------------------------
+ */
+
+/* TestColdStart/Pool: mongoc_client_pool_new, the first pop and a ping.
+ * TestColdStart/PoolWarm: a new pool, then pop and ping N clients in turn,
+ * like the parallel-client setup does. libmongoc does not open connections
+ * ahead of time for minPoolSize, so this is the cost of pre-warming by hand.
+ * TestColdStart/PoolBurst: N threads released together pop from a new pool
+ * and run a ping. Latencies are the time to first operation. */
+
+typedef enum {
+   COLD_START_POOL,
+   COLD_START_POOL_WARM,
+   COLD_START_POOL_BURST,
+} cold_start_mode_t;
+
+/* POOL_COLD_START_COUNT is the number of pools created per iteration of
+ * TestColdStart/Pool */
+static const int POOL_COLD_START_COUNT = 10;
+
+typedef struct _cold_start_test_t cold_start_test_t;
+
+typedef struct {
+   pthread_t thread;
+   cold_start_test_t *test;
+   int64_t latency;
+} cold_start_thread_context_t;
+
+struct _cold_start_test_t {
+   perf_test_t base;
+   cold_start_mode_t mode;
+   int n;
+   mongoc_uri_t *uri;
+   bson_t ping;
+   perf_latencies_t latencies;
+   char name[64];
+   /* the burst's pool, and the gate its threads wait on */
+   mongoc_client_pool_t *pool;
+   cold_start_thread_context_t *contexts;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   bool released;
+   int64_t release_time;
+};
+
+static void
+cold_start_setup (perf_test_t *test)
+{
+   cold_start_test_t *cold_start_test;
+
+   perf_test_setup (test);
+
+   cold_start_test = (cold_start_test_t *) test;
+   cold_start_test->uri = perf_uri_new ();
+   bson_init (&cold_start_test->ping);
+   BSON_APPEND_INT32 (&cold_start_test->ping, "ping", 1);
+   perf_latencies_init (&cold_start_test->latencies);
+   cold_start_test->contexts = (cold_start_thread_context_t *) bson_malloc0 (
+      cold_start_test->n * sizeof (cold_start_thread_context_t));
+   pthread_mutex_init (&cold_start_test->mutex, NULL);
+   pthread_cond_init (&cold_start_test->cond, NULL);
+}
+
+static void *
+_cold_start_burst_thread (void *p)
+{
+   cold_start_thread_context_t *ctx;
+   cold_start_test_t *test;
+   mongoc_client_t *client;
+
+   ctx = (cold_start_thread_context_t *) p;
+   test = ctx->test;
+
+   pthread_mutex_lock (&test->mutex);
+   while (!test->released) {
+      pthread_cond_wait (&test->cond, &test->mutex);
+   }
+   pthread_mutex_unlock (&test->mutex);
+
+   client = mongoc_client_pool_pop (test->pool);
+   _ping (client, &test->ping);
+   ctx->latency = bson_get_monotonic_time () - test->release_time;
+   mongoc_client_pool_push (test->pool, client);
+
+   return NULL;
+}
+
+static void
+cold_start_before (perf_test_t *test)
+{
+   cold_start_test_t *cold_start_test;
+   cold_start_thread_context_t *ctx;
+   int i;
+   int ret;
+
+   perf_test_before (test);
+
+   cold_start_test = (cold_start_test_t *) test;
+   if (cold_start_test->mode != COLD_START_POOL_BURST) {
+      return;
+   }
+
+   /* start the threads outside the timed task, parked until released */
+   cold_start_test->pool = mongoc_client_pool_new (cold_start_test->uri);
+   cold_start_test->released = false;
+
+   for (i = 0; i < cold_start_test->n; i++) {
+      ctx = &cold_start_test->contexts[i];
+      ctx->test = cold_start_test;
+      ret = pthread_create (
+         &ctx->thread, NULL /* attr */, _cold_start_burst_thread, ctx);
+      if (ret != 0) {
+         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
+         abort ();
+      }
+   }
+}
+
+static void
+_cold_start_pool_task (cold_start_test_t *cold_start_test)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t *client;
+   int64_t start;
+   int i;
+
+   for (i = 0; i < POOL_COLD_START_COUNT; i++) {
+      start = bson_get_monotonic_time ();
+      pool = mongoc_client_pool_new (cold_start_test->uri);
+      client = mongoc_client_pool_pop (pool);
+      _ping (client, &cold_start_test->ping);
+      perf_latencies_add (&cold_start_test->latencies,
+                          bson_get_monotonic_time () - start);
+      mongoc_client_pool_push (pool, client);
+      mongoc_client_pool_destroy (pool);
+   }
+}
+
+static void
+_cold_start_pool_warm_task (cold_start_test_t *cold_start_test)
+{
+   mongoc_client_pool_t *pool;
+   mongoc_client_t **clients;
+   int64_t start;
+   int i;
+
+   clients = bson_malloc0 (cold_start_test->n * sizeof (mongoc_client_t *));
+
+   start = bson_get_monotonic_time ();
+   pool = mongoc_client_pool_new (cold_start_test->uri);
+
+   for (i = 0; i < cold_start_test->n; i++) {
+      clients[i] = mongoc_client_pool_pop (pool);
+      _ping (clients[i], &cold_start_test->ping);
+   }
+
+   /* the latency is the time until all N connections are warm */
+   perf_latencies_add (&cold_start_test->latencies,
+                       bson_get_monotonic_time () - start);
+
+   for (i = 0; i < cold_start_test->n; i++) {
+      mongoc_client_pool_push (pool, clients[i]);
+   }
+
+   mongoc_client_pool_destroy (pool);
+   bson_free (clients);
+}
+
+static void
+_cold_start_pool_burst_task (cold_start_test_t *cold_start_test)
+{
+   int i;
+   int ret;
+
+   pthread_mutex_lock (&cold_start_test->mutex);
+   cold_start_test->release_time = bson_get_monotonic_time ();
+   cold_start_test->released = true;
+   pthread_cond_broadcast (&cold_start_test->cond);
+   pthread_mutex_unlock (&cold_start_test->mutex);
+
+   for (i = 0; i < cold_start_test->n; i++) {
+      ret = pthread_join (cold_start_test->contexts[i].thread, NULL /* out */);
+      if (ret != 0) {
+         MONGOC_ERROR ("Error: pthread_join returned %d", ret);
+         abort ();
+      }
+   }
+}
+
+static void
+cold_start_task (perf_test_t *test)
+{
+   cold_start_test_t *cold_start_test;
+
+   cold_start_test = (cold_start_test_t *) test;
+
+   switch (cold_start_test->mode) {
+   case COLD_START_POOL:
+      _cold_start_pool_task (cold_start_test);
+      break;
+   case COLD_START_POOL_WARM:
+      _cold_start_pool_warm_task (cold_start_test);
+      break;
+   case COLD_START_POOL_BURST:
+      _cold_start_pool_burst_task (cold_start_test);
+      break;
+   default:
+      abort ();
+   }
+}
+
+static void
+cold_start_after (perf_test_t *test)
+{
+   cold_start_test_t *cold_start_test;
+   int i;
+
+   cold_start_test = (cold_start_test_t *) test;
+   if (cold_start_test->mode == COLD_START_POOL_BURST) {
+      for (i = 0; i < cold_start_test->n; i++) {
+         perf_latencies_add (&cold_start_test->latencies,
+                             cold_start_test->contexts[i].latency);
+      }
+
+      mongoc_client_pool_destroy (cold_start_test->pool);
+      cold_start_test->pool = NULL;
+   }
+
+   perf_test_after (test);
+}
+
+static void
+cold_start_teardown (perf_test_t *test)
+{
+   cold_start_test_t *cold_start_test;
+
+   cold_start_test = (cold_start_test_t *) test;
+   perf_latencies_report (test, NULL, &cold_start_test->latencies);
+   perf_latencies_destroy (&cold_start_test->latencies);
+   mongoc_uri_destroy (cold_start_test->uri);
+   bson_destroy (&cold_start_test->ping);
+   bson_free (cold_start_test->contexts);
+   pthread_mutex_destroy (&cold_start_test->mutex);
+   pthread_cond_destroy (&cold_start_test->cond);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+cold_start_perf_new (cold_start_mode_t mode, int n)
+{
+   cold_start_test_t *cold_start_test;
+   perf_test_t *test;
+
+   cold_start_test =
+      (cold_start_test_t *) bson_malloc0 (sizeof (cold_start_test_t));
+   test = (perf_test_t *) cold_start_test;
+   cold_start_test->mode = mode;
+   cold_start_test->n = n;
+
+   switch (mode) {
+   case COLD_START_POOL:
+      bson_snprintf (cold_start_test->name,
+                     sizeof (cold_start_test->name),
+                     "TestColdStart/Pool");
+      n = POOL_COLD_START_COUNT;
+      break;
+   case COLD_START_POOL_WARM:
+      bson_snprintf (cold_start_test->name,
+                     sizeof (cold_start_test->name),
+                     "TestColdStart/PoolWarm/Clients:%d",
+                     n);
+      break;
+   case COLD_START_POOL_BURST:
+      bson_snprintf (cold_start_test->name,
+                     sizeof (cold_start_test->name),
+                     "TestColdStart/PoolBurst/Threads:%d",
+                     n);
+      break;
+   default:
+      abort ();
+   }
+
+   /* ops_per_sec is first operations per second */
+   perf_test_init (test, cold_start_test->name, NULL /* data path */, n);
+   test->setup = cold_start_setup;
+   test->before = cold_start_before;
+   test->task = cold_start_task;
+   test->after = cold_start_after;
+   test->teardown = cold_start_teardown;
+
+   return test;
+}
+
+
+void
+connection_perf (void)
+{
+   perf_test_t *tests[] = {
+      handshake_perf_new (),
+      cold_start_perf_new (COLD_START_POOL, 1),
+      cold_start_perf_new (COLD_START_POOL_WARM, 10),
+      cold_start_perf_new (COLD_START_POOL_WARM, 100),
+      cold_start_perf_new (COLD_START_POOL_BURST, 10),
+      cold_start_perf_new (COLD_START_POOL_BURST, 100),
+      NULL,
+   };
+
+   run_perf_tests (tests);
+}
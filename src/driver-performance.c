@@ -28,21 +28,71 @@ typedef struct {
    perf_test_t base;
    mongoc_client_t *client;
    mongoc_collection_t *collection;
+   /* optional wire compression, and zlib level or -1 */
+   const char *compressor;
+   int32_t compression_level;
+   /* optional concerns, applied to the collection */
+   mongoc_write_concern_t *write_concern;
+   mongoc_read_concern_t *read_concern;
+   /* optional APM or structured logging, applied to the client */
+   const perf_observe_t *observe;
+   /* optional read preference, applied to the collection */
+   mongoc_read_prefs_t *read_prefs;
+   /* time each operation of TestFindOneByID and the insert-one tests, only
+    * for the variants that report latencies, so the baseline tests are
+    * timed as before */
+   bool report_latencies;
+   perf_latencies_t latencies;
+   char name[128];
 } driver_test_t;
 
 static void
 driver_test_setup (perf_test_t *test)
 {
    driver_test_t *driver_test;
+   mongoc_uri_t *uri;
    mongoc_database_t *db;
    bson_error_t error;
 
    perf_test_setup (test);
 
    driver_test = (driver_test_t *) test;
-   driver_test->client = mongoc_client_new (NULL);
+   uri = perf_uri_new ();
+   if (driver_test->compressor) {
+      set_uri_compressor (
+         uri, driver_test->compressor, driver_test->compression_level);
+   }
+
+   driver_test->client = mongoc_client_new_from_uri (uri);
+   perf_apm_instrument (driver_test->client);
+   if (driver_test->observe) {
+      perf_observe_client (driver_test->client, driver_test->observe);
+   }
+
+   mongoc_uri_destroy (uri);
    driver_test->collection =
       mongoc_client_get_collection (driver_test->client, "perftest", "corpus");
+   if (driver_test->write_concern) {
+      mongoc_collection_set_write_concern (driver_test->collection,
+                                           driver_test->write_concern);
+   }
+
+   if (driver_test->read_concern) {
+      mongoc_collection_set_read_concern (driver_test->collection,
+                                          driver_test->read_concern);
+   }
+
+   if (driver_test->read_prefs) {
+      mongoc_collection_set_read_prefs (driver_test->collection,
+                                        driver_test->read_prefs);
+   }
+
+   perf_latencies_init (&driver_test->latencies);
+   if (driver_test->report_latencies) {
+      /* the usual iterations' samples, reallocated only for long runs */
+      perf_latencies_reserve (&driver_test->latencies,
+                              (size_t) NUM_ITERATIONS * NUM_DOCS);
+   }
 
    db = mongoc_client_get_database (driver_test->client, "perftest");
    if (!mongoc_database_drop (db, &error)) {
@@ -59,8 +109,13 @@ driver_test_teardown (perf_test_t *test)
    driver_test_t *driver_test;
 
    driver_test = (driver_test_t *) test;
+   perf_latencies_report (test, NULL, &driver_test->latencies);
+   perf_latencies_destroy (&driver_test->latencies);
    mongoc_collection_destroy (driver_test->collection);
    mongoc_client_destroy (driver_test->client);
+   mongoc_write_concern_destroy (driver_test->write_concern);
+   mongoc_read_concern_destroy (driver_test->read_concern);
+   mongoc_read_prefs_destroy (driver_test->read_prefs);
 
    perf_test_teardown (test);
 }
@@ -75,6 +130,135 @@ driver_test_init (driver_test_t *driver_test,
 
    driver_test->base.setup = driver_test_setup;
    driver_test->base.teardown = driver_test_teardown;
+   driver_test->compressor = NULL;
+   driver_test->compression_level = -1;
+}
+
+/* run a test over a compressed connection and report bytes on the wire */
+static perf_test_t *
+driver_test_with_compressor (perf_test_t *test,
+                             const char *compressor,
+                             int32_t level)
+{
+   driver_test_t *driver_test;
+
+   driver_test = (driver_test_t *) test;
+   driver_test->compressor = compressor;
+   driver_test->compression_level = level;
+
+   if (level >= 0) {
+      perf_test_append_name (test,
+                             driver_test->name,
+                             sizeof (driver_test->name),
+                             "/Compressor:%s/Level:%d",
+                             compressor,
+                             level);
+   } else {
+      perf_test_append_name (test,
+                             driver_test->name,
+                             sizeof (driver_test->name),
+                             "/Compressor:%s",
+                             compressor ? compressor : "none");
+   }
+
+   test->report_wire_bytes = true;
+
+   return test;
+}
+
+/* run a test with a write concern, w:0, w:1 or w:majority plus j:true */
+static perf_test_t *
+driver_test_with_write_concern (perf_test_t *test, int32_t w, bool journal)
+{
+   driver_test_t *driver_test;
+   char w_str[16];
+
+   driver_test = (driver_test_t *) test;
+   driver_test->write_concern = mongoc_write_concern_new ();
+   driver_test->report_latencies = true;
+
+   if (w == MONGOC_WRITE_CONCERN_W_MAJORITY) {
+      mongoc_write_concern_set_wmajority (driver_test->write_concern, 0);
+      bson_snprintf (w_str, sizeof (w_str), "majority");
+   } else {
+      mongoc_write_concern_set_w (driver_test->write_concern, w);
+      bson_snprintf (w_str, sizeof (w_str), "%d", w);
+   }
+
+   if (journal) {
+      mongoc_write_concern_set_journal (driver_test->write_concern, true);
+   }
+
+   perf_test_append_name (test,
+                          driver_test->name,
+                          sizeof (driver_test->name),
+                          "/W:%s%s",
+                          w_str,
+                          journal ? "/J:true" : "");
+
+   return test;
+}
+
+/* run a test with readConcern level "local", "majority" or "snapshot" */
+static perf_test_t *
+driver_test_with_read_concern (perf_test_t *test, const char *level)
+{
+   driver_test_t *driver_test;
+
+   driver_test = (driver_test_t *) test;
+   driver_test->read_concern = mongoc_read_concern_new ();
+   mongoc_read_concern_set_level (driver_test->read_concern, level);
+   driver_test->report_latencies = true;
+
+   perf_test_append_name (test,
+                          driver_test->name,
+                          sizeof (driver_test->name),
+                          "/ReadConcern:%s",
+                          level);
+
+   return test;
+}
+
+/* run a test with command monitoring or structured logging */
+static perf_test_t *
+driver_test_with_observe (perf_test_t *test, const perf_observe_t *observe)
+{
+   driver_test_t *driver_test;
+
+   driver_test = (driver_test_t *) test;
+   driver_test->observe = observe;
+
+   perf_test_append_name (test,
+                          driver_test->name,
+                          sizeof (driver_test->name),
+                          "/Observe:%s",
+                          observe->name);
+
+   return test;
+}
+
+/* run a read test with a read preference. the setup's writes wait for all
+ * n_members, so reads from any member find the documents. */
+static perf_test_t *
+driver_test_with_read_prefs (perf_test_t *test,
+                             const perf_read_pref_t *read_pref,
+                             int32_t n_members)
+{
+   driver_test_t *driver_test;
+
+   driver_test = (driver_test_t *) test;
+   driver_test->read_prefs = perf_read_prefs_new (read_pref);
+   driver_test->write_concern = mongoc_write_concern_new ();
+   mongoc_write_concern_set_w (driver_test->write_concern, n_members);
+   driver_test->report_latencies = true;
+
+   perf_test_append_name (test,
+                          driver_test->name,
+                          sizeof (driver_test->name),
+                          "/ReadPref:%s",
+                          read_pref->name);
+
+   return test;
 }
 
 /*
@@ -205,6 +389,7 @@ find_one_task (perf_test_t *test)
    mongoc_cursor_t *cursor;
    const bson_t *doc;
    bson_error_t error;
+   int64_t start = 0;
    int i;
 
    driver_test = (find_one_test_t *) test;
@@ -213,6 +398,10 @@ find_one_task (perf_test_t *test)
    bson_iter_init_find (&iter, &query, "_id");
 
    for (i = 0; i < NUM_DOCS; i++) {
+      if (driver_test->report_latencies) {
+         start = bson_get_monotonic_time ();
+      }
+
       bson_iter_overwrite_int32 (&iter, (int32_t) i);
 #if MONGOC_CHECK_VERSION(1, 5, 0)
       cursor = mongoc_collection_find_with_opts (
@@ -238,6 +427,10 @@ find_one_task (perf_test_t *test)
       }
 
       mongoc_cursor_destroy (cursor);
+      if (driver_test->report_latencies) {
+         perf_latencies_add (&driver_test->latencies,
+                             bson_get_monotonic_time () - start);
+      }
    }
 
    bson_destroy (&query);
@@ -320,6 +513,7 @@ _single_doc_task (perf_test_t *test, int num_docs)
    single_doc_test_t *driver_test;
    bson_t opts = BSON_INITIALIZER;
    bson_error_t error;
+   int64_t start = 0;
    int i;
 
    driver_test = (single_doc_test_t *) test;
@@ -327,6 +521,10 @@ _single_doc_task (perf_test_t *test, int num_docs)
    BSON_APPEND_BOOL (&opts, "validate", false);
 
    for (i = 0; i < num_docs; i++) {
+      if (driver_test->base.report_latencies) {
+         start = bson_get_monotonic_time ();
+      }
+
       if (!mongoc_collection_insert_one (driver_test->base.collection,
                                          &driver_test->doc,
                                          &opts,
@@ -335,6 +533,11 @@ _single_doc_task (perf_test_t *test, int num_docs)
          MONGOC_ERROR ("insert: %s\n", error.message);
          abort ();
       }
+
+      if (driver_test->base.report_latencies) {
+         perf_latencies_add (&driver_test->base.latencies,
+                             bson_get_monotonic_time () - start);
+      }
    }
 
    bson_destroy (&opts);
@@ -534,6 +737,7 @@ find_many_new (void)
 typedef struct {
    single_doc_test_t base;
    int num_docs;
+   bool unordered;
 } bulk_insert_test_t;
 
 static void
@@ -554,14 +758,19 @@ bulk_insert_task (perf_test_t *test)
    bson_error_t error;
    uint32_t num_docs;
    mongoc_bulk_operation_t *bulk;
+   bson_t bulk_opts = BSON_INITIALIZER;
    bson_t opts = BSON_INITIALIZER;
    int i;
 
    driver_test = (bulk_insert_test_t *) test;
    num_docs = (uint32_t) driver_test->num_docs;
 
+   if (driver_test->unordered) {
+      BSON_APPEND_BOOL (&bulk_opts, "ordered", false);
+   }
+
    bulk = mongoc_collection_create_bulk_operation_with_opts (
-      driver_test->base.base.collection, NULL);
+      driver_test->base.base.collection, &bulk_opts);
 
    BSON_APPEND_BOOL (&opts, "validate", false);
 
@@ -578,6 +787,8 @@ bulk_insert_task (perf_test_t *test)
       abort ();
    }
 
+   mongoc_bulk_operation_destroy (bulk);
+   bson_destroy (&bulk_opts);
    bson_destroy (&opts);
 }
 
@@ -647,6 +858,1361 @@ bulk_insert_large_new (void)
    return (perf_test_t *) bulk_insert_test;
 }
 
+static perf_test_t *
+bulk_insert_unordered (perf_test_t *test)
+{
+   bulk_insert_test_t *bulk_insert_test;
+   driver_test_t *driver_test;
+
+   bulk_insert_test = (bulk_insert_test_t *) test;
+   bulk_insert_test->unordered = true;
+
+   driver_test = (driver_test_t *) test;
+   perf_test_append_name (test,
+                          driver_test->name,
+                          sizeof (driver_test->name),
+                          "/Ordered:false");
+
+   return test;
+}
+
+
+/*
+ *  -------- BULK BATCH-SPLITTING BENCHMARKS ----------------------------------
+ */
+
+/* libmongoc splits a bulk into several commands when it exceeds the
+ * server's maxWriteBatchSize (100,000 operations) or maxMessageSizeBytes
+ * (48,000,000 bytes). These tests sweep both limits with generated documents,
+ * and report the number of insert commands sent per iteration. */
+typedef struct {
+   bulk_insert_test_t base;
+   int doc_sz;
+} bulk_split_test_t;
+
+static void
+bulk_split_setup (perf_test_t *test)
+{
+   bulk_split_test_t *bulk_split_test;
+   char *str;
+   size_t str_len;
+
+   driver_test_setup (test);
+
+   bulk_split_test = (bulk_split_test_t *) test;
+   perf_apm_set_callbacks (bulk_split_test->base.base.base.client);
+
+   /* a document {s: "xxx..."} is 13 bytes plus the string, and libmongoc
+    * adds a 17-byte ObjectId _id to each document it inserts */
+   str_len = (size_t) (bulk_split_test->doc_sz - 13 - 17);
+   str = bson_malloc (str_len + 1);
+   memset (str, 'x', str_len);
+   str[str_len] = '\0';
+
+   bson_init (&bulk_split_test->base.base.doc);
+   BSON_APPEND_UTF8 (&bulk_split_test->base.base.doc, "s", str);
+
+   bson_free (str);
+}
+
+static perf_test_t *
+bulk_split_new (int num_docs, int doc_sz, bool ordered)
+{
+   bulk_split_test_t *bulk_split_test;
+   driver_test_t *driver_test;
+
+   bulk_split_test =
+      (bulk_split_test_t *) bson_malloc0 (sizeof (bulk_split_test_t));
+   driver_test = (driver_test_t *) bulk_split_test;
+
+   bson_snprintf (driver_test->name,
+                  sizeof (driver_test->name),
+                  "TestBulkInsert/Ordered:%s/Docs:%d/Size:%d",
+                  ordered ? "true" : "false",
+                  num_docs,
+                  doc_sz);
+
+   bulk_insert_init (&bulk_split_test->base,
+                     driver_test->name,
+                     NULL /* data path */,
+                     (int64_t) num_docs * doc_sz);
+   bulk_split_test->base.num_docs = num_docs;
+   bulk_split_test->base.unordered = !ordered;
+   bulk_split_test->doc_sz = doc_sz;
+   driver_test->base.setup = bulk_split_setup;
+   driver_test->base.report_commands = true;
+
+   return (perf_test_t *) bulk_split_test;
+}
+
+/* unordered bulk inserts, and bulks around the server's batch limits */
+void
+driver_bulk_split_perf (void)
+{
+   struct {
+      int num_docs;
+      int doc_sz;
+   } sweep[] = {
+      /* around maxWriteBatchSize */
+      {50000, 100},
+      {100000, 100},
+      {100001, 100},
+      {200000, 100},
+      {200001, 100},
+      /* around maxMessageSizeBytes */
+      {47000, 1000},
+      {48000, 1000},
+      {96000, 1000},
+      {47, 1000000},
+      {48, 1000000},
+      {96, 1000000},
+   };
+
+   perf_test_t *tests[2 * 11 + 4 + 1];
+   size_t n;
+   size_t i;
+   int ordered;
+
+   n = 0;
+   tests[n++] = bulk_insert_unordered (bulk_insert_small_new ());
+   tests[n++] = bulk_insert_unordered (bulk_insert_large_new ());
+
+   for (i = 0; i < sizeof (sweep) / sizeof (sweep[0]); i++) {
+      for (ordered = 1; ordered >= 0; ordered--) {
+         tests[n++] =
+            bulk_split_new (sweep[i].num_docs, sweep[i].doc_sz, (bool) ordered);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+/*
+ *  -------- UPDATE / REPLACE / DELETE BENCHMARKS ----------------------------
+ */
+
+typedef enum {
+   WRITE_OP_UPDATE_ONE,
+   WRITE_OP_UPDATE_MANY,
+   WRITE_OP_REPLACE_ONE,
+   WRITE_OP_DELETE_ONE,
+   WRITE_OP_DELETE_MANY,
+} write_op_type_t;
+
+static const char *WRITE_OP_NAMES[] = {
+   "UpdateOne",
+   "UpdateMany",
+   "ReplaceOne",
+   "DeleteOne",
+   "DeleteMany",
+};
+
+/* number of documents matched by each UpdateMany / DeleteMany filter */
+static const int WRITE_MANY_BATCH_SIZE = 100;
+
+/* every document in the corpus is {_id: i, n: i, ...data_path document}.
+ * "indexed" tests filter on _id, "unindexed" tests filter on n, which forces
+ * a collection scan per operation */
+typedef struct {
+   single_doc_test_t base;
+   write_op_type_t op;
+   bool indexed;
+   bool bulk;
+   int num_ops;
+   int stride;
+   bson_t update;
+} write_op_test_t;
+
+static void
+write_op_setup (perf_test_t *test)
+{
+   write_op_test_t *write_op_test;
+
+   single_doc_setup (test);
+
+   write_op_test = (write_op_test_t *) test;
+   bson_init (&write_op_test->update);
+   BCON_APPEND (&write_op_test->update,
+                "$set",
+                "{",
+                "status",
+                BCON_UTF8 ("updated"),
+                "}",
+                "$inc",
+                "{",
+                "counter",
+                BCON_INT32 (1),
+                "}");
+}
+
+static void
+write_op_before (perf_test_t *test)
+{
+   write_op_test_t *write_op_test;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_error_t error;
+   int32_t i;
+
+   /* recreate the collection, deletes and replacements modify the corpus */
+   single_doc_before (test);
+
+   write_op_test = (write_op_test_t *) test;
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      write_op_test->base.base.collection, NULL);
+
+   for (i = 0; i < NUM_DOCS; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_INT32 (&doc, "n", i);
+      bson_concat (&doc, &write_op_test->base.doc);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      MONGOC_ERROR ("bulk insert: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+}
+
+static void
+_write_op_filter (write_op_test_t *write_op_test, int op_idx, bson_t *filter)
+{
+   const char *field;
+   int32_t key;
+
+   field = write_op_test->indexed ? "_id" : "n";
+   key = (int32_t) (op_idx * write_op_test->stride);
+
+   bson_reinit (filter);
+
+   if (write_op_test->op == WRITE_OP_UPDATE_MANY ||
+       write_op_test->op == WRITE_OP_DELETE_MANY) {
+      BCON_APPEND (filter,
+                   field,
+                   "{",
+                   "$gte",
+                   BCON_INT32 (key),
+                   "$lt",
+                   BCON_INT32 (key + WRITE_MANY_BATCH_SIZE),
+                   "}");
+   } else {
+      bson_append_int32 (filter, field, -1, key);
+   }
+}
+
+static void
+_write_op_replacement (write_op_test_t *write_op_test,
+                       int op_idx,
+                       bson_t *replacement)
+{
+   /* keep "n" so the unindexed filter still matches in later iterations */
+   bson_reinit (replacement);
+   BSON_APPEND_INT32 (
+      replacement, "n", (int32_t) (op_idx * write_op_test->stride));
+   bson_concat (replacement, &write_op_test->base.doc);
+}
+
+static bool
+_write_op_append (write_op_test_t *write_op_test,
+                  mongoc_bulk_operation_t *bulk,
+                  const bson_t *filter,
+                  const bson_t *replacement,
+                  bson_error_t *error)
+{
+   switch (write_op_test->op) {
+   case WRITE_OP_UPDATE_ONE:
+      return mongoc_bulk_operation_update_one_with_opts (
+         bulk, filter, &write_op_test->update, NULL, error);
+   case WRITE_OP_UPDATE_MANY:
+      return mongoc_bulk_operation_update_many_with_opts (
+         bulk, filter, &write_op_test->update, NULL, error);
+   case WRITE_OP_REPLACE_ONE:
+      return mongoc_bulk_operation_replace_one_with_opts (
+         bulk, filter, replacement, NULL, error);
+   case WRITE_OP_DELETE_ONE:
+      return mongoc_bulk_operation_remove_one_with_opts (
+         bulk, filter, NULL, error);
+   case WRITE_OP_DELETE_MANY:
+      return mongoc_bulk_operation_remove_many_with_opts (
+         bulk, filter, NULL, error);
+   default:
+      abort ();
+   }
+}
+
+static bool
+_write_op_execute (write_op_test_t *write_op_test,
+                   mongoc_collection_t *collection,
+                   const bson_t *filter,
+                   const bson_t *replacement,
+                   bson_error_t *error)
+{
+   switch (write_op_test->op) {
+   case WRITE_OP_UPDATE_ONE:
+      return mongoc_collection_update_one (
+         collection, filter, &write_op_test->update, NULL, NULL, error);
+   case WRITE_OP_UPDATE_MANY:
+      return mongoc_collection_update_many (
+         collection, filter, &write_op_test->update, NULL, NULL, error);
+   case WRITE_OP_REPLACE_ONE:
+      return mongoc_collection_replace_one (
+         collection, filter, replacement, NULL, NULL, error);
+   case WRITE_OP_DELETE_ONE:
+      return mongoc_collection_delete_one (
+         collection, filter, NULL, NULL, error);
+   case WRITE_OP_DELETE_MANY:
+      return mongoc_collection_delete_many (
+         collection, filter, NULL, NULL, error);
+   default:
+      abort ();
+   }
+}
+
+static void
+write_op_task (perf_test_t *test)
+{
+   write_op_test_t *write_op_test;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk = NULL;
+   bson_t filter = BSON_INITIALIZER;
+   bson_t replacement = BSON_INITIALIZER;
+   bson_error_t error;
+   bool r;
+   int i;
+
+   write_op_test = (write_op_test_t *) test;
+   collection = write_op_test->base.base.collection;
+
+   if (write_op_test->bulk) {
+      bulk =
+         mongoc_collection_create_bulk_operation_with_opts (collection, NULL);
+   }
+
+   for (i = 0; i < write_op_test->num_ops; i++) {
+      _write_op_filter (write_op_test, i, &filter);
+      if (write_op_test->op == WRITE_OP_REPLACE_ONE) {
+         _write_op_replacement (write_op_test, i, &replacement);
+      }
+
+      if (bulk) {
+         r = _write_op_append (
+            write_op_test, bulk, &filter, &replacement, &error);
+      } else {
+         r = _write_op_execute (
+            write_op_test, collection, &filter, &replacement, &error);
+      }
+
+      if (!r) {
+         MONGOC_ERROR ("%s: %s\n",
+                       WRITE_OP_NAMES[write_op_test->op],
+                       error.message);
+         abort ();
+      }
+   }
+
+   if (bulk) {
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk %s: %s\n",
+                       WRITE_OP_NAMES[write_op_test->op],
+                       error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+   }
+
+   bson_destroy (&filter);
+   bson_destroy (&replacement);
+}
+
+static void
+write_op_teardown (perf_test_t *test)
+{
+   write_op_test_t *write_op_test;
+
+   write_op_test = (write_op_test_t *) test;
+   bson_destroy (&write_op_test->update);
+
+   single_doc_teardown (test);
+}
+
+static void
+write_op_init (write_op_test_t *write_op_test,
+               const char *doc_name,
+               const char *data_path,
+               int64_t doc_sz,
+               write_op_type_t op,
+               bool indexed,
+               bool bulk)
+{
+   int docs_per_op;
+
+   write_op_test->op = op;
+   write_op_test->indexed = indexed;
+   write_op_test->bulk = bulk;
+
+   if (op == WRITE_OP_UPDATE_MANY || op == WRITE_OP_DELETE_MANY) {
+      docs_per_op = WRITE_MANY_BATCH_SIZE;
+      write_op_test->num_ops = NUM_DOCS / WRITE_MANY_BATCH_SIZE;
+   } else {
+      docs_per_op = 1;
+      /* each unindexed operation is a collection scan, run fewer of them */
+      write_op_test->num_ops = indexed ? NUM_DOCS : NUM_DOCS / 10;
+   }
+
+   /* spread the keys across the corpus so scans are not biased */
+   write_op_test->stride = NUM_DOCS / write_op_test->num_ops;
+
+   bson_snprintf (write_op_test->base.base.name,
+                  sizeof (write_op_test->base.base.name),
+                  "Test%s%s%s%s",
+                  doc_name,
+                  bulk ? "Bulk" : "",
+                  WRITE_OP_NAMES[op],
+                  indexed ? "" : "Unindexed");
+
+   single_doc_init (&write_op_test->base,
+                    write_op_test->base.base.name,
+                    data_path,
+                    doc_sz * docs_per_op * write_op_test->num_ops);
+   write_op_test->base.base.base.setup = write_op_setup;
+   write_op_test->base.base.base.before = write_op_before;
+   write_op_test->base.base.base.task = write_op_task;
+   write_op_test->base.base.base.teardown = write_op_teardown;
+}
+
+static perf_test_t *
+write_op_new (const char *doc_name,
+              const char *data_path,
+              int64_t doc_sz,
+              write_op_type_t op,
+              bool indexed,
+              bool bulk)
+{
+   write_op_test_t *write_op_test;
+
+   write_op_test = (write_op_test_t *) bson_malloc0 (sizeof (write_op_test_t));
+   write_op_init (
+      write_op_test, doc_name, data_path, doc_sz, op, indexed, bulk);
+
+   return (perf_test_t *) write_op_test;
+}
+
+/* updates, replaces and deletes, each indexed and unindexed, singly and in
+ * bulks */
+void
+driver_write_op_perf (void)
+{
+   struct {
+      const char *doc_name;
+      const char *data_path;
+      int64_t doc_sz;
+   } corpora[] = {
+      {"SmallDoc", "single_and_multi_document/small_doc.json", 275},
+      {"Tweet", "single_and_multi_document/tweet.json", 1622},
+   };
+
+   perf_test_t *tests[2 * 5 * 2 * 2 + 1];
+   size_t n;
+   size_t c;
+   int op;
+   int indexed;
+   int bulk;
+
+   n = 0;
+   for (c = 0; c < sizeof (corpora) / sizeof (corpora[0]); c++) {
+      for (bulk = 0; bulk < 2; bulk++) {
+         for (op = WRITE_OP_UPDATE_ONE; op <= WRITE_OP_DELETE_MANY; op++) {
+            for (indexed = 1; indexed >= 0; indexed--) {
+               tests[n++] = write_op_new (corpora[c].doc_name,
+                                          corpora[c].data_path,
+                                          corpora[c].doc_sz,
+                                          (write_op_type_t) op,
+                                          (bool) indexed,
+                                          (bool) bulk);
+            }
+         }
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/*
+ *  -------- AGGREGATE BENCHMARKS --------------------------------------------
+ */
+
+/* the find-many corpus, with an integer _id and a "group" key in 0-99 so
+ * pipelines have something to match, group and join on. ops_per_sec for
+ * these tests is documents returned per second, including draining the
+ * cursor */
+static const int AGGREGATE_NUM_GROUPS = 100;
+
+typedef struct {
+   single_doc_test_t base;
+   bson_t *pipeline;
+   int64_t expected_docs;
+} aggregate_test_t;
+
+static void
+aggregate_setup (perf_test_t *test)
+{
+   aggregate_test_t *aggregate_test;
+   mongoc_collection_t *groups;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_error_t error;
+   int32_t i;
+
+   single_doc_setup (test);
+
+   aggregate_test = (aggregate_test_t *) test;
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      aggregate_test->base.base.collection, NULL);
+
+   for (i = 0; i < NUM_DOCS; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_INT32 (&doc, "group", i % AGGREGATE_NUM_GROUPS);
+      bson_concat (&doc, &aggregate_test->base.doc);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      MONGOC_ERROR ("bulk insert: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+
+   /* the foreign collection for $lookup */
+   groups = mongoc_client_get_collection (
+      aggregate_test->base.base.client, "perftest", "groups");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (groups, NULL);
+
+   for (i = 0; i < AGGREGATE_NUM_GROUPS; i++) {
+      bson_init (&doc);
+      BSON_APPEND_INT32 (&doc, "_id", i);
+      BSON_APPEND_INT32 (&doc, "rank", AGGREGATE_NUM_GROUPS - i);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      MONGOC_ERROR ("bulk insert: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (groups);
+}
+
+static void
+aggregate_task (perf_test_t *test)
+{
+   aggregate_test_t *aggregate_test;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_error_t error;
+   int64_t n;
+
+   aggregate_test = (aggregate_test_t *) test;
+   cursor = mongoc_collection_aggregate (aggregate_test->base.base.collection,
+                                         MONGOC_QUERY_NONE,
+                                         aggregate_test->pipeline,
+                                         NULL /* opts */,
+                                         NULL /* read prefs */);
+
+   n = 0;
+   while (mongoc_cursor_next (cursor, &doc)) {
+      n++;
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      MONGOC_ERROR ("aggregate: %s\n", error.message);
+      abort ();
+   }
+
+   if (n != aggregate_test->expected_docs) {
+      MONGOC_ERROR ("aggregate: expected %" PRId64 " documents, got %" PRId64
+                    "\n",
+                    aggregate_test->expected_docs,
+                    n);
+      abort ();
+   }
+
+   mongoc_cursor_destroy (cursor);
+}
+
+static void
+aggregate_teardown (perf_test_t *test)
+{
+   aggregate_test_t *aggregate_test;
+
+   aggregate_test = (aggregate_test_t *) test;
+   bson_destroy (aggregate_test->pipeline);
+
+   single_doc_teardown (test);
+}
+
+static perf_test_t *
+aggregate_new (const char *name, bson_t *pipeline, int64_t expected_docs)
+{
+   aggregate_test_t *aggregate_test;
+
+   aggregate_test =
+      (aggregate_test_t *) bson_malloc0 (sizeof (aggregate_test_t));
+   bson_snprintf (aggregate_test->base.base.name,
+                  sizeof (aggregate_test->base.base.name),
+                  "%s",
+                  name);
+   aggregate_test->pipeline = pipeline;
+   aggregate_test->expected_docs = expected_docs;
+
+   single_doc_init (&aggregate_test->base,
+                    aggregate_test->base.base.name,
+                    "single_and_multi_document/tweet.json",
+                    expected_docs);
+   aggregate_test->base.base.base.setup = aggregate_setup;
+   aggregate_test->base.base.base.before = perf_test_before; /* no "before" */
+   aggregate_test->base.base.base.task = aggregate_task;
+   aggregate_test->base.base.base.teardown = aggregate_teardown;
+
+   return (perf_test_t *) aggregate_test;
+}
+
+static perf_test_t *
+aggregate_match_project_new (void)
+{
+   bson_t *pipeline;
+
+   pipeline = BCON_NEW ("pipeline",
+                        "[",
+                        "{",
+                        "$match",
+                        "{",
+                        "_id",
+                        "{",
+                        "$lt",
+                        BCON_INT32 (NUM_DOCS / 2),
+                        "}",
+                        "}",
+                        "}",
+                        "{",
+                        "$project",
+                        "{",
+                        "text",
+                        BCON_INT32 (1),
+                        "retweet_count",
+                        BCON_INT32 (1),
+                        "user.screen_name",
+                        BCON_INT32 (1),
+                        "}",
+                        "}",
+                        "]");
+
+   return aggregate_new ("TestAggregateMatchProject", pipeline, NUM_DOCS / 2);
+}
+
+static perf_test_t *
+aggregate_group_new (void)
+{
+   bson_t *pipeline;
+
+   pipeline = BCON_NEW ("pipeline",
+                        "[",
+                        "{",
+                        "$group",
+                        "{",
+                        "_id",
+                        BCON_UTF8 ("$group"),
+                        "count",
+                        "{",
+                        "$sum",
+                        BCON_INT32 (1),
+                        "}",
+                        "retweets",
+                        "{",
+                        "$sum",
+                        BCON_UTF8 ("$retweet_count"),
+                        "}",
+                        "followers",
+                        "{",
+                        "$avg",
+                        BCON_UTF8 ("$user.followers_count"),
+                        "}",
+                        "first",
+                        "{",
+                        "$min",
+                        BCON_UTF8 ("$_id"),
+                        "}",
+                        "last",
+                        "{",
+                        "$max",
+                        BCON_UTF8 ("$_id"),
+                        "}",
+                        "texts",
+                        "{",
+                        "$addToSet",
+                        BCON_UTF8 ("$text"),
+                        "}",
+                        "}",
+                        "}",
+                        "]");
+
+   return aggregate_new ("TestAggregateGroup", pipeline, AGGREGATE_NUM_GROUPS);
+}
+
+static perf_test_t *
+aggregate_sort_limit_new (int32_t limit)
+{
+   bson_t *pipeline;
+   char name[64];
+
+   pipeline = BCON_NEW ("pipeline",
+                        "[",
+                        "{",
+                        "$sort",
+                        "{",
+                        "group",
+                        BCON_INT32 (1),
+                        "_id",
+                        BCON_INT32 (-1),
+                        "}",
+                        "}",
+                        "{",
+                        "$limit",
+                        BCON_INT32 (limit),
+                        "}",
+                        "]");
+
+   bson_snprintf (
+      name, sizeof (name), "TestAggregateSortLimit/Limit:%d", limit);
+
+   return aggregate_new (name, pipeline, limit);
+}
+
+static perf_test_t *
+aggregate_lookup_new (void)
+{
+   bson_t *pipeline;
+
+   pipeline = BCON_NEW ("pipeline",
+                        "[",
+                        "{",
+                        "$lookup",
+                        "{",
+                        "from",
+                        BCON_UTF8 ("groups"),
+                        "localField",
+                        BCON_UTF8 ("group"),
+                        "foreignField",
+                        BCON_UTF8 ("_id"),
+                        "as",
+                        BCON_UTF8 ("groupInfo"),
+                        "}",
+                        "}",
+                        "]");
+
+   return aggregate_new ("TestAggregateLookup", pipeline, NUM_DOCS);
+}
+
+/* aggregation pipelines over the small document corpus */
+void
+driver_aggregate_perf (void)
+{
+   perf_test_t *tests[] = {
+      aggregate_match_project_new (),
+      aggregate_group_new (),
+      aggregate_sort_limit_new (10),
+      aggregate_sort_limit_new (100),
+      aggregate_sort_limit_new (1000),
+      aggregate_sort_limit_new (NUM_DOCS),
+      aggregate_lookup_new (),
+      NULL,
+   };
+
+   run_perf_tests (tests);
+}
+
+/*
+ *  -------- WIRE COMPRESSION BENCHMARKS --------------------------------------
+ */
+
+typedef perf_test_t *(*driver_test_new_t) (void);
+
+/* the driver benchmarks over each compressor libmongoc was built with */
+void
+driver_compression_perf (void)
+{
+   /* a NULL compressor is uncompressed, but still reports bytes on the wire */
+   struct {
+      const char *compressor;
+      int32_t level;
+   } compressors[] = {
+      {NULL, -1},
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+      {"snappy", -1},
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+      {"zstd", -1},
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+      {"zlib", 1},
+      {"zlib", 6},
+      {"zlib", 9},
+#endif
+   };
+
+   driver_test_new_t constructors[] = {
+      small_doc_new,
+      large_doc_new,
+      find_many_new,
+      bulk_insert_small_new,
+      bulk_insert_large_new,
+   };
+
+   perf_test_t *tests[6 * 5 + 1];
+   size_t n;
+   size_t i;
+   size_t j;
+
+   n = 0;
+   for (i = 0; i < sizeof (constructors) / sizeof (constructors[0]); i++) {
+      for (j = 0; j < sizeof (compressors) / sizeof (compressors[0]); j++) {
+         tests[n++] = driver_test_with_compressor (constructors[i] (),
+                                                   compressors[j].compressor,
+                                                   compressors[j].level);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/*
+ *  -------- MULTI-NAMESPACE BULK WRITE BENCHMARKS ----------------------------
+ */
+
+/* the server-side bulkWrite command is new in MongoDB 8.0 */
+static const int32_t WIRE_VERSION_8_0 = 25;
+
+/* MULTI_NS_OPERATION_COUNT is the total operations per iteration, spread
+ * evenly over the namespaces: 60% inserts, 20% updates, 20% deletes. */
+static const int MULTI_NS_OPERATION_COUNT = 10000;
+
+typedef struct {
+   single_doc_test_t base;
+   bool client_bulkwrite;
+   int num_namespaces;
+   int num_inserts;
+   int num_updates;
+   int num_deletes;
+   char **namespaces;
+   mongoc_collection_t **collections;
+   bson_t update;
+} multi_ns_test_t;
+
+static void
+multi_ns_setup (perf_test_t *test)
+{
+   multi_ns_test_t *multi_ns_test;
+   char name[32];
+   int i;
+
+   single_doc_setup (test);
+
+   multi_ns_test = (multi_ns_test_t *) test;
+   perf_apm_set_callbacks (multi_ns_test->base.base.client);
+
+   multi_ns_test->namespaces =
+      bson_malloc0 (multi_ns_test->num_namespaces * sizeof (char *));
+   multi_ns_test->collections = bson_malloc0 (
+      multi_ns_test->num_namespaces * sizeof (mongoc_collection_t *));
+
+   for (i = 0; i < multi_ns_test->num_namespaces; i++) {
+      bson_snprintf (name, sizeof (name), "corpus%d", i);
+      multi_ns_test->namespaces[i] = bson_strdup_printf ("perftest.%s", name);
+      multi_ns_test->collections[i] = mongoc_client_get_collection (
+         multi_ns_test->base.base.client, "perftest", name);
+   }
+
+   bson_init (&multi_ns_test->update);
+   BCON_APPEND (
+      &multi_ns_test->update, "$inc", "{", "counter", BCON_INT32 (1), "}");
+}
+
+static void
+multi_ns_before (perf_test_t *test)
+{
+   multi_ns_test_t *multi_ns_test;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   bson_t doc;
+   bson_error_t error;
+   int32_t i;
+   int j;
+
+   multi_ns_test = (multi_ns_test_t *) test;
+
+   /* reload the documents that this iteration updates and deletes */
+   for (j = 0; j < multi_ns_test->num_namespaces; j++) {
+      collection = multi_ns_test->collections[j];
+      if (!mongoc_collection_drop (collection, &error) &&
+          !strstr (error.message, "ns not found")) {
+         MONGOC_ERROR ("drop collection: %s\n", error.message);
+         abort ();
+      }
+
+      bulk = mongoc_collection_create_bulk_operation_with_opts (collection,
+                                                                NULL);
+
+      for (i = 0; i < multi_ns_test->num_updates + multi_ns_test->num_deletes;
+           i++) {
+         bson_init (&doc);
+         BSON_APPEND_INT32 (&doc, "_id", i);
+         bson_concat (&doc, &multi_ns_test->base.doc);
+         mongoc_bulk_operation_insert (bulk, &doc);
+         bson_destroy (&doc);
+      }
+
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk insert: %s\n", error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+   }
+}
+
+static void
+_multi_ns_id_filter (bson_t *filter, int32_t id)
+{
+   bson_reinit (filter);
+   BSON_APPEND_INT32 (filter, "_id", id);
+}
+
+static void
+_client_bulkwrite_task (multi_ns_test_t *multi_ns_test)
+{
+   mongoc_bulkwrite_t *bulkwrite;
+   mongoc_bulkwritereturn_t ret;
+   bson_t filter = BSON_INITIALIZER;
+   bson_error_t error;
+   const char *ns;
+   int32_t i;
+   int j;
+
+   bulkwrite = mongoc_client_bulkwrite_new (multi_ns_test->base.base.client);
+
+   for (j = 0; j < multi_ns_test->num_namespaces; j++) {
+      ns = multi_ns_test->namespaces[j];
+
+      for (i = 0; i < multi_ns_test->num_inserts; i++) {
+         if (!mongoc_bulkwrite_append_insertone (
+                bulkwrite, ns, &multi_ns_test->base.doc, NULL, &error)) {
+            MONGOC_ERROR ("append insert: %s\n", error.message);
+            abort ();
+         }
+      }
+
+      for (i = 0; i < multi_ns_test->num_updates; i++) {
+         _multi_ns_id_filter (&filter, i);
+         if (!mongoc_bulkwrite_append_updateone (
+                bulkwrite, ns, &filter, &multi_ns_test->update, NULL, &error)) {
+            MONGOC_ERROR ("append update: %s\n", error.message);
+            abort ();
+         }
+      }
+
+      for (i = 0; i < multi_ns_test->num_deletes; i++) {
+         _multi_ns_id_filter (&filter, multi_ns_test->num_updates + i);
+         if (!mongoc_bulkwrite_append_deleteone (
+                bulkwrite, ns, &filter, NULL, &error)) {
+            MONGOC_ERROR ("append delete: %s\n", error.message);
+            abort ();
+         }
+      }
+   }
+
+   ret = mongoc_bulkwrite_execute (bulkwrite, NULL /* opts */);
+   if (ret.exc) {
+      mongoc_bulkwriteexception_error (ret.exc, &error);
+      MONGOC_ERROR ("client bulkwrite: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulkwriteresult_destroy (ret.res);
+   mongoc_bulkwriteexception_destroy (ret.exc);
+   mongoc_bulkwrite_destroy (bulkwrite);
+   bson_destroy (&filter);
+}
+
+static void
+_collection_bulk_task (multi_ns_test_t *multi_ns_test)
+{
+   mongoc_bulk_operation_t *bulk;
+   bson_t filter = BSON_INITIALIZER;
+   bson_error_t error;
+   int32_t i;
+   int j;
+
+   for (j = 0; j < multi_ns_test->num_namespaces; j++) {
+      bulk = mongoc_collection_create_bulk_operation_with_opts (
+         multi_ns_test->collections[j], NULL);
+
+      for (i = 0; i < multi_ns_test->num_inserts; i++) {
+         if (!mongoc_bulk_operation_insert_with_opts (
+                bulk, &multi_ns_test->base.doc, NULL, &error)) {
+            MONGOC_ERROR ("append insert: %s\n", error.message);
+            abort ();
+         }
+      }
+
+      for (i = 0; i < multi_ns_test->num_updates; i++) {
+         _multi_ns_id_filter (&filter, i);
+         if (!mongoc_bulk_operation_update_one_with_opts (
+                bulk, &filter, &multi_ns_test->update, NULL, &error)) {
+            MONGOC_ERROR ("append update: %s\n", error.message);
+            abort ();
+         }
+      }
+
+      for (i = 0; i < multi_ns_test->num_deletes; i++) {
+         _multi_ns_id_filter (&filter, multi_ns_test->num_updates + i);
+         if (!mongoc_bulk_operation_remove_one_with_opts (
+                bulk, &filter, NULL, &error)) {
+            MONGOC_ERROR ("append delete: %s\n", error.message);
+            abort ();
+         }
+      }
+
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk: %s\n", error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+   }
+
+   bson_destroy (&filter);
+}
+
+static void
+multi_ns_task (perf_test_t *test)
+{
+   multi_ns_test_t *multi_ns_test;
+
+   multi_ns_test = (multi_ns_test_t *) test;
+
+   if (multi_ns_test->client_bulkwrite) {
+      _client_bulkwrite_task (multi_ns_test);
+   } else {
+      _collection_bulk_task (multi_ns_test);
+   }
+}
+
+static void
+multi_ns_teardown (perf_test_t *test)
+{
+   multi_ns_test_t *multi_ns_test;
+   int i;
+
+   multi_ns_test = (multi_ns_test_t *) test;
+
+   for (i = 0; i < multi_ns_test->num_namespaces; i++) {
+      bson_free (multi_ns_test->namespaces[i]);
+      mongoc_collection_destroy (multi_ns_test->collections[i]);
+   }
+
+   bson_free (multi_ns_test->namespaces);
+   bson_free (multi_ns_test->collections);
+   bson_destroy (&multi_ns_test->update);
+
+   single_doc_teardown (test);
+}
+
+static perf_test_t *
+multi_ns_new (bool client_bulkwrite, int num_namespaces)
+{
+   multi_ns_test_t *multi_ns_test;
+   driver_test_t *driver_test;
+   int ops_per_namespace;
+
+   multi_ns_test = (multi_ns_test_t *) bson_malloc0 (sizeof (multi_ns_test_t));
+   driver_test = (driver_test_t *) multi_ns_test;
+
+   multi_ns_test->client_bulkwrite = client_bulkwrite;
+   multi_ns_test->num_namespaces = num_namespaces;
+   ops_per_namespace = MULTI_NS_OPERATION_COUNT / num_namespaces;
+   multi_ns_test->num_updates = ops_per_namespace / 5;
+   multi_ns_test->num_deletes = ops_per_namespace / 5;
+   multi_ns_test->num_inserts = ops_per_namespace -
+                                multi_ns_test->num_updates -
+                                multi_ns_test->num_deletes;
+
+   bson_snprintf (driver_test->name,
+                  sizeof (driver_test->name),
+                  "%s/Namespaces:%d",
+                  client_bulkwrite ? "TestClientBulkWrite"
+                                   : "TestCollectionBulkWrite",
+                  num_namespaces);
+
+   /* ops_per_sec is write operations per second */
+   single_doc_init (&multi_ns_test->base,
+                    driver_test->name,
+                    "single_and_multi_document/small_doc.json",
+                    ops_per_namespace * num_namespaces);
+   driver_test->base.setup = multi_ns_setup;
+   driver_test->base.before = multi_ns_before;
+   driver_test->base.task = multi_ns_task;
+   driver_test->base.teardown = multi_ns_teardown;
+   driver_test->base.report_commands = true;
+
+   return (perf_test_t *) multi_ns_test;
+}
+
+/* collection and client bulk writes spread over 1, 10 and 100 namespaces */
+void
+driver_multi_ns_perf (void)
+{
+   const int num_namespaces[] = {1, 10, 100};
+   perf_test_t *tests[3 * 2 + 1];
+   size_t n;
+   size_t i;
+
+   if (server_max_wire_version () < WIRE_VERSION_8_0) {
+      printf ("Skipping client bulkWrite tests, they require MongoDB 8.0\n");
+      return;
+   }
+
+   n = 0;
+   for (i = 0; i < sizeof (num_namespaces) / sizeof (num_namespaces[0]); i++) {
+      tests[n++] = multi_ns_new (true, num_namespaces[i]);
+      tests[n++] = multi_ns_new (false, num_namespaces[i]);
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/*
+ *  -------- READ / WRITE CONCERN BENCHMARKS ----------------------------------
+ */
+
+void
+driver_concern_perf (void)
+{
+   struct {
+      int32_t w;
+      bool journal;
+   } write_concerns[] = {
+      {MONGOC_WRITE_CONCERN_W_UNACKNOWLEDGED, false},
+      {1, false},
+      {MONGOC_WRITE_CONCERN_W_MAJORITY, false},
+      {1, true},
+   };
+
+   const char *read_concerns[] = {
+      MONGOC_READ_CONCERN_LEVEL_LOCAL,
+      MONGOC_READ_CONCERN_LEVEL_MAJORITY,
+      MONGOC_READ_CONCERN_LEVEL_SNAPSHOT,
+   };
+
+   driver_test_new_t write_constructors[] = {
+      small_doc_new,
+      large_doc_new,
+      bulk_insert_small_new,
+   };
+
+   driver_test_new_t read_constructors[] = {
+      find_one_new,
+      find_many_new,
+   };
+
+   perf_test_t *tests[4 * 3 + 3 * 2 + 1];
+   size_t n;
+   size_t i;
+   size_t j;
+
+   /* snapshot reads and w:majority need a replica set */
+   if (!is_replica_set ()) {
+      MONGOC_ERROR ("the concern suite requires a replica set\n");
+      abort ();
+   }
+
+   n = 0;
+   for (i = 0; i < sizeof (write_constructors) / sizeof (write_constructors[0]);
+        i++) {
+      for (j = 0; j < sizeof (write_concerns) / sizeof (write_concerns[0]);
+           j++) {
+         tests[n++] =
+            driver_test_with_write_concern (write_constructors[i] (),
+                                            write_concerns[j].w,
+                                            write_concerns[j].journal);
+      }
+   }
+
+   for (i = 0; i < sizeof (read_constructors) / sizeof (read_constructors[0]);
+        i++) {
+      for (j = 0; j < sizeof (read_concerns) / sizeof (read_concerns[0]); j++) {
+         tests[n++] = driver_test_with_read_concern (read_constructors[i] (),
+                                                     read_concerns[j]);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/*
+ *  -------- SERVER SELECTION BENCHMARK --------------------------------------
+ */
+
+/* time mongoc_client_select_server alone, with the read preference of
+ * driver_test_with_read_prefs. data_sz is the number of selections. */
+
+typedef driver_test_t select_server_test_t;
+
+static void
+select_server_task (perf_test_t *test)
+{
+   select_server_test_t *driver_test;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   int64_t start;
+   int i;
+
+   driver_test = (select_server_test_t *) test;
+
+   for (i = 0; i < NUM_DOCS; i++) {
+      start = bson_get_monotonic_time ();
+      sd = mongoc_client_select_server (driver_test->client,
+                                        false /* for writes */,
+                                        driver_test->read_prefs,
+                                        &error);
+      if (!sd) {
+         MONGOC_ERROR ("select_server: %s\n", error.message);
+         abort ();
+      }
+
+      perf_latencies_add (&driver_test->latencies,
+                          bson_get_monotonic_time () - start);
+      mongoc_server_description_destroy (sd);
+   }
+}
+
+static perf_test_t *
+select_server_new (void)
+{
+   select_server_test_t *select_server_test;
+
+   select_server_test = (select_server_test_t *) bson_malloc0 (
+      sizeof (select_server_test_t));
+   driver_test_init (select_server_test,
+                     "TestServerSelection",
+                     NULL /* data path */,
+                     NUM_DOCS);
+   select_server_test->base.task = select_server_task;
+
+   return (perf_test_t *) select_server_test;
+}
+
+
+/* the read tests against a replica set under each of PERF_READ_PREFS */
+void
+driver_replset_perf (void)
+{
+   driver_test_new_t constructors[] = {
+      find_one_new,
+      find_many_new,
+      select_server_new,
+   };
+
+   perf_test_t **tests;
+   size_t n_constructors;
+   int32_t n_members;
+   size_t n;
+   size_t i;
+   size_t j;
+
+   if (!is_replica_set ()) {
+      MONGOC_ERROR ("the replset suite requires a replica set\n");
+      abort ();
+   }
+
+   n_members = replica_set_size ();
+   n_constructors = sizeof (constructors) / sizeof (constructors[0]);
+   tests = (perf_test_t **) bson_malloc0 (
+      (n_constructors * PERF_N_READ_PREFS + 1) * sizeof (perf_test_t *));
+
+   n = 0;
+   for (i = 0; i < n_constructors; i++) {
+      for (j = 0; j < PERF_N_READ_PREFS; j++) {
+         tests[n++] = driver_test_with_read_prefs (
+            constructors[i] (), &PERF_READ_PREFS[j], n_members);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+
+   bson_free (tests);
+}
+
+
+/* the cost of observability, see PERF_OBSERVE_MODES */
+void
+driver_observe_perf (void)
+{
+   driver_test_new_t constructors[] = {
+      run_cmd_new,
+      find_one_new,
+   };
+
+   perf_test_t **tests;
+   size_t n_constructors;
+   size_t n;
+   size_t i;
+   size_t j;
+
+   n_constructors = sizeof (constructors) / sizeof (constructors[0]);
+   tests = (perf_test_t **) bson_malloc0 (
+      (n_constructors * PERF_N_OBSERVE_MODES + 1) * sizeof (perf_test_t *));
+
+   n = 0;
+   for (i = 0; i < n_constructors; i++) {
+      for (j = 0; j < PERF_N_OBSERVE_MODES; j++) {
+         tests[n++] = driver_test_with_observe (constructors[i] (),
+                                                &PERF_OBSERVE_MODES[j]);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+
+   bson_free (tests);
+}
+
+
 void
 driver_perf (void)
 {
@@ -0,0 +1,562 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests the cost of client-side field level encryption with explicit
+ * encryption and the "local" KMS provider, so the only network traffic is to
+ * the key vault collection on the --uri server. Requires libmongoc built with
+ * client-side encryption.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#ifdef MONGOC_ENABLE_CLIENT_SIDE_ENCRYPTION
+
+#define KEYVAULT_DB "keyvault"
+#define KEYVAULT_COLL "datakeys"
+
+/* the local KMS provider's master key is 96 bytes */
+#define LOCAL_MASTER_KEY_SIZE 96
+
+/* ENCRYPT_COUNT is the number of values encrypted or decrypted per
+ * iteration, KEY_CACHE_MISS_COUNT the number encrypted with a data key that
+ * isn't cached yet */
+static const int ENCRYPT_COUNT = 1000;
+static const int KEY_CACHE_MISS_COUNT = 100;
+
+/* the bulk insert documents have BULK_FIELDS fields of BULK_FIELD_SIZE */
+static const int BULK_DOCS = 1000;
+static const int BULK_FIELDS = 10;
+static const int BULK_FIELD_SIZE = 100;
+
+typedef enum {
+   ENCRYPTION_ENCRYPT,
+   ENCRYPTION_DECRYPT,
+   ENCRYPTION_BULK_INSERT,
+} encryption_op_t;
+
+typedef enum {
+   /* encrypt with the data key setup created and cached */
+   ENCRYPTION_KEY_CACHE_HIT,
+   /* encrypt each value with its own data key, created in before, so the
+    * data key cache misses and the key is fetched and decrypted */
+   ENCRYPTION_KEY_CACHE_MISS,
+   /* encrypt each value with a new mongoc_client_encryption_t, timing the
+    * libmongocrypt handle and KMS provider setup as well as the key fetch */
+   ENCRYPTION_NEW_HANDLE,
+} encryption_key_cache_t;
+
+typedef struct {
+   perf_test_t base;
+   encryption_op_t op;
+   const char *algorithm;
+   int value_size;
+   int count;
+   encryption_key_cache_t key_cache;
+   /* encrypt n_encrypted of the bulk insert documents' BULK_FIELDS */
+   int n_encrypted;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   mongoc_client_encryption_t *client_encryption;
+   mongoc_client_encryption_encrypt_opts_t *encrypt_opts;
+   bson_value_t keyid;
+   /* with ENCRYPTION_KEY_CACHE_MISS, a new data key and options per value */
+   bson_value_t *miss_keyids;
+   mongoc_client_encryption_encrypt_opts_t **miss_opts;
+   char *str;
+   bson_value_t plaintext;
+   bson_value_t ciphertext;
+   char name[128];
+} encryption_test_t;
+
+static mongoc_client_encryption_t *
+_client_encryption_new (mongoc_client_t *keyvault_client)
+{
+   mongoc_client_encryption_opts_t *opts;
+   mongoc_client_encryption_t *client_encryption;
+   uint8_t master_key[LOCAL_MASTER_KEY_SIZE];
+   bson_t kms_providers;
+   bson_t local;
+   bson_error_t error;
+   int i;
+
+   /* any 96 bytes will do, the key vault is dropped in setup */
+   for (i = 0; i < LOCAL_MASTER_KEY_SIZE; i++) {
+      master_key[i] = (uint8_t) i;
+   }
+
+   bson_init (&kms_providers);
+   BSON_APPEND_DOCUMENT_BEGIN (&kms_providers, "local", &local);
+   BSON_APPEND_BINARY (
+      &local, "key", BSON_SUBTYPE_BINARY, master_key, LOCAL_MASTER_KEY_SIZE);
+   bson_append_document_end (&kms_providers, &local);
+
+   opts = mongoc_client_encryption_opts_new ();
+   mongoc_client_encryption_opts_set_keyvault_client (opts, keyvault_client);
+   mongoc_client_encryption_opts_set_keyvault_namespace (
+      opts, KEYVAULT_DB, KEYVAULT_COLL);
+   mongoc_client_encryption_opts_set_kms_providers (opts, &kms_providers);
+
+   client_encryption = mongoc_client_encryption_new (opts, &error);
+   if (!client_encryption) {
+      MONGOC_ERROR ("client_encryption_new: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_client_encryption_opts_destroy (opts);
+   bson_destroy (&kms_providers);
+
+   return client_encryption;
+}
+
+static void
+_drop_database (mongoc_client_t *client, const char *name)
+{
+   mongoc_database_t *db;
+   bson_error_t error;
+
+   db = mongoc_client_get_database (client, name);
+   if (!mongoc_database_drop (db, &error)) {
+      MONGOC_ERROR ("database_drop: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_database_destroy (db);
+}
+
+static void
+_encrypt (mongoc_client_encryption_t *client_encryption,
+          mongoc_client_encryption_encrypt_opts_t *encrypt_opts,
+          const bson_value_t *plaintext,
+          bson_value_t *ciphertext)
+{
+   bson_error_t error;
+
+   if (!mongoc_client_encryption_encrypt (
+          client_encryption, plaintext, encrypt_opts, ciphertext, &error)) {
+      MONGOC_ERROR ("encrypt: %s\n", error.message);
+      abort ();
+   }
+}
+
+static void
+_create_datakey (mongoc_client_encryption_t *client_encryption,
+                 bson_value_t *keyid)
+{
+   mongoc_client_encryption_datakey_opts_t *datakey_opts;
+   bson_error_t error;
+
+   datakey_opts = mongoc_client_encryption_datakey_opts_new ();
+   if (!mongoc_client_encryption_create_datakey (
+          client_encryption, "local", datakey_opts, keyid, &error)) {
+      MONGOC_ERROR ("create_datakey: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_client_encryption_datakey_opts_destroy (datakey_opts);
+}
+
+static mongoc_client_encryption_encrypt_opts_t *
+_encrypt_opts_new (const bson_value_t *keyid, const char *algorithm)
+{
+   mongoc_client_encryption_encrypt_opts_t *encrypt_opts;
+
+   encrypt_opts = mongoc_client_encryption_encrypt_opts_new ();
+   mongoc_client_encryption_encrypt_opts_set_keyid (encrypt_opts, keyid);
+   mongoc_client_encryption_encrypt_opts_set_algorithm (encrypt_opts,
+                                                        algorithm);
+
+   return encrypt_opts;
+}
+
+static void
+_destroy_miss_keys (encryption_test_t *encryption_test)
+{
+   int i;
+
+   if (!encryption_test->miss_keyids) {
+      return;
+   }
+
+   for (i = 0; i < encryption_test->count; i++) {
+      bson_value_destroy (&encryption_test->miss_keyids[i]);
+      mongoc_client_encryption_encrypt_opts_destroy (
+         encryption_test->miss_opts[i]);
+   }
+
+   bson_free (encryption_test->miss_keyids);
+   bson_free (encryption_test->miss_opts);
+   encryption_test->miss_keyids = NULL;
+   encryption_test->miss_opts = NULL;
+}
+
+/* new data keys the handle hasn't used, one per value in the next task */
+static void
+_create_miss_keys (encryption_test_t *encryption_test)
+{
+   int i;
+
+   _destroy_miss_keys (encryption_test);
+
+   encryption_test->miss_keyids = (bson_value_t *) bson_malloc0 (
+      encryption_test->count * sizeof (bson_value_t));
+   encryption_test->miss_opts =
+      (mongoc_client_encryption_encrypt_opts_t **) bson_malloc0 (
+         encryption_test->count *
+         sizeof (mongoc_client_encryption_encrypt_opts_t *));
+
+   for (i = 0; i < encryption_test->count; i++) {
+      _create_datakey (encryption_test->client_encryption,
+                       &encryption_test->miss_keyids[i]);
+      encryption_test->miss_opts[i] = _encrypt_opts_new (
+         &encryption_test->miss_keyids[i], encryption_test->algorithm);
+   }
+}
+
+static void
+encryption_setup (perf_test_t *test)
+{
+   encryption_test_t *encryption_test;
+   int size;
+
+   perf_test_setup (test);
+
+   encryption_test = (encryption_test_t *) test;
+   encryption_test->client = perf_client_new ();
+   _drop_database (encryption_test->client, KEYVAULT_DB);
+   _drop_database (encryption_test->client, "perftest");
+   encryption_test->collection = mongoc_client_get_collection (
+      encryption_test->client, "perftest", "corpus");
+
+   encryption_test->client_encryption =
+      _client_encryption_new (encryption_test->client);
+
+   _create_datakey (encryption_test->client_encryption,
+                    &encryption_test->keyid);
+   encryption_test->encrypt_opts =
+      _encrypt_opts_new (&encryption_test->keyid, encryption_test->algorithm);
+
+   size = encryption_test->op == ENCRYPTION_BULK_INSERT
+             ? BULK_FIELD_SIZE
+             : encryption_test->value_size;
+   encryption_test->str = bson_malloc (size + 1);
+   memset (encryption_test->str, 'x', size);
+   encryption_test->str[size] = '\0';
+   encryption_test->plaintext.value_type = BSON_TYPE_UTF8;
+   encryption_test->plaintext.value.v_utf8.str = encryption_test->str;
+   encryption_test->plaintext.value.v_utf8.len = (uint32_t) size;
+
+   /* the value to decrypt, which also fills the data key cache */
+   _encrypt (encryption_test->client_encryption,
+             encryption_test->encrypt_opts,
+             &encryption_test->plaintext,
+             &encryption_test->ciphertext);
+}
+
+static void
+encryption_before (perf_test_t *test)
+{
+   encryption_test_t *encryption_test;
+   bson_error_t error;
+
+   perf_test_before (test);
+
+   encryption_test = (encryption_test_t *) test;
+   if (encryption_test->key_cache == ENCRYPTION_KEY_CACHE_MISS) {
+      _create_miss_keys (encryption_test);
+      return;
+   }
+
+   if (encryption_test->op != ENCRYPTION_BULK_INSERT) {
+      return;
+   }
+
+   if (!mongoc_collection_drop (encryption_test->collection, &error) &&
+       !strstr (error.message, "ns not found")) {
+      MONGOC_ERROR ("collection_drop: %s\n", error.message);
+      abort ();
+   }
+}
+
+static void
+_encryption_encrypt_task (encryption_test_t *encryption_test)
+{
+   mongoc_client_encryption_t *client_encryption;
+   mongoc_client_encryption_encrypt_opts_t *encrypt_opts;
+   bson_value_t ciphertext;
+   int i;
+
+   client_encryption = encryption_test->client_encryption;
+   encrypt_opts = encryption_test->encrypt_opts;
+   for (i = 0; i < encryption_test->count; i++) {
+      if (encryption_test->key_cache == ENCRYPTION_KEY_CACHE_MISS) {
+         encrypt_opts = encryption_test->miss_opts[i];
+      } else if (encryption_test->key_cache == ENCRYPTION_NEW_HANDLE) {
+         client_encryption = _client_encryption_new (encryption_test->client);
+      }
+
+      _encrypt (client_encryption,
+                encrypt_opts,
+                &encryption_test->plaintext,
+                &ciphertext);
+      bson_value_destroy (&ciphertext);
+
+      if (encryption_test->key_cache == ENCRYPTION_NEW_HANDLE) {
+         mongoc_client_encryption_destroy (client_encryption);
+      }
+   }
+}
+
+static void
+_encryption_decrypt_task (encryption_test_t *encryption_test)
+{
+   bson_value_t plaintext;
+   bson_error_t error;
+   int i;
+
+   for (i = 0; i < encryption_test->count; i++) {
+      if (!mongoc_client_encryption_decrypt (
+             encryption_test->client_encryption,
+             &encryption_test->ciphertext,
+             &plaintext,
+             &error)) {
+         MONGOC_ERROR ("decrypt: %s\n", error.message);
+         abort ();
+      }
+
+      bson_value_destroy (&plaintext);
+   }
+}
+
+static void
+_encryption_bulk_insert_task (encryption_test_t *encryption_test)
+{
+   mongoc_bulk_operation_t *bulk;
+   bson_value_t ciphertext;
+   bson_t doc;
+   bson_error_t error;
+   char key[16];
+   int i;
+   int j;
+
+   bulk = mongoc_collection_create_bulk_operation_with_opts (
+      encryption_test->collection, NULL);
+
+   for (i = 0; i < BULK_DOCS; i++) {
+      bson_init (&doc);
+      for (j = 0; j < BULK_FIELDS; j++) {
+         bson_snprintf (key, sizeof (key), "f%d", j);
+         if (j < encryption_test->n_encrypted) {
+            _encrypt (encryption_test->client_encryption,
+                      encryption_test->encrypt_opts,
+                      &encryption_test->plaintext,
+                      &ciphertext);
+            BSON_APPEND_VALUE (&doc, key, &ciphertext);
+            bson_value_destroy (&ciphertext);
+         } else {
+            BSON_APPEND_VALUE (&doc, key, &encryption_test->plaintext);
+         }
+      }
+
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      MONGOC_ERROR ("bulk insert: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_bulk_operation_destroy (bulk);
+}
+
+static void
+encryption_task (perf_test_t *test)
+{
+   encryption_test_t *encryption_test;
+
+   encryption_test = (encryption_test_t *) test;
+
+   switch (encryption_test->op) {
+   case ENCRYPTION_ENCRYPT:
+      _encryption_encrypt_task (encryption_test);
+      break;
+   case ENCRYPTION_DECRYPT:
+      _encryption_decrypt_task (encryption_test);
+      break;
+   case ENCRYPTION_BULK_INSERT:
+      _encryption_bulk_insert_task (encryption_test);
+      break;
+   default:
+      abort ();
+   }
+}
+
+static void
+encryption_teardown (perf_test_t *test)
+{
+   encryption_test_t *encryption_test;
+
+   encryption_test = (encryption_test_t *) test;
+   _destroy_miss_keys (encryption_test);
+   bson_value_destroy (&encryption_test->ciphertext);
+   bson_value_destroy (&encryption_test->keyid);
+   bson_free (encryption_test->str);
+   mongoc_client_encryption_encrypt_opts_destroy (
+      encryption_test->encrypt_opts);
+   mongoc_client_encryption_destroy (encryption_test->client_encryption);
+   mongoc_collection_destroy (encryption_test->collection);
+   mongoc_client_destroy (encryption_test->client);
+
+   perf_test_teardown (test);
+}
+
+static encryption_test_t *
+encryption_test_new (encryption_op_t op, const char *algorithm)
+{
+   encryption_test_t *encryption_test;
+   perf_test_t *test;
+
+   encryption_test =
+      (encryption_test_t *) bson_malloc0 (sizeof (encryption_test_t));
+   test = (perf_test_t *) encryption_test;
+   encryption_test->op = op;
+   encryption_test->algorithm = algorithm;
+
+   perf_test_init (test, NULL /* name */, NULL /* data path */, 0);
+   test->name = encryption_test->name;
+   test->setup = encryption_setup;
+   test->before = encryption_before;
+   test->task = encryption_task;
+   test->teardown = encryption_teardown;
+
+   return encryption_test;
+}
+
+static const char *
+_algorithm_name (const char *algorithm)
+{
+   return strcmp (algorithm,
+                  MONGOC_AEAD_AES_256_CBC_HMAC_SHA_512_DETERMINISTIC) == 0
+             ? "Deterministic"
+             : "Random";
+}
+
+/* ops_per_sec is plaintext bytes encrypted or decrypted per second */
+static perf_test_t *
+encrypt_perf_new (encryption_op_t op,
+                  const char *algorithm,
+                  int value_size,
+                  encryption_key_cache_t key_cache)
+{
+   const char *suffixes[] = {"", "/KeyCache:Miss", "/ClientEncryption:New"};
+   encryption_test_t *encryption_test;
+
+   encryption_test = encryption_test_new (op, algorithm);
+   encryption_test->value_size = value_size;
+   encryption_test->key_cache = key_cache;
+   encryption_test->count = key_cache == ENCRYPTION_KEY_CACHE_HIT
+                               ? ENCRYPT_COUNT
+                               : KEY_CACHE_MISS_COUNT;
+   encryption_test->base.data_sz =
+      (int64_t) encryption_test->count * value_size;
+
+   bson_snprintf (encryption_test->name,
+                  sizeof (encryption_test->name),
+                  "%s/Algorithm:%s/Size:%d%s",
+                  op == ENCRYPTION_ENCRYPT ? "TestEncrypt" : "TestDecrypt",
+                  _algorithm_name (algorithm),
+                  value_size,
+                  suffixes[key_cache]);
+
+   return (perf_test_t *) encryption_test;
+}
+
+/* ops_per_sec is documents inserted per second */
+static perf_test_t *
+bulk_insert_encrypted_perf_new (int n_encrypted)
+{
+   encryption_test_t *encryption_test;
+
+   encryption_test = encryption_test_new (
+      ENCRYPTION_BULK_INSERT, MONGOC_AEAD_AES_256_CBC_HMAC_SHA_512_RANDOM);
+   encryption_test->n_encrypted = n_encrypted;
+   encryption_test->base.data_sz = BULK_DOCS;
+
+   bson_snprintf (encryption_test->name,
+                  sizeof (encryption_test->name),
+                  "TestBulkInsert/Fields:%d/EncryptedFields:%d",
+                  BULK_FIELDS,
+                  n_encrypted);
+
+   return (perf_test_t *) encryption_test;
+}
+
+
+void
+encryption_perf (void)
+{
+   const char *algorithms[] = {
+      MONGOC_AEAD_AES_256_CBC_HMAC_SHA_512_DETERMINISTIC,
+      MONGOC_AEAD_AES_256_CBC_HMAC_SHA_512_RANDOM,
+   };
+
+   const int sizes[] = {16, 256, 4096, 65536};
+   const encryption_op_t ops[] = {ENCRYPTION_ENCRYPT, ENCRYPTION_DECRYPT};
+   perf_test_t *tests[2 * 4 * 2 + 2 + 3 + 1];
+   size_t n;
+   size_t i;
+   size_t j;
+   size_t k;
+
+   n = 0;
+   for (i = 0; i < sizeof (algorithms) / sizeof (algorithms[0]); i++) {
+      for (j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++) {
+         for (k = 0; k < sizeof (ops) / sizeof (ops[0]); k++) {
+            tests[n++] = encrypt_perf_new (
+               ops[k], algorithms[i], sizes[j], ENCRYPTION_KEY_CACHE_HIT);
+         }
+      }
+   }
+
+   /* compare with TestEncrypt/Algorithm:Deterministic/Size:256 */
+   tests[n++] = encrypt_perf_new (
+      ENCRYPTION_ENCRYPT, algorithms[0], 256, ENCRYPTION_KEY_CACHE_MISS);
+   tests[n++] = encrypt_perf_new (
+      ENCRYPTION_ENCRYPT, algorithms[0], 256, ENCRYPTION_NEW_HANDLE);
+
+   tests[n++] = bulk_insert_encrypted_perf_new (0);
+   tests[n++] = bulk_insert_encrypted_perf_new (1);
+   tests[n++] = bulk_insert_encrypted_perf_new (BULK_FIELDS);
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+#else
+
+void
+encryption_perf (void)
+{
+   fprintf (stderr,
+            "libmongoc was built without client-side encryption, skipping "
+            "the encryption suite\n");
+}
+
+#endif
@@ -0,0 +1,433 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extended-json.h"
+
+#include <mongoc/mongoc.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the largest date relaxed mode writes as ISO-8601, 9999-12-31T23:59:59.999Z */
+static const int64_t MAX_ISO_DATE_MSEC = 253402300799999LL;
+
+static void
+_reserve (perf_json_buf_t *buf, size_t len)
+{
+   if (buf->len + len <= buf->sz) {
+      return;
+   }
+
+   while (buf->len + len > buf->sz) {
+      buf->sz = buf->sz ? buf->sz * 2 : 4096;
+   }
+
+   buf->data = bson_realloc (buf->data, buf->sz);
+}
+
+void
+perf_json_buf_append (perf_json_buf_t *buf, const char *data, size_t len)
+{
+   _reserve (buf, len);
+   memcpy (buf->data + buf->len, data, len);
+   buf->len += len;
+}
+
+static void
+_append_str (perf_json_buf_t *buf, const char *str)
+{
+   perf_json_buf_append (buf, str, strlen (str));
+}
+
+/* formats up to 64 bytes, enough for numbers and dates */
+static void
+_append_printf (perf_json_buf_t *buf, const char *format, ...)
+{
+   va_list args;
+   int n;
+
+   _reserve (buf, 64);
+   va_start (args, format);
+   n = vsnprintf (buf->data + buf->len, 64, format, args);
+   va_end (args);
+   BSON_ASSERT (n >= 0 && n < 64);
+   buf->len += (size_t) n;
+}
+
+/* a JSON string, escaping quotes, backslashes and control characters */
+static void
+_append_string (perf_json_buf_t *buf, const char *str, size_t len)
+{
+   const char *run;
+   const char *end;
+   unsigned char c;
+
+   perf_json_buf_append (buf, "\"", 1);
+   end = str + len;
+   for (run = str; str < end; str++) {
+      c = (unsigned char) *str;
+      if (c >= 0x20 && c != '"' && c != '\\') {
+         continue;
+      }
+
+      perf_json_buf_append (buf, run, (size_t) (str - run));
+      run = str + 1;
+      switch (c) {
+      case '"':
+         _append_str (buf, "\\\"");
+         break;
+      case '\\':
+         _append_str (buf, "\\\\");
+         break;
+      case '\b':
+         _append_str (buf, "\\b");
+         break;
+      case '\f':
+         _append_str (buf, "\\f");
+         break;
+      case '\n':
+         _append_str (buf, "\\n");
+         break;
+      case '\r':
+         _append_str (buf, "\\r");
+         break;
+      case '\t':
+         _append_str (buf, "\\t");
+         break;
+      default:
+         _append_printf (buf, "\\u%04x", c);
+      }
+   }
+
+   perf_json_buf_append (buf, run, (size_t) (end - run));
+   perf_json_buf_append (buf, "\"", 1);
+}
+
+static void
+_append_base64 (perf_json_buf_t *buf, const uint8_t *data, uint32_t len)
+{
+   static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+   char *out;
+   uint32_t i;
+   uint32_t v;
+
+   _reserve (buf, ((size_t) len + 2) / 3 * 4);
+   out = buf->data + buf->len;
+   for (i = 0; i + 2 < len; i += 3) {
+      v = (uint32_t) data[i] << 16 | (uint32_t) data[i + 1] << 8 | data[i + 2];
+      *out++ = alphabet[v >> 18];
+      *out++ = alphabet[(v >> 12) & 0x3f];
+      *out++ = alphabet[(v >> 6) & 0x3f];
+      *out++ = alphabet[v & 0x3f];
+   }
+
+   if (i < len) {
+      v = (uint32_t) data[i] << 16;
+      if (i + 1 < len) {
+         v |= (uint32_t) data[i + 1] << 8;
+      }
+
+      *out++ = alphabet[v >> 18];
+      *out++ = alphabet[(v >> 12) & 0x3f];
+      *out++ = i + 1 < len ? alphabet[(v >> 6) & 0x3f] : '=';
+      *out++ = '=';
+   }
+
+   buf->len = (size_t) (out - buf->data);
+}
+
+/* a finite double, keeping a decimal point so it reads back as a double,
+ * like libbson: "1.0", "-0.0" */
+static void
+_append_finite_double (perf_json_buf_t *buf, double value)
+{
+   size_t start;
+
+   start = buf->len;
+   _append_printf (buf, "%.20g", value);
+   if (!memchr (buf->data + start, '.', buf->len - start) &&
+       !memchr (buf->data + start, 'e', buf->len - start)) {
+      _append_str (buf, ".0");
+   }
+}
+
+static void
+_append_double (perf_json_buf_t *buf, double value, perf_json_mode_t mode)
+{
+   if (mode == PERF_JSON_RELAXED && isfinite (value)) {
+      _append_finite_double (buf, value);
+      return;
+   }
+
+   _append_str (buf, "{ \"$numberDouble\" : \"");
+   if (isnan (value)) {
+      _append_str (buf, "NaN");
+   } else if (isinf (value)) {
+      _append_str (buf, value > 0 ? "Infinity" : "-Infinity");
+   } else {
+      _append_finite_double (buf, value);
+   }
+
+   _append_str (buf, "\" }");
+}
+
+static void
+_append_date (perf_json_buf_t *buf, int64_t msec, perf_json_mode_t mode)
+{
+   struct tm tm;
+   time_t sec;
+
+   if (mode == PERF_JSON_CANONICAL || msec < 0 || msec > MAX_ISO_DATE_MSEC) {
+      _append_printf (
+         buf, "{ \"$date\" : { \"$numberLong\" : \"%" PRId64 "\" } }", msec);
+      return;
+   }
+
+   sec = (time_t) (msec / 1000);
+   gmtime_r (&sec, &tm);
+   _append_printf (buf,
+                   "{ \"$date\" : \"%04d-%02d-%02dT%02d:%02d:%02d",
+                   tm.tm_year + 1900,
+                   tm.tm_mon + 1,
+                   tm.tm_mday,
+                   tm.tm_hour,
+                   tm.tm_min,
+                   tm.tm_sec);
+   if (msec % 1000) {
+      _append_printf (buf, ".%03d", (int) (msec % 1000));
+   }
+
+   _append_str (buf, "Z\" }");
+}
+
+static void
+_append_oid (perf_json_buf_t *buf, const bson_oid_t *oid)
+{
+   char str[25];
+
+   bson_oid_to_string (oid, str);
+   _append_str (buf, "{ \"$oid\" : \"");
+   _append_str (buf, str);
+   _append_str (buf, "\" }");
+}
+
+static void
+_append_iter (perf_json_buf_t *buf,
+              bson_iter_t *iter,
+              bool is_array,
+              perf_json_mode_t mode);
+
+static void
+_append_value (perf_json_buf_t *buf,
+               const bson_iter_t *iter,
+               perf_json_mode_t mode)
+{
+   bson_iter_t child;
+   const char *str;
+   const char *options;
+   const bson_oid_t *oid;
+   const uint8_t *data;
+   uint32_t len;
+   uint32_t timestamp;
+   uint32_t increment;
+   bson_subtype_t subtype;
+   bson_decimal128_t decimal128;
+   char decimal_str[BSON_DECIMAL128_STRING];
+   const uint8_t *scope_data;
+   uint32_t scope_len;
+   bson_t scope;
+
+   switch (bson_iter_type (iter)) {
+   case BSON_TYPE_DOUBLE:
+      _append_double (buf, bson_iter_double (iter), mode);
+      break;
+   case BSON_TYPE_UTF8:
+      str = bson_iter_utf8 (iter, &len);
+      _append_string (buf, str, len);
+      break;
+   case BSON_TYPE_DOCUMENT:
+   case BSON_TYPE_ARRAY:
+      if (!bson_iter_recurse (iter, &child)) {
+         MONGOC_ERROR ("corrupt BSON\n");
+         abort ();
+      }
+
+      _append_iter (
+         buf, &child, bson_iter_type (iter) == BSON_TYPE_ARRAY, mode);
+      break;
+   case BSON_TYPE_BINARY:
+      bson_iter_binary (iter, &subtype, &len, &data);
+      _append_str (buf, "{ \"$binary\" : { \"base64\" : \"");
+      _append_base64 (buf, data, len);
+      _append_printf (buf, "\", \"subType\" : \"%02x\" } }", (int) subtype);
+      break;
+   case BSON_TYPE_UNDEFINED:
+      _append_str (buf, "{ \"$undefined\" : true }");
+      break;
+   case BSON_TYPE_OID:
+      _append_oid (buf, bson_iter_oid (iter));
+      break;
+   case BSON_TYPE_BOOL:
+      _append_str (buf, bson_iter_bool (iter) ? "true" : "false");
+      break;
+   case BSON_TYPE_DATE_TIME:
+      _append_date (buf, bson_iter_date_time (iter), mode);
+      break;
+   case BSON_TYPE_NULL:
+      _append_str (buf, "null");
+      break;
+   case BSON_TYPE_REGEX:
+      str = bson_iter_regex (iter, &options);
+      _append_str (buf, "{ \"$regularExpression\" : { \"pattern\" : ");
+      _append_string (buf, str, strlen (str));
+      _append_str (buf, ", \"options\" : ");
+      _append_string (buf, options, strlen (options));
+      _append_str (buf, " } }");
+      break;
+   case BSON_TYPE_DBPOINTER:
+      bson_iter_dbpointer (iter, &len, &str, &oid);
+      _append_str (buf, "{ \"$dbPointer\" : { \"$ref\" : ");
+      _append_string (buf, str, len);
+      _append_str (buf, ", \"$id\" : ");
+      _append_oid (buf, oid);
+      _append_str (buf, " } }");
+      break;
+   case BSON_TYPE_CODE:
+      str = bson_iter_code (iter, &len);
+      _append_str (buf, "{ \"$code\" : ");
+      _append_string (buf, str, len);
+      _append_str (buf, " }");
+      break;
+   case BSON_TYPE_SYMBOL:
+      str = bson_iter_symbol (iter, &len);
+      _append_str (buf, "{ \"$symbol\" : ");
+      _append_string (buf, str, len);
+      _append_str (buf, " }");
+      break;
+   case BSON_TYPE_CODEWSCOPE:
+      str = bson_iter_codewscope (iter, &len, &scope_len, &scope_data);
+      _append_str (buf, "{ \"$code\" : ");
+      _append_string (buf, str, len);
+      _append_str (buf, ", \"$scope\" : ");
+      if (!bson_init_static (&scope, scope_data, scope_len)) {
+         MONGOC_ERROR ("corrupt BSON\n");
+         abort ();
+      }
+
+      perf_json_append_document (buf, &scope, mode);
+      _append_str (buf, " }");
+      break;
+   case BSON_TYPE_INT32:
+      if (mode == PERF_JSON_CANONICAL) {
+         _append_printf (buf,
+                         "{ \"$numberInt\" : \"%" PRId32 "\" }",
+                         bson_iter_int32 (iter));
+      } else {
+         _append_printf (buf, "%" PRId32, bson_iter_int32 (iter));
+      }
+
+      break;
+   case BSON_TYPE_TIMESTAMP:
+      bson_iter_timestamp (iter, &timestamp, &increment);
+      _append_printf (buf,
+                      "{ \"$timestamp\" : { \"t\" : %u, \"i\" : %u } }",
+                      timestamp,
+                      increment);
+      break;
+   case BSON_TYPE_INT64:
+      if (mode == PERF_JSON_CANONICAL) {
+         _append_printf (buf,
+                         "{ \"$numberLong\" : \"%" PRId64 "\" }",
+                         bson_iter_int64 (iter));
+      } else {
+         _append_printf (buf, "%" PRId64, bson_iter_int64 (iter));
+      }
+
+      break;
+   case BSON_TYPE_DECIMAL128:
+      bson_iter_decimal128 (iter, &decimal128);
+      bson_decimal128_to_string (&decimal128, decimal_str);
+      _append_str (buf, "{ \"$numberDecimal\" : \"");
+      _append_str (buf, decimal_str);
+      _append_str (buf, "\" }");
+      break;
+   case BSON_TYPE_MAXKEY:
+      _append_str (buf, "{ \"$maxKey\" : 1 }");
+      break;
+   case BSON_TYPE_MINKEY:
+      _append_str (buf, "{ \"$minKey\" : 1 }");
+      break;
+   case BSON_TYPE_EOD:
+   default:
+      MONGOC_ERROR ("unsupported BSON type 0x%02x\n",
+                    (int) bson_iter_type (iter));
+      abort ();
+   }
+}
+
+static void
+_append_iter (perf_json_buf_t *buf,
+              bson_iter_t *iter,
+              bool is_array,
+              perf_json_mode_t mode)
+{
+   const char *key;
+   bool first = true;
+
+   _append_str (buf, is_array ? "[" : "{");
+   while (bson_iter_next (iter)) {
+      _append_str (buf, first ? " " : ", ");
+      first = false;
+      if (!is_array) {
+         key = bson_iter_key (iter);
+         _append_string (buf, key, bson_iter_key_len (iter));
+         _append_str (buf, " : ");
+      }
+
+      _append_value (buf, iter, mode);
+   }
+
+   _append_str (buf, is_array ? " ]" : " }");
+}
+
+void
+perf_json_append_document (perf_json_buf_t *buf,
+                           const bson_t *doc,
+                           perf_json_mode_t mode)
+{
+   bson_iter_t iter;
+
+   if (!bson_iter_init (&iter, doc)) {
+      MONGOC_ERROR ("corrupt BSON\n");
+      abort ();
+   }
+
+   _append_iter (buf, &iter, false, mode);
+}
+
+void
+perf_json_buf_destroy (perf_json_buf_t *buf)
+{
+   bson_free (buf->data);
+   buf->data = NULL;
+   buf->len = 0;
+   buf->sz = 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGO_C_PERFORMANCE_EXTENDED_JSON_H
+#define MONGO_C_PERFORMANCE_EXTENDED_JSON_H
+
+#include <bson/bson.h>
+
+/* Serializes documents as relaxed or canonical Extended JSON, in libbson's
+ * "{ "key" : value }" layout, appending to a caller's buffer. libbson's
+ * bson_as_*_extended_json return a new string per document; this only
+ * allocates when the buffer grows, so a buffer reused across documents stops
+ * allocating. */
+typedef enum {
+   PERF_JSON_RELAXED,
+   PERF_JSON_CANONICAL,
+} perf_json_mode_t;
+
+typedef struct {
+   char *data;
+   size_t len;
+   size_t sz;
+} perf_json_buf_t;
+
+/* append the document's JSON, without a newline */
+void
+perf_json_append_document (perf_json_buf_t *buf,
+                           const bson_t *doc,
+                           perf_json_mode_t mode);
+void
+perf_json_buf_append (perf_json_buf_t *buf, const char *data, size_t len);
+void
+perf_json_buf_destroy (perf_json_buf_t *buf);
+
+#endif // MONGO_C_PERFORMANCE_EXTENDED_JSON_H
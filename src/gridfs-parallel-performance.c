@@ -31,7 +31,6 @@
 typedef struct {
    char *filename;
    char *path;
-   pthread_t thread;
    mongoc_client_t *client;
    mongoc_stream_t *stream;
    mongoc_gridfs_t *gridfs;
@@ -42,6 +41,7 @@ typedef struct {
    mongoc_client_pool_t *pool;
    int cnt;
    multi_upload_thread_context_t *contexts;
+   perf_workers_t workers;
 } multi_upload_test_t;
 
 
@@ -60,8 +60,9 @@ multi_upload_setup (perf_test_t *test)
 
    upload_test = (multi_upload_test_t *) test;
 
-   uri = mongoc_uri_new (NULL);
+   uri = perf_uri_new ();
    upload_test->pool = mongoc_client_pool_new (uri);
+   perf_apm_instrument_pool (upload_test->pool);
 
    data_dir = bson_strdup_printf ("%s/%s", g_test_dir, test->data_path);
    dirp = opendir (data_dir);
@@ -98,6 +99,8 @@ multi_upload_setup (perf_test_t *test)
 
    assert (i == upload_test->cnt);
 
+   perf_workers_init (&upload_test->workers, upload_test->cnt);
+
    closedir (dirp);
    bson_free (data_dir);
    mongoc_uri_destroy (uri);
@@ -192,23 +195,17 @@ static void
 multi_upload_task (perf_test_t *test)
 {
    multi_upload_test_t *upload_test;
-   multi_upload_thread_context_t *ctx;
-   int i;
    void *r;
+   int i;
 
    upload_test = (multi_upload_test_t *) test;
+   perf_workers_run (&upload_test->workers,
+                     _multi_upload_thread,
+                     upload_test->contexts,
+                     sizeof (multi_upload_thread_context_t));
 
    for (i = 0; i < upload_test->cnt; i++) {
-      ctx = &upload_test->contexts[i];
-      pthread_create (&ctx->thread, NULL, _multi_upload_thread, (void *) ctx);
-   }
-
-   for (i = 0; i < upload_test->cnt; i++) {
-      if (pthread_join (upload_test->contexts[i].thread, &r)) {
-         perror ("pthread_join");
-         abort ();
-      }
-
+      r = upload_test->workers.workers[i].result;
       if ((intptr_t) r != 1) {
          MONGOC_ERROR ("upload_thread returned %p\n", r);
          abort ();
@@ -244,6 +241,8 @@ multi_upload_teardown (perf_test_t *test)
    int i;
 
    upload_test = (multi_upload_test_t *) test;
+   perf_workers_report (test, &upload_test->workers);
+   perf_workers_destroy (&upload_test->workers);
 
    for (i = 0; i < upload_test->cnt; i++) {
       ctx = &upload_test->contexts[i];
@@ -294,7 +293,6 @@ multi_upload_perf_new (void)
 typedef struct {
    char *filename;
    char *path;
-   pthread_t thread;
    mongoc_client_t *client;
    mongoc_stream_t *stream;
    mongoc_gridfs_t *gridfs;
@@ -305,6 +303,7 @@ typedef struct {
    mongoc_client_pool_t *pool;
    int cnt;
    multi_download_thread_context_t *contexts;
+   perf_workers_t workers;
 } multi_download_test_t;
 
 
@@ -332,8 +331,9 @@ multi_download_setup (perf_test_t *test)
    perf_test_setup (test);
 
    download_test = (multi_download_test_t *) test;
-   uri = mongoc_uri_new (NULL);
+   uri = perf_uri_new ();
    download_test->pool = mongoc_client_pool_new (uri);
+   perf_apm_instrument_pool (download_test->pool);
 
    download_test->cnt = 50; /* DANGER!: assumes test corpus won't change */
    download_test->contexts = (multi_download_thread_context_t *) bson_malloc0 (
@@ -345,6 +345,8 @@ multi_download_setup (perf_test_t *test)
       ctx->path = bson_strdup_printf ("%s/%s", test->data_path, ctx->filename);
    }
 
+   perf_workers_init (&download_test->workers, download_test->cnt);
+
    mongoc_uri_destroy (uri);
 }
 
@@ -442,23 +444,17 @@ static void
 multi_download_task (perf_test_t *test)
 {
    multi_download_test_t *download_test;
-   multi_download_thread_context_t *ctx;
-   int i;
    void *r;
+   int i;
 
    download_test = (multi_download_test_t *) test;
+   perf_workers_run (&download_test->workers,
+                     _multi_download_thread,
+                     download_test->contexts,
+                     sizeof (multi_download_thread_context_t));
 
    for (i = 0; i < download_test->cnt; i++) {
-      ctx = &download_test->contexts[i];
-      pthread_create (&ctx->thread, NULL, _multi_download_thread, (void *) ctx);
-   }
-
-   for (i = 0; i < download_test->cnt; i++) {
-      if (pthread_join (download_test->contexts[i].thread, &r)) {
-         perror ("pthread_join");
-         abort ();
-      }
-
+      r = download_test->workers.workers[i].result;
       if ((intptr_t) r != 1) {
          MONGOC_ERROR ("download_thread returned %p\n", r);
          abort ();
@@ -495,6 +491,8 @@ multi_download_teardown (perf_test_t *test)
    int i;
 
    download_test = (multi_download_test_t *) test;
+   perf_workers_report (test, &download_test->workers);
+   perf_workers_destroy (&download_test->workers);
 
    for (i = 0; i < download_test->cnt; i++) {
       ctx = &download_test->contexts[i];
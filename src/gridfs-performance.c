@@ -104,7 +104,8 @@ gridfs_setup (perf_test_t *test)
    perf_test_setup (test);
 
    gridfs_test = (gridfs_test_t *) test;
-   gridfs_test->client = mongoc_client_new (NULL);
+   gridfs_test->client = perf_client_new ();
+   perf_apm_instrument (gridfs_test->client);
 
    path = bson_strdup_printf ("%s/single_and_multi_document/gridfs_large.bin",
                               g_test_dir);
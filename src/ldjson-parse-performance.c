@@ -0,0 +1,559 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests parsing one large JSON-lines file, the ldjson_multi files
+ * concatenated several times: serially with bson_json_reader, and in
+ * parallel by mapping the file, splitting it into a chunk per thread on line
+ * boundaries found with a vectorized newline scan, and parsing each line with
+ * bson_init_from_json. Nothing is sent to the server.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERF_X86_SIMD
+#include <immintrin.h>
+#endif
+
+
+#define PARSE_TMP_DIR "/tmp/TestJsonLinesParse"
+
+/* the generated file is the ldjson_multi files concatenated this many times,
+ * about 2.3 GB */
+static const int CONCAT_REPEATS = 4;
+
+static char *g_concat_path;
+static int64_t g_concat_size;
+
+typedef enum {
+   SCAN_SCALAR,
+   SCAN_SSE2,
+   SCAN_AVX2,
+   N_SCANS,
+} newline_scan_t;
+
+static const char *SCAN_NAMES[] = {
+   "scalar",
+   "sse2",
+   "avx2",
+};
+
+/* the first newline in [p, end), or end */
+typedef const char *(*find_newline_fn_t) (const char *p, const char *end);
+
+typedef enum {
+   /* only find the newlines, to compare scans */
+   PARSE_SCAN_ONLY,
+   /* bson_json_reader_new_from_file on one thread */
+   PARSE_STDIO,
+   /* chunks of the mapped file on threads */
+   PARSE_MMAP,
+} parse_mode_t;
+
+typedef struct {
+   perf_test_t base;
+   parse_mode_t mode;
+   newline_scan_t scan;
+   find_newline_fn_t find_newline;
+   int n_threads;
+   perf_workers_t workers;
+   struct _parse_chunk_context_t *contexts;
+   /* the mapping during a PARSE_MMAP or PARSE_SCAN_ONLY task */
+   const char *data;
+   size_t size;
+   /* documents or lines in the last run */
+   int64_t n_docs;
+   char name[128];
+} parse_test_t;
+
+typedef struct _parse_chunk_context_t {
+   parse_test_t *test;
+   int index;
+   int64_t n_docs;
+} parse_chunk_context_t;
+
+static const char *
+_find_newline_scalar (const char *p, const char *end)
+{
+   while (p < end && *p != '\n') {
+      p++;
+   }
+
+   return p;
+}
+
+#ifdef PERF_X86_SIMD
+__attribute__ ((target ("sse2"))) static const char *
+_find_newline_sse2 (const char *p, const char *end)
+{
+   const __m128i newline = _mm_set1_epi8 ('\n');
+   __m128i v;
+   int mask;
+
+   while (end - p >= 16) {
+      v = _mm_loadu_si128 ((const __m128i *) p);
+      mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, newline));
+      if (mask) {
+         return p + __builtin_ctz (mask);
+      }
+
+      p += 16;
+   }
+
+   return _find_newline_scalar (p, end);
+}
+
+__attribute__ ((target ("avx2"))) static const char *
+_find_newline_avx2 (const char *p, const char *end)
+{
+   const __m256i newline = _mm256_set1_epi8 ('\n');
+   __m256i v;
+   unsigned int mask;
+
+   while (end - p >= 32) {
+      v = _mm256_loadu_si256 ((const __m256i *) p);
+      mask = (unsigned int) _mm256_movemask_epi8 (
+         _mm256_cmpeq_epi8 (v, newline));
+      if (mask) {
+         return p + __builtin_ctz (mask);
+      }
+
+      p += 32;
+   }
+
+   return _find_newline_scalar (p, end);
+}
+#endif
+
+/* the scan's function, or NULL if this CPU or build doesn't support it */
+static find_newline_fn_t
+_find_newline_fn (newline_scan_t scan)
+{
+#ifdef PERF_X86_SIMD
+   __builtin_cpu_init ();
+   if (scan == SCAN_SSE2 && __builtin_cpu_supports ("sse2")) {
+      return _find_newline_sse2;
+   }
+
+   if (scan == SCAN_AVX2 && __builtin_cpu_supports ("avx2")) {
+      return _find_newline_avx2;
+   }
+#endif
+
+   return scan == SCAN_SCALAR ? _find_newline_scalar : NULL;
+}
+
+static newline_scan_t
+_best_scan (void)
+{
+   int scan;
+
+   for (scan = N_SCANS - 1; scan > SCAN_SCALAR; scan--) {
+      if (_find_newline_fn ((newline_scan_t) scan)) {
+         break;
+      }
+   }
+
+   return (newline_scan_t) scan;
+}
+
+static void
+_append_file (FILE *out, const char *path)
+{
+   char buf[1024 * 1024];
+   FILE *in;
+   size_t n;
+   char last = '\n';
+
+   in = fopen (path, "rb");
+   if (!in) {
+      perror (path);
+      abort ();
+   }
+
+   while ((n = fread (buf, 1, sizeof (buf), in)) > 0) {
+      if (fwrite (buf, 1, n, out) != n) {
+         perror ("fwrite");
+         abort ();
+      }
+
+      last = buf[n - 1];
+   }
+
+   /* keep the next file's first document on its own line */
+   if (last != '\n') {
+      fputc ('\n', out);
+   }
+
+   fclose (in);
+}
+
+/* concatenate the ldjson_multi files, the first time a test needs them */
+static void
+_concat_file_ensure (void)
+{
+   char *data_dir;
+   char *path;
+   DIR *dirp;
+   struct dirent *dp;
+   FILE *out;
+   struct stat sb;
+   int i;
+
+   if (g_concat_path) {
+      return;
+   }
+
+   prep_tmp_dir (PARSE_TMP_DIR);
+   g_concat_path = bson_strdup_printf ("%s/ldjson_multi.txt", PARSE_TMP_DIR);
+   out = fopen (g_concat_path, "wb");
+   if (!out) {
+      perror (g_concat_path);
+      abort ();
+   }
+
+   data_dir = bson_strdup_printf ("%s/parallel/ldjson_multi", g_test_dir);
+   for (i = 0; i < CONCAT_REPEATS; i++) {
+      dirp = opendir (data_dir);
+      if (!dirp) {
+         perror ("opening data path");
+         abort ();
+      }
+
+      while ((dp = readdir (dirp)) != NULL) {
+         if (!strcmp (get_ext (dp->d_name), "txt")) {
+            path = bson_strdup_printf ("%s/%s", data_dir, dp->d_name);
+            _append_file (out, path);
+            bson_free (path);
+         }
+      }
+
+      closedir (dirp);
+   }
+
+   if (fclose (out) != 0 || stat (g_concat_path, &sb) != 0) {
+      perror (g_concat_path);
+      abort ();
+   }
+
+   g_concat_size = (int64_t) sb.st_size;
+   bson_free (data_dir);
+}
+
+static void
+_concat_file_remove (void)
+{
+   if (g_concat_path) {
+      remove (g_concat_path);
+      bson_free (g_concat_path);
+      g_concat_path = NULL;
+   }
+}
+
+static void
+_map_file (parse_test_t *parse_test)
+{
+   int fd;
+   void *data;
+
+   fd = open (g_concat_path, O_RDONLY);
+   if (fd < 0) {
+      perror (g_concat_path);
+      abort ();
+   }
+
+   parse_test->size = (size_t) g_concat_size;
+   data = mmap (NULL, parse_test->size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (data == MAP_FAILED) {
+      perror ("mmap");
+      abort ();
+   }
+
+   madvise (data, parse_test->size, MADV_SEQUENTIAL);
+   close (fd);
+   parse_test->data = (const char *) data;
+}
+
+static void
+_unmap_file (parse_test_t *parse_test)
+{
+   munmap ((void *) parse_test->data, parse_test->size);
+   parse_test->data = NULL;
+}
+
+/* where chunk i starts: an even split, moved past the next newline unless it
+ * already starts a line; chunk n_threads starts at the end */
+static const char *
+_chunk_start (parse_test_t *parse_test, int i)
+{
+   const char *end = parse_test->data + parse_test->size;
+   const char *p;
+
+   if (i == 0) {
+      return parse_test->data;
+   }
+
+   if (i == parse_test->n_threads) {
+      return end;
+   }
+
+   p = parse_test->data + parse_test->size / parse_test->n_threads * i;
+   if (p[-1] == '\n') {
+      return p;
+   }
+
+   p = parse_test->find_newline (p, end);
+
+   return p < end ? p + 1 : end;
+}
+
+static void *
+_parse_chunk_thread (void *p)
+{
+   parse_chunk_context_t *ctx;
+   parse_test_t *parse_test;
+   const char *line;
+   const char *newline;
+   const char *end;
+   bson_t bson;
+   bson_error_t error;
+
+   ctx = (parse_chunk_context_t *) p;
+   parse_test = ctx->test;
+   ctx->n_docs = 0;
+   line = _chunk_start (parse_test, ctx->index);
+   end = _chunk_start (parse_test, ctx->index + 1);
+
+   for (; line < end; line = newline + 1) {
+      newline = parse_test->find_newline (line, end);
+      if (newline == line) {
+         continue;
+      }
+
+      if (!bson_init_from_json (&bson, line, newline - line, &error)) {
+         MONGOC_ERROR ("bson_init_from_json: %s\n", error.message);
+         abort ();
+      }
+
+      bson_destroy (&bson);
+      ctx->n_docs++;
+   }
+
+   return (void *) 1;
+}
+
+static void
+parse_setup (perf_test_t *test)
+{
+   parse_test_t *parse_test;
+   int i;
+
+   parse_test = (parse_test_t *) test;
+   _concat_file_ensure ();
+   test->data_sz = g_concat_size;
+
+   if (parse_test->mode == PARSE_MMAP) {
+      parse_test->contexts = (parse_chunk_context_t *) bson_malloc0 (
+         parse_test->n_threads * sizeof (parse_chunk_context_t));
+      for (i = 0; i < parse_test->n_threads; i++) {
+         parse_test->contexts[i].test = parse_test;
+         parse_test->contexts[i].index = i;
+      }
+
+      perf_workers_init (&parse_test->workers, parse_test->n_threads);
+   }
+}
+
+static void
+_parse_stdio (parse_test_t *parse_test)
+{
+   bson_json_reader_t *reader;
+   bson_t bson = BSON_INITIALIZER;
+   bson_error_t error;
+   int r;
+
+   reader = bson_json_reader_new_from_file (g_concat_path, &error);
+   if (!reader) {
+      MONGOC_ERROR ("%s\n", error.message);
+      abort ();
+   }
+
+   parse_test->n_docs = 0;
+   while ((r = bson_json_reader_read (reader, &bson, &error))) {
+      if (r < 0) {
+         MONGOC_ERROR ("reader_read: %s\n", error.message);
+         abort ();
+      }
+
+      parse_test->n_docs++;
+      bson_reinit (&bson);
+   }
+
+   bson_destroy (&bson);
+   bson_json_reader_destroy (reader);
+}
+
+static void
+_scan_only (parse_test_t *parse_test)
+{
+   const char *p;
+   const char *end;
+
+   parse_test->n_docs = 0;
+   end = parse_test->data + parse_test->size;
+   for (p = parse_test->data; p < end; p++) {
+      p = parse_test->find_newline (p, end);
+      parse_test->n_docs++;
+   }
+}
+
+/* each iteration maps the file, so page faults are timed like the stdio
+ * reader's reads */
+static void
+parse_task (perf_test_t *test)
+{
+   parse_test_t *parse_test;
+   int i;
+
+   parse_test = (parse_test_t *) test;
+   switch (parse_test->mode) {
+   case PARSE_STDIO:
+      _parse_stdio (parse_test);
+      break;
+   case PARSE_SCAN_ONLY:
+      _map_file (parse_test);
+      _scan_only (parse_test);
+      _unmap_file (parse_test);
+      break;
+   case PARSE_MMAP:
+      _map_file (parse_test);
+      perf_workers_run (&parse_test->workers,
+                        _parse_chunk_thread,
+                        parse_test->contexts,
+                        sizeof (parse_chunk_context_t));
+      _unmap_file (parse_test);
+      parse_test->n_docs = 0;
+      for (i = 0; i < parse_test->n_threads; i++) {
+         parse_test->n_docs += parse_test->contexts[i].n_docs;
+      }
+
+      break;
+   default:
+      abort ();
+   }
+}
+
+/* "docs" is the documents parsed, or lines scanned, per iteration, to check
+ * the readers against each other */
+static void
+parse_teardown (perf_test_t *test)
+{
+   parse_test_t *parse_test;
+
+   parse_test = (parse_test_t *) test;
+   perf_test_add_metric (test, "docs", (double) parse_test->n_docs);
+
+   if (parse_test->mode == PARSE_MMAP) {
+      perf_workers_report (test, &parse_test->workers);
+      perf_workers_destroy (&parse_test->workers);
+      bson_free (parse_test->contexts);
+   }
+}
+
+static perf_test_t *
+parse_perf_new (parse_mode_t mode, newline_scan_t scan, int n_threads)
+{
+   parse_test_t *parse_test;
+   perf_test_t *test;
+
+   parse_test = (parse_test_t *) bson_malloc0 (sizeof (parse_test_t));
+   test = (perf_test_t *) parse_test;
+   parse_test->mode = mode;
+   parse_test->scan = scan;
+   parse_test->find_newline = _find_newline_fn (scan);
+   parse_test->n_threads = n_threads;
+
+   switch (mode) {
+   case PARSE_SCAN_ONLY:
+      bson_snprintf (parse_test->name,
+                     sizeof (parse_test->name),
+                     "TestNewlineScan/Scan:%s",
+                     SCAN_NAMES[scan]);
+      break;
+   case PARSE_STDIO:
+      bson_snprintf (parse_test->name,
+                     sizeof (parse_test->name),
+                     "TestJsonLinesParse/Reader:stdio");
+      break;
+   case PARSE_MMAP:
+      bson_snprintf (parse_test->name,
+                     sizeof (parse_test->name),
+                     "TestJsonLinesParse/Reader:mmap/Scan:%s/Threads:%d",
+                     SCAN_NAMES[scan],
+                     n_threads);
+      break;
+   default:
+      abort ();
+   }
+
+   /* the data size is the generated file's, known in setup */
+   perf_test_init (test, parse_test->name, NULL /* data path */, 0);
+   test->setup = parse_setup;
+   test->task = parse_task;
+   test->teardown = parse_teardown;
+
+   return test;
+}
+
+
+void
+ldjson_parse_perf (void)
+{
+   const int threads[] = {1, 2, 4, 8, 16};
+   perf_test_t *tests[N_SCANS + 1 + 5 + 1];
+   size_t n;
+   size_t i;
+   int scan;
+
+   n = 0;
+   for (scan = SCAN_SCALAR; scan < N_SCANS; scan++) {
+      if (_find_newline_fn ((newline_scan_t) scan)) {
+         tests[n++] =
+            parse_perf_new (PARSE_SCAN_ONLY, (newline_scan_t) scan, 1);
+      }
+   }
+
+   tests[n++] = parse_perf_new (PARSE_STDIO, SCAN_SCALAR, 1);
+   for (i = 0; i < sizeof (threads) / sizeof (threads[0]); i++) {
+      tests[n++] = parse_perf_new (PARSE_MMAP, _best_scan (), threads[i]);
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+
+   _concat_file_remove ();
+}
@@ -15,12 +15,18 @@
  */
 
 #include "mongo-c-performance.h"
+#include "extended-json.h"
 
 #include <stdio.h>
 #include <bson/bson.h>
 #include <mongoc/mongoc.h>
 #include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
 
 /*
  *  -------- LDJSON MULTI-FILE IMPORT BENCHMARK -------------------------------
@@ -32,17 +38,706 @@ typedef struct {
    int cnt;
    char **filenames;
    char **paths;
-   pthread_t *threads;
+   /* a worker and a context per file */
+   perf_workers_t workers;
+   struct _import_thread_context_t *contexts;
+   /* if nonzero, import in this many processes instead of threads, each
+    * with its own client, taking the files in turn */
+   int n_processes;
+   perf_processes_t processes;
+   /* if nonzero, parse in n_parsers threads and insert in n_writers, see
+    * import_pipeline_t */
+   int n_parsers;
+   int n_writers;
+   struct _import_pipeline_t *pipeline;
+   /* if nonzero, execute a new bulk every flush_docs documents or
+    * flush_bytes of BSON, instead of one bulk per file */
+   int flush_docs;
+   int64_t flush_bytes;
+   /* execute each bulk on a flusher thread while the next one builds */
+   bool double_buffer;
+   struct _import_flusher_t *flushers;
    bool add_file_id;
+   /* optional wire compression, and zlib level or -1 */
+   const char *compressor;
+   int32_t compression_level;
+   char name[128];
 } import_test_t;
 
 
-typedef struct {
+typedef struct _import_thread_context_t {
    import_test_t *test;
    int offset;
 } import_thread_context_t;
 
 
+typedef struct {
+   import_test_t *test;
+   mongoc_client_t *client;
+   int index;
+} import_process_state_t;
+
+
+static mongoc_uri_t *
+_import_uri_new (import_test_t *import_test)
+{
+   mongoc_uri_t *uri;
+
+   uri = perf_uri_new ();
+   if (import_test->compressor) {
+      set_uri_compressor (
+         uri, import_test->compressor, import_test->compression_level);
+   }
+
+   /* a client per file, and one per flusher */
+   if (import_test->double_buffer &&
+       !mongoc_uri_set_option_as_int32 (
+          uri, MONGOC_URI_MAXPOOLSIZE, 2 * import_test->cnt)) {
+      MONGOC_ERROR ("can't set maxPoolSize\n");
+      abort ();
+   }
+
+   /* a client per writer, which --pipeline may set above the default 100,
+    * and one for setup */
+   if (import_test->n_writers >= 100 &&
+       !mongoc_uri_set_option_as_int32 (
+          uri, MONGOC_URI_MAXPOOLSIZE, import_test->n_writers + 1)) {
+      MONGOC_ERROR ("can't set maxPoolSize\n");
+      abort ();
+   }
+
+   return uri;
+}
+
+
+static void *
+_import_process_init (void *ctx, int index);
+
+
+static void
+_import_process_run (void *p);
+
+
+/*
+ *  -------- PIPELINED IMPORT ----------------------------------------------
+ *
+ *  Parser threads take files in turn and parse them into batches of
+ *  concatenated BSON, which they pass to writer threads, each holding a
+ *  pooled client, to insert. Batches are recycled through two bounded
+ *  lock-free queues, so memory is bounded and parsing overlaps inserts.
+ */
+
+/* documents per batch, and batches in flight: a power of two */
+#define IMPORT_BATCH_DOCS 1000
+#define IMPORT_PIPELINE_BATCHES 64
+
+typedef struct {
+   uint8_t *data;
+   size_t len;
+   size_t sz;
+   int n_docs;
+} import_batch_t;
+
+/* Dmitry Vyukov's bounded multi-producer multi-consumer queue */
+typedef struct {
+   _Atomic (size_t) sequence;
+   import_batch_t *batch;
+} import_queue_cell_t;
+
+typedef struct {
+   import_queue_cell_t *cells;
+   size_t mask;
+   /* on their own cache lines, so producers and consumers don't contend */
+   char pad0[64];
+   _Atomic (size_t) enqueue_pos;
+   char pad1[64];
+   _Atomic (size_t) dequeue_pos;
+   char pad2[64];
+} import_queue_t;
+
+typedef struct {
+   import_test_t *test;
+   bool writer;
+   /* a writer's client, popped in setup */
+   mongoc_client_t *client;
+   /* time waiting on a queue, for all runs */
+   int64_t stall_usec;
+} import_stage_context_t;
+
+typedef struct _import_pipeline_t {
+   import_batch_t batches[IMPORT_PIPELINE_BATCHES];
+   /* empty batches for parsers, and full ones for writers */
+   import_queue_t free;
+   import_queue_t full;
+   _Atomic (int) next_file;
+   _Atomic (int) parsers_running;
+   /* the parsers, then the writers */
+   perf_workers_t workers;
+   import_stage_context_t *contexts;
+} import_pipeline_t;
+
+/* tells a writer that the parsers are done */
+static import_batch_t IMPORT_BATCH_END;
+
+
+static void
+_import_queue_init (import_queue_t *queue, size_t capacity)
+{
+   size_t i;
+
+   BSON_ASSERT ((capacity & (capacity - 1)) == 0);
+   queue->cells = (import_queue_cell_t *) bson_malloc0 (
+      capacity * sizeof (import_queue_cell_t));
+   queue->mask = capacity - 1;
+   for (i = 0; i < capacity; i++) {
+      atomic_init (&queue->cells[i].sequence, i);
+   }
+
+   atomic_init (&queue->enqueue_pos, 0);
+   atomic_init (&queue->dequeue_pos, 0);
+}
+
+
+static bool
+_import_queue_push (import_queue_t *queue, import_batch_t *batch)
+{
+   import_queue_cell_t *cell;
+   size_t pos;
+   intptr_t diff;
+
+   pos = atomic_load_explicit (&queue->enqueue_pos, memory_order_relaxed);
+   for (;;) {
+      cell = &queue->cells[pos & queue->mask];
+      diff = (intptr_t) atomic_load_explicit (&cell->sequence,
+                                              memory_order_acquire) -
+             (intptr_t) pos;
+      if (diff == 0) {
+         if (atomic_compare_exchange_weak_explicit (&queue->enqueue_pos,
+                                                    &pos,
+                                                    pos + 1,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed)) {
+            break;
+         }
+      } else if (diff < 0) {
+         /* full */
+         return false;
+      } else {
+         pos = atomic_load_explicit (&queue->enqueue_pos,
+                                     memory_order_relaxed);
+      }
+   }
+
+   cell->batch = batch;
+   atomic_store_explicit (&cell->sequence, pos + 1, memory_order_release);
+
+   return true;
+}
+
+
+static import_batch_t *
+_import_queue_pop (import_queue_t *queue)
+{
+   import_queue_cell_t *cell;
+   import_batch_t *batch;
+   size_t pos;
+   intptr_t diff;
+
+   pos = atomic_load_explicit (&queue->dequeue_pos, memory_order_relaxed);
+   for (;;) {
+      cell = &queue->cells[pos & queue->mask];
+      diff = (intptr_t) atomic_load_explicit (&cell->sequence,
+                                              memory_order_acquire) -
+             (intptr_t) (pos + 1);
+      if (diff == 0) {
+         if (atomic_compare_exchange_weak_explicit (&queue->dequeue_pos,
+                                                    &pos,
+                                                    pos + 1,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed)) {
+            break;
+         }
+      } else if (diff < 0) {
+         /* empty */
+         return NULL;
+      } else {
+         pos = atomic_load_explicit (&queue->dequeue_pos,
+                                     memory_order_relaxed);
+      }
+   }
+
+   batch = cell->batch;
+   atomic_store_explicit (
+      &cell->sequence, pos + queue->mask + 1, memory_order_release);
+
+   return batch;
+}
+
+
+/* push, yielding while the queue is full, and count the time stalled */
+static void
+_import_queue_push_wait (import_queue_t *queue,
+                         import_batch_t *batch,
+                         import_stage_context_t *ctx)
+{
+   int64_t start;
+
+   if (_import_queue_push (queue, batch)) {
+      return;
+   }
+
+   start = bson_get_monotonic_time ();
+   while (!_import_queue_push (queue, batch)) {
+      sched_yield ();
+   }
+
+   ctx->stall_usec += bson_get_monotonic_time () - start;
+}
+
+
+static import_batch_t *
+_import_queue_pop_wait (import_queue_t *queue, import_stage_context_t *ctx)
+{
+   import_batch_t *batch;
+   int64_t start;
+
+   if ((batch = _import_queue_pop (queue))) {
+      return batch;
+   }
+
+   start = bson_get_monotonic_time ();
+   while (!(batch = _import_queue_pop (queue))) {
+      sched_yield ();
+   }
+
+   ctx->stall_usec += bson_get_monotonic_time () - start;
+
+   return batch;
+}
+
+
+/* batches keep their buffers across runs, so parsing doesn't allocate once
+ * they have grown */
+static void
+_import_batch_append (import_batch_t *batch, const bson_t *doc)
+{
+   while (batch->len + doc->len > batch->sz) {
+      batch->sz = batch->sz ? batch->sz * 2 : 1024 * 1024;
+      batch->data = bson_realloc (batch->data, batch->sz);
+   }
+
+   memcpy (batch->data + batch->len, bson_get_data (doc), doc->len);
+   batch->len += doc->len;
+   batch->n_docs++;
+}
+
+
+static void
+_import_parse_file (import_stage_context_t *ctx, int offset)
+{
+   import_test_t *import_test;
+   import_pipeline_t *pipeline;
+   bson_json_reader_t *reader;
+   import_batch_t *batch;
+   bson_error_t error;
+   bson_t bson = BSON_INITIALIZER;
+   int r;
+
+   import_test = ctx->test;
+   pipeline = import_test->pipeline;
+   reader = bson_json_reader_new_from_file (import_test->paths[offset], &error);
+   if (!reader) {
+      MONGOC_ERROR ("%s\n", error.message);
+      abort ();
+   }
+
+   batch = NULL;
+   while ((r = bson_json_reader_read (reader, &bson, &error))) {
+      if (r < 0) {
+         MONGOC_ERROR ("reader_read: %s\n", error.message);
+         abort ();
+      }
+
+      if (import_test->add_file_id) {
+         BSON_APPEND_UTF8 (&bson, "file", import_test->filenames[offset]);
+      }
+
+      if (!batch) {
+         batch = _import_queue_pop_wait (&pipeline->free, ctx);
+         batch->len = 0;
+         batch->n_docs = 0;
+      }
+
+      _import_batch_append (batch, &bson);
+      if (batch->n_docs == IMPORT_BATCH_DOCS) {
+         _import_queue_push_wait (&pipeline->full, batch, ctx);
+         batch = NULL;
+      }
+
+      bson_reinit (&bson);
+   }
+
+   if (batch) {
+      _import_queue_push_wait (&pipeline->full, batch, ctx);
+   }
+
+   bson_destroy (&bson);
+   bson_json_reader_destroy (reader);
+}
+
+
+static void
+_import_parser (import_stage_context_t *ctx)
+{
+   import_test_t *import_test;
+   import_pipeline_t *pipeline;
+   int offset;
+   int i;
+
+   import_test = ctx->test;
+   pipeline = import_test->pipeline;
+   while ((offset = atomic_fetch_add (&pipeline->next_file, 1)) <
+          import_test->cnt) {
+      _import_parse_file (ctx, offset);
+   }
+
+   /* the last parser out tells each writer to stop */
+   if (atomic_fetch_sub (&pipeline->parsers_running, 1) == 1) {
+      for (i = 0; i < import_test->n_writers; i++) {
+         _import_queue_push_wait (&pipeline->full, &IMPORT_BATCH_END, ctx);
+      }
+   }
+}
+
+
+static void
+_import_writer (import_stage_context_t *ctx)
+{
+   import_pipeline_t *pipeline;
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   import_batch_t *batch;
+   bson_reader_t *reader;
+   const bson_t *doc;
+   bson_error_t error;
+   bson_t opts = BSON_INITIALIZER;
+
+   pipeline = ctx->test->pipeline;
+   collection =
+      mongoc_client_get_collection (ctx->client, "perftest", "corpus");
+   BSON_APPEND_BOOL (&opts, "validate", false);
+
+   while ((batch = _import_queue_pop_wait (&pipeline->full, ctx)) !=
+          &IMPORT_BATCH_END) {
+      bulk =
+         mongoc_collection_create_bulk_operation_with_opts (collection, NULL);
+      reader = bson_reader_new_from_data (batch->data, batch->len);
+      while ((doc = bson_reader_read (reader, NULL))) {
+         if (!mongoc_bulk_operation_insert_with_opts (
+                bulk, doc, &opts, &error)) {
+            MONGOC_ERROR ("Error appending bulk insert: %s\n",
+                          error.message);
+            abort ();
+         }
+      }
+
+      bson_reader_destroy (reader);
+
+      /* the bulk has copied the documents: recycle the batch before the
+       * round trip */
+      _import_queue_push_wait (&pipeline->free, batch, ctx);
+
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk_operation_execute: %s\n", error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+   }
+
+   bson_destroy (&opts);
+   mongoc_collection_destroy (collection);
+}
+
+
+static void *
+_import_stage_thread (void *p)
+{
+   import_stage_context_t *ctx;
+
+   ctx = (import_stage_context_t *) p;
+   if (ctx->writer) {
+      _import_writer (ctx);
+   } else {
+      _import_parser (ctx);
+   }
+
+   return (void *) 1;
+}
+
+
+/* call once the pool exists */
+static void
+_import_pipeline_setup (import_test_t *import_test)
+{
+   import_pipeline_t *pipeline;
+   import_stage_context_t *ctx;
+   int n;
+   int i;
+
+   pipeline =
+      (import_pipeline_t *) bson_malloc0 (sizeof (import_pipeline_t));
+   import_test->pipeline = pipeline;
+   _import_queue_init (&pipeline->free, IMPORT_PIPELINE_BATCHES);
+   _import_queue_init (&pipeline->full, IMPORT_PIPELINE_BATCHES);
+   for (i = 0; i < IMPORT_PIPELINE_BATCHES; i++) {
+      BSON_ASSERT (_import_queue_push (&pipeline->free, &pipeline->batches[i]));
+   }
+
+   n = import_test->n_parsers + import_test->n_writers;
+   pipeline->contexts = (import_stage_context_t *) bson_malloc0 (
+      n * sizeof (import_stage_context_t));
+   for (i = 0; i < n; i++) {
+      ctx = &pipeline->contexts[i];
+      ctx->test = import_test;
+      if (i >= import_test->n_parsers) {
+         ctx->writer = true;
+         ctx->client = mongoc_client_pool_pop (import_test->pool);
+      }
+   }
+
+   perf_workers_init (&pipeline->workers, n);
+}
+
+
+static void
+_import_pipeline_run (import_test_t *import_test)
+{
+   import_pipeline_t *pipeline;
+
+   pipeline = import_test->pipeline;
+   atomic_store (&pipeline->next_file, 0);
+   atomic_store (&pipeline->parsers_running, import_test->n_parsers);
+   perf_workers_run (&pipeline->workers,
+                     _import_stage_thread,
+                     pipeline->contexts,
+                     sizeof (import_stage_context_t));
+}
+
+
+/* add "parser_utilization" and "writer_utilization", the fraction of each
+ * stage's thread time not spent waiting on a queue, and "parser_stall_sec"
+ * and "writer_stall_sec", that wait summed over the stage's threads per
+ * iteration */
+static void
+_import_pipeline_report (import_test_t *import_test)
+{
+   import_pipeline_t *pipeline;
+   perf_test_t *test;
+   int64_t stage_usec[2] = {0};
+   int64_t stall_usec[2] = {0};
+   int stage;
+   int i;
+
+   pipeline = import_test->pipeline;
+   test = &import_test->base;
+   perf_workers_report (test, &pipeline->workers);
+   if (!pipeline->workers.n_runs) {
+      return;
+   }
+
+   for (i = 0; i < pipeline->workers.n; i++) {
+      stage = pipeline->contexts[i].writer ? 1 : 0;
+      stage_usec[stage] += pipeline->workers.workers[i].total_usec;
+      stall_usec[stage] += pipeline->contexts[i].stall_usec;
+   }
+
+   perf_test_add_metric (
+      test,
+      "parser_utilization",
+      1.0 - (double) stall_usec[0] / BSON_MAX (stage_usec[0], 1));
+   perf_test_add_metric (
+      test,
+      "writer_utilization",
+      1.0 - (double) stall_usec[1] / BSON_MAX (stage_usec[1], 1));
+   perf_test_add_metric (test,
+                         "parser_stall_sec",
+                         (double) stall_usec[0] / 1e6 /
+                            pipeline->workers.n_runs);
+   perf_test_add_metric (test,
+                         "writer_stall_sec",
+                         (double) stall_usec[1] / 1e6 /
+                            pipeline->workers.n_runs);
+}
+
+
+static void
+_import_pipeline_destroy (import_test_t *import_test)
+{
+   import_pipeline_t *pipeline;
+   int i;
+
+   pipeline = import_test->pipeline;
+   perf_workers_destroy (&pipeline->workers);
+   for (i = 0; i < import_test->n_parsers + import_test->n_writers; i++) {
+      if (pipeline->contexts[i].client) {
+         mongoc_client_pool_push (import_test->pool,
+                                  pipeline->contexts[i].client);
+      }
+   }
+
+   for (i = 0; i < IMPORT_PIPELINE_BATCHES; i++) {
+      bson_free (pipeline->batches[i].data);
+   }
+
+   bson_free (pipeline->free.cells);
+   bson_free (pipeline->full.cells);
+   bson_free (pipeline->contexts);
+   bson_free (pipeline);
+   import_test->pipeline = NULL;
+}
+
+
+/* a thread with its own client that executes one bulk at a time for an
+ * importing thread, so the importer builds the next one meanwhile */
+typedef struct _import_flusher_t {
+   pthread_t thread;
+   mongoc_client_t *client;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   /* the bulk to execute, or NULL when idle */
+   mongoc_bulk_operation_t *bulk;
+   bool stop;
+} import_flusher_t;
+
+
+static void *
+_import_flusher_thread (void *p)
+{
+   import_flusher_t *flusher;
+   mongoc_bulk_operation_t *bulk;
+   bson_error_t error;
+
+   flusher = (import_flusher_t *) p;
+   pthread_mutex_lock (&flusher->mutex);
+   for (;;) {
+      while (!flusher->bulk && !flusher->stop) {
+         pthread_cond_wait (&flusher->cond, &flusher->mutex);
+      }
+
+      if (!flusher->bulk) {
+         break;
+      }
+
+      bulk = flusher->bulk;
+      pthread_mutex_unlock (&flusher->mutex);
+
+      mongoc_bulk_operation_set_client (bulk, flusher->client);
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk_operation_execute: %s\n", error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+
+      pthread_mutex_lock (&flusher->mutex);
+      flusher->bulk = NULL;
+      pthread_cond_broadcast (&flusher->cond);
+   }
+
+   pthread_mutex_unlock (&flusher->mutex);
+
+   return NULL;
+}
+
+
+static void
+_import_flushers_init (import_test_t *import_test)
+{
+   import_flusher_t *flusher;
+   int ret;
+   int i;
+
+   import_test->flushers = (import_flusher_t *) bson_malloc0 (
+      import_test->cnt * sizeof (import_flusher_t));
+   for (i = 0; i < import_test->cnt; i++) {
+      flusher = &import_test->flushers[i];
+      flusher->client = mongoc_client_pool_pop (import_test->pool);
+      pthread_mutex_init (&flusher->mutex, NULL);
+      pthread_cond_init (&flusher->cond, NULL);
+      ret = pthread_create (
+         &flusher->thread, NULL, _import_flusher_thread, flusher);
+      if (ret != 0) {
+         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
+         abort ();
+      }
+   }
+}
+
+
+static void
+_import_flushers_destroy (import_test_t *import_test)
+{
+   import_flusher_t *flusher;
+   int i;
+
+   for (i = 0; i < import_test->cnt; i++) {
+      flusher = &import_test->flushers[i];
+      pthread_mutex_lock (&flusher->mutex);
+      flusher->stop = true;
+      pthread_cond_broadcast (&flusher->cond);
+      pthread_mutex_unlock (&flusher->mutex);
+      pthread_join (flusher->thread, NULL);
+      pthread_mutex_destroy (&flusher->mutex);
+      pthread_cond_destroy (&flusher->cond);
+      mongoc_client_pool_push (import_test->pool, flusher->client);
+   }
+
+   bson_free (import_test->flushers);
+   import_test->flushers = NULL;
+}
+
+
+/* execute and destroy the bulk, or hand it to the flusher once the previous
+ * one is done */
+static void
+_import_flush (mongoc_bulk_operation_t *bulk, import_flusher_t *flusher)
+{
+   bson_error_t error;
+
+   if (!flusher) {
+      if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+         MONGOC_ERROR ("bulk_operation_execute: %s\n", error.message);
+         abort ();
+      }
+
+      mongoc_bulk_operation_destroy (bulk);
+      return;
+   }
+
+   pthread_mutex_lock (&flusher->mutex);
+   while (flusher->bulk) {
+      pthread_cond_wait (&flusher->cond, &flusher->mutex);
+   }
+
+   flusher->bulk = bulk;
+   pthread_cond_broadcast (&flusher->cond);
+   pthread_mutex_unlock (&flusher->mutex);
+}
+
+
+static void
+_import_flusher_drain (import_flusher_t *flusher)
+{
+   pthread_mutex_lock (&flusher->mutex);
+   while (flusher->bulk) {
+      pthread_cond_wait (&flusher->cond, &flusher->mutex);
+   }
+
+   pthread_mutex_unlock (&flusher->mutex);
+}
+
+
 static void
 import_setup (perf_test_t *test)
 {
@@ -60,16 +755,6 @@ import_setup (perf_test_t *test)
 
    import_test = (import_test_t *) test;
 
-   uri = mongoc_uri_new (NULL);
-   import_test->pool = mongoc_client_pool_new (uri);
-
-   client = mongoc_client_pool_pop (import_test->pool);
-   db = mongoc_client_get_database (client, "perftest");
-   if (!mongoc_database_drop (db, &error)) {
-      MONGOC_ERROR ("database_drop: %s\n", error.message);
-      abort ();
-   }
-
    data_dir = bson_strdup_printf ("%s/%s", g_test_dir, test->data_path);
    dirp = opendir (data_dir);
    if (!dirp) {
@@ -103,6 +788,42 @@ import_setup (perf_test_t *test)
 
    assert (i == import_test->cnt);
 
+   import_test->contexts = (import_thread_context_t *) bson_malloc (
+      import_test->cnt * sizeof (import_thread_context_t));
+   for (i = 0; i < import_test->cnt; i++) {
+      import_test->contexts[i].test = import_test;
+      import_test->contexts[i].offset = i;
+   }
+
+   if (import_test->n_processes) {
+      /* fork before the pool starts its background thread */
+      perf_processes_init (&import_test->processes,
+                           import_test->n_processes,
+                           _import_process_init,
+                           _import_process_run,
+                           import_test);
+   } else if (!import_test->n_parsers) {
+      perf_workers_init (&import_test->workers, import_test->cnt);
+   }
+
+   uri = _import_uri_new (import_test);
+   import_test->pool = mongoc_client_pool_new (uri);
+   perf_apm_instrument_pool (import_test->pool);
+   if (import_test->n_parsers) {
+      _import_pipeline_setup (import_test);
+   }
+
+   if (import_test->double_buffer) {
+      _import_flushers_init (import_test);
+   }
+
+   client = mongoc_client_pool_pop (import_test->pool);
+   db = mongoc_client_get_database (client, "perftest");
+   if (!mongoc_database_drop (db, &error)) {
+      MONGOC_ERROR ("database_drop: %s\n", error.message);
+      abort ();
+   }
+
    closedir (dirp);
    mongoc_database_destroy (db);
    mongoc_client_pool_push (import_test->pool, client);
@@ -170,8 +891,6 @@ import_before (perf_test_t *test)
       bson_destroy (create_indexes);
    }
 
-   import_test->threads = bson_malloc (import_test->cnt * sizeof (pthread_t));
-
    bson_destroy (&index_keys);
    bson_destroy (&cmd);
    mongoc_collection_destroy (collection);
@@ -180,28 +899,31 @@ import_before (perf_test_t *test)
 }
 
 
-static void *
-_import_thread (void *p)
+/* insert one file's documents with client, in one bulk or, with flush_docs
+ * or flush_bytes, several, executed by the flusher if it isn't NULL */
+static void
+_import_file (import_test_t *import_test,
+              mongoc_client_t *client,
+              import_flusher_t *flusher,
+              int offset)
 {
-   import_thread_context_t *ctx;
    bool add_file_id;
    bson_error_t error;
-   mongoc_client_t *client;
    mongoc_collection_t *collection;
    mongoc_bulk_operation_t *bulk;
    const char *path;
    bson_json_reader_t *reader;
    int r;
+   int n_docs;
+   int64_t n_bytes;
    bson_t bson = BSON_INITIALIZER;
    bson_t opts = BSON_INITIALIZER;
 
-   ctx = (import_thread_context_t *) p;
-   add_file_id = ctx->test->add_file_id;
-   client = mongoc_client_pool_pop (ctx->test->pool);
+   add_file_id = import_test->add_file_id;
    collection = mongoc_client_get_collection (client, "perftest", "corpus");
    bulk = mongoc_collection_create_bulk_operation_with_opts (collection, NULL);
 
-   path = ctx->test->paths[ctx->offset];
+   path = import_test->paths[offset];
    reader = bson_json_reader_new_from_file (path, &error);
    if (!reader) {
       MONGOC_ERROR ("%s\n", error.message);
@@ -210,6 +932,8 @@ _import_thread (void *p)
 
    BSON_APPEND_BOOL (&opts, "validate", false);
 
+   n_docs = 0;
+   n_bytes = 0;
    while ((r = bson_json_reader_read (reader, &bson, &error))) {
       if (r < 0) {
          MONGOC_ERROR ("reader_read: %s\n", error.message);
@@ -217,7 +941,7 @@ _import_thread (void *p)
       }
 
       if (add_file_id) {
-         BSON_APPEND_UTF8 (&bson, "file", ctx->test->filenames[ctx->offset]);
+         BSON_APPEND_UTF8 (&bson, "file", import_test->filenames[offset]);
       }
 
       if (!mongoc_bulk_operation_insert_with_opts (
@@ -225,22 +949,86 @@ _import_thread (void *p)
          MONGOC_ERROR ("Error appending bulk insert: %s\n", error.message);
          abort ();
       }
+
+      n_docs++;
+      n_bytes += bson.len;
+      if ((import_test->flush_docs && n_docs >= import_test->flush_docs) ||
+          (import_test->flush_bytes && n_bytes >= import_test->flush_bytes)) {
+         _import_flush (bulk, flusher);
+         bulk = mongoc_collection_create_bulk_operation_with_opts (collection,
+                                                                   NULL);
+         n_docs = 0;
+         n_bytes = 0;
+      }
+
       bson_reinit (&bson);
    }
 
-   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
-      MONGOC_ERROR ("bulk_operation_execute: %s\n", error.message);
-      abort ();
+   if (n_docs) {
+      _import_flush (bulk, flusher);
+   } else {
+      mongoc_bulk_operation_destroy (bulk);
+   }
+
+   if (flusher) {
+      _import_flusher_drain (flusher);
    }
 
    bson_destroy (&bson);
    bson_destroy (&opts);
    bson_json_reader_destroy (reader);
-   mongoc_bulk_operation_destroy (bulk);
    mongoc_collection_destroy (collection);
+}
+
+
+static void *
+_import_thread (void *p)
+{
+   import_thread_context_t *ctx;
+   mongoc_client_t *client;
+
+   ctx = (import_thread_context_t *) p;
+   client = mongoc_client_pool_pop (ctx->test->pool);
+   _import_file (ctx->test,
+                 client,
+                 ctx->test->flushers ? &ctx->test->flushers[ctx->offset] : NULL,
+                 ctx->offset);
    mongoc_client_pool_push (ctx->test->pool, client);
 
-   return (void *) 1;
+   return (void *) 1;
+}
+
+
+/* runs in each child, which has no pool */
+static void *
+_import_process_init (void *ctx, int index)
+{
+   import_process_state_t *state;
+   mongoc_uri_t *uri;
+
+   state = (import_process_state_t *) bson_malloc0 (
+      sizeof (import_process_state_t));
+   state->test = (import_test_t *) ctx;
+   state->index = index;
+   uri = _import_uri_new (state->test);
+   state->client = mongoc_client_new_from_uri (uri);
+   mongoc_uri_destroy (uri);
+
+   return state;
+}
+
+
+static void
+_import_process_run (void *p)
+{
+   import_process_state_t *state;
+   int i;
+
+   state = (import_process_state_t *) p;
+   for (i = state->index; i < state->test->cnt;
+        i += state->test->n_processes) {
+      _import_file (state->test, state->client, NULL, i);
+   }
 }
 
 
@@ -248,56 +1036,59 @@ static void
 import_task (perf_test_t *test)
 {
    import_test_t *import_test;
-   import_thread_context_t *contexts;
-   int i;
    void *r;
+   int i;
 
    import_test = (import_test_t *) test;
-   contexts = bson_malloc (import_test->cnt * sizeof (import_thread_context_t));
+   if (import_test->n_processes) {
+      perf_processes_run (&import_test->processes);
+      return;
+   }
 
-   for (i = 0; i < import_test->cnt; i++) {
-      contexts[i].test = import_test;
-      contexts[i].offset = i;
-      pthread_create (
-         &import_test->threads[i], NULL, _import_thread, (void *) &contexts[i]);
+   if (import_test->n_parsers) {
+      _import_pipeline_run (import_test);
+      return;
    }
 
-   for (i = 0; i < import_test->cnt; i++) {
-      if (pthread_join (import_test->threads[i], &r)) {
-         perror ("pthread_join");
-         abort ();
-      }
+   perf_workers_run (&import_test->workers,
+                     _import_thread,
+                     import_test->contexts,
+                     sizeof (import_thread_context_t));
 
+   for (i = 0; i < import_test->cnt; i++) {
+      r = import_test->workers.workers[i].result;
       if ((intptr_t) r != 1) {
          MONGOC_ERROR ("import_thread returned %p\n", r);
          abort ();
       }
    }
-
-   bson_free (contexts);
 }
 
 
 static void
-import_after (perf_test_t *test)
+import_teardown (perf_test_t *test)
 {
    import_test_t *import_test;
+   int i;
 
    import_test = (import_test_t *) test;
-   bson_free (import_test->threads);
-   import_test->threads = NULL;
-
-   perf_test_after (test);
-}
 
+   if (import_test->n_processes) {
+      perf_processes_report (test, &import_test->processes);
+      perf_processes_destroy (&import_test->processes);
+   } else if (import_test->n_parsers) {
+      _import_pipeline_report (import_test);
+      _import_pipeline_destroy (import_test);
+   } else {
+      perf_workers_report (test, &import_test->workers);
+      perf_workers_destroy (&import_test->workers);
+   }
 
-static void
-import_teardown (perf_test_t *test)
-{
-   import_test_t *import_test;
-   int i;
+   if (import_test->flushers) {
+      _import_flushers_destroy (import_test);
+   }
 
-   import_test = (import_test_t *) test;
+   bson_free (import_test->contexts);
 
    for (i = 0; i < import_test->cnt; i++) {
       bson_free (import_test->filenames[i]);
@@ -323,8 +1114,8 @@ import_init (import_test_t *import_test)
    import_test->base.setup = import_setup;
    import_test->base.before = import_before;
    import_test->base.task = import_task;
-   import_test->base.after = import_after;
    import_test->base.teardown = import_teardown;
+   import_test->compression_level = -1;
 }
 
 
@@ -340,21 +1131,184 @@ import_perf_new (void)
 }
 
 
+/* like import_perf_new, importing in n_processes processes */
+static perf_test_t *
+import_processes_perf_new (int n_processes)
+{
+   import_test_t *import_test;
+
+   import_test = (import_test_t *) import_perf_new ();
+   import_test->n_processes = n_processes;
+   bson_snprintf (import_test->name,
+                  sizeof (import_test->name),
+                  "%s/Processes:%d",
+                  import_test->base.name,
+                  n_processes);
+   import_test->base.name = import_test->name;
+
+   return (perf_test_t *) import_test;
+}
+
+
+/* like import_perf_new, with n_parsers threads parsing files into batches
+ * for n_writers threads to insert */
+static perf_test_t *
+import_pipeline_perf_new (int n_parsers, int n_writers)
+{
+   import_test_t *import_test;
+
+   import_test = (import_test_t *) import_perf_new ();
+   import_test->n_parsers = n_parsers;
+   import_test->n_writers = n_writers;
+   bson_snprintf (import_test->name,
+                  sizeof (import_test->name),
+                  "%s/Pipeline/Parsers:%d/Writers:%d",
+                  import_test->base.name,
+                  n_parsers,
+                  n_writers);
+   import_test->base.name = import_test->name;
+
+   return (perf_test_t *) import_test;
+}
+
+
+/* like import_perf_new, reporting peak RSS. With flush_docs or flush_bytes,
+ * each thread streams its file in bulks of that size, optionally double
+ * buffered */
+static perf_test_t *
+import_streaming_perf_new (int flush_docs,
+                           int64_t flush_bytes,
+                           bool double_buffer)
+{
+   import_test_t *import_test;
+   size_t len;
+
+   import_test = (import_test_t *) import_perf_new ();
+   import_test->flush_docs = flush_docs;
+   import_test->flush_bytes = flush_bytes;
+   import_test->double_buffer = double_buffer;
+   import_test->base.report_peak_rss = true;
+   if (!flush_docs && !flush_bytes) {
+      return (perf_test_t *) import_test;
+   }
+
+   if (flush_docs) {
+      len = bson_snprintf (import_test->name,
+                           sizeof (import_test->name),
+                           "%s/Flush/Docs:%d",
+                           import_test->base.name,
+                           flush_docs);
+   } else {
+      len = bson_snprintf (import_test->name,
+                           sizeof (import_test->name),
+                           "%s/Flush/MB:%" PRId64,
+                           import_test->base.name,
+                           flush_bytes / (1024 * 1024));
+   }
+
+   if (double_buffer) {
+      bson_snprintf (import_test->name + len,
+                     sizeof (import_test->name) - len,
+                     "/DoubleBuffer");
+   }
+
+   import_test->base.name = import_test->name;
+
+   return (perf_test_t *) import_test;
+}
+
+
+static void
+_compressed_test_name (char *name,
+                       size_t name_sz,
+                       const char *base_name,
+                       const char *compressor,
+                       int32_t level)
+{
+   if (level >= 0) {
+      bson_snprintf (name,
+                     name_sz,
+                     "%s/Compressor:%s/Level:%d",
+                     base_name,
+                     compressor,
+                     level);
+   } else {
+      bson_snprintf (name,
+                     name_sz,
+                     "%s/Compressor:%s",
+                     base_name,
+                     compressor ? compressor : "none");
+   }
+}
+
+
+static perf_test_t *
+import_compressed_perf_new (const char *compressor, int32_t level)
+{
+   import_test_t *import_test;
+
+   import_test = (import_test_t *) import_perf_new ();
+   import_test->compressor = compressor;
+   import_test->compression_level = level;
+   _compressed_test_name (import_test->name,
+                          sizeof (import_test->name),
+                          import_test->base.name,
+                          compressor,
+                          level);
+   import_test->base.name = import_test->name;
+   import_test->base.report_wire_bytes = true;
+
+   return (perf_test_t *) import_test;
+}
+
+
 /*
  *  -------- LDJSON MULTI-FILE EXPORT BENCHMARK -------------------------------
  */
 
+/* a buffered export writes its buffer once it holds this much */
+#define EXPORT_BATCH_SZ (1024 * 1024)
+
+typedef enum {
+   /* bson_as_legacy_extended_json, without newlines */
+   EXPORT_LEGACY,
+   EXPORT_RELAXED,
+   EXPORT_CANONICAL,
+} export_format_t;
+
 typedef struct {
    perf_test_t base;
    mongoc_client_pool_t *pool;
    int cnt;
-   pthread_t *threads;
+   /* a worker and a context per file */
+   perf_workers_t workers;
+   struct _export_thread_context_t *contexts;
+   export_format_t format;
+   /* serialize with perf_json_append_document into a buffer each context
+    * keeps across iterations and write it with write (2) every
+    * EXPORT_BATCH_SZ, instead of a new string per document and stdio */
+   bool buffered;
+   /* report docs_per_sec, allocations_per_doc and write_syscalls_per_mb */
+   bool report_io;
+   int64_t task_usec;
+   /* write syscalls during the tasks, or -1 if /proc/self/io is missing */
+   int64_t syscw;
+   /* optional wire compression, and zlib level or -1 */
+   const char *compressor;
+   int32_t compression_level;
+   char name[128];
 } export_test_t;
 
 
-typedef struct {
+typedef struct _export_thread_context_t {
    export_test_t *test;
    int offset;
+   perf_json_buf_t buf;
+   /* totals over all iterations, allocations counted on the worker thread
+    * while it reads the cursor and serializes */
+   int64_t n_docs;
+   int64_t n_bytes;
+   int64_t n_allocations;
 } export_thread_context_t;
 
 
@@ -371,18 +1325,113 @@ _setup_load_docs (void)
 }
 
 
+static char *
+_export_json (const bson_t *doc, export_format_t format, size_t *sz)
+{
+   switch (format) {
+   case EXPORT_RELAXED:
+      return bson_as_relaxed_extended_json (doc, sz);
+   case EXPORT_CANONICAL:
+      return bson_as_canonical_extended_json (doc, sz);
+   case EXPORT_LEGACY:
+   default:
+      return bson_as_legacy_extended_json (doc, sz);
+   }
+}
+
+
+static perf_json_mode_t
+_export_mode (export_format_t format)
+{
+   return format == EXPORT_CANONICAL ? PERF_JSON_CANONICAL : PERF_JSON_RELAXED;
+}
+
+
+/* check that perf_json_append_document writes the same bytes as libbson for
+ * every document in the corpus, so the buffered export is comparable */
+static void
+_export_check_format (export_test_t *export_test)
+{
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   bson_t query = BSON_INITIALIZER;
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   perf_json_buf_t buf = {0};
+   perf_json_mode_t mode;
+   char *json;
+   size_t sz;
+   bson_error_t error;
+
+   mode = _export_mode (export_test->format);
+   client = mongoc_client_pool_pop (export_test->pool);
+   collection = mongoc_client_get_collection (client, "perftest", "corpus");
+#if MONGOC_CHECK_VERSION(1, 5, 0)
+   cursor = mongoc_collection_find_with_opts (collection, &query, NULL, NULL);
+#else
+   cursor = mongoc_collection_find (
+      collection, MONGOC_QUERY_NONE, 0, 0, 0, &query, NULL, NULL);
+#endif
+   while (mongoc_cursor_next (cursor, &doc)) {
+      buf.len = 0;
+      perf_json_append_document (&buf, doc, mode);
+      json = _export_json (doc, export_test->format, &sz);
+      if (sz != buf.len || memcmp (json, buf.data, sz) != 0) {
+         MONGOC_ERROR ("perf_json_append_document wrote:\n%.*s\n"
+                       "libbson wrote:\n%s\n",
+                       (int) buf.len,
+                       buf.data,
+                       json);
+         abort ();
+      }
+
+      bson_free (json);
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      MONGOC_ERROR ("cursor error: %s\n", error.message);
+      abort ();
+   }
+
+   perf_json_buf_destroy (&buf);
+   mongoc_cursor_destroy (cursor);
+   mongoc_collection_destroy (collection);
+   mongoc_client_pool_push (export_test->pool, client);
+}
+
+
 static void
 export_setup (perf_test_t *test)
 {
    export_test_t *export_test;
    mongoc_uri_t *uri;
+   int i;
 
    _setup_load_docs ();
    perf_test_setup (test);
 
    export_test = (export_test_t *) test;
-   uri = mongoc_uri_new (NULL);
+   uri = perf_uri_new ();
+   if (export_test->compressor) {
+      set_uri_compressor (
+         uri, export_test->compressor, export_test->compression_level);
+   }
+
    export_test->pool = mongoc_client_pool_new (uri);
+   perf_apm_instrument_pool (export_test->pool);
+   if (export_test->buffered) {
+      _export_check_format (export_test);
+   }
+
+   export_test->cnt = 100; /* DANGER!: assumes test corpus won't change */
+   export_test->contexts = (export_thread_context_t *) bson_malloc0 (
+      export_test->cnt * sizeof (export_thread_context_t));
+   for (i = 0; i < export_test->cnt; i++) {
+      export_test->contexts[i].test = export_test;
+      export_test->contexts[i].offset = i;
+   }
+
+   perf_workers_init (&export_test->workers, export_test->cnt);
 
    mongoc_uri_destroy (uri);
 }
@@ -391,14 +1440,30 @@ export_setup (perf_test_t *test)
 static void
 export_before (perf_test_t *test)
 {
-   export_test_t *export_test;
-
    prep_tmp_dir (test->data_path);
    perf_test_before (test);
+}
 
-   export_test = (export_test_t *) test;
-   export_test->cnt = 100; /* DANGER!: assumes test corpus won't change */
-   export_test->threads = bson_malloc (export_test->cnt * sizeof (pthread_t));
+
+static void
+_export_write (int fd, const char *data, size_t len)
+{
+   ssize_t n;
+
+   while (len > 0) {
+      n = write (fd, data, len);
+      if (n < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+
+         perror ("write");
+         abort ();
+      }
+
+      data += n;
+      len -= (size_t) n;
+   }
 }
 
 
@@ -406,28 +1471,45 @@ static void *
 _export_thread (void *p)
 {
    export_thread_context_t *ctx;
+   export_test_t *export_test;
    char filename[PATH_MAX];
    char path[PATH_MAX];
-   FILE *fp;
+   FILE *fp = NULL;
+   int fd = -1;
    mongoc_client_t *client;
    mongoc_collection_t *collection;
    bson_t query = BSON_INITIALIZER;
    mongoc_cursor_t *cursor;
    const bson_t *doc;
+   perf_json_buf_t *buf;
+   perf_json_mode_t mode;
    char *json;
    size_t sz;
    size_t total_sz;
+   int64_t n_docs;
+   int64_t allocations;
    bson_error_t error;
 
    ctx = (export_thread_context_t *) p;
+   export_test = ctx->test;
+   buf = &ctx->buf;
+   mode = _export_mode (export_test->format);
 
    /* these filenames are 0-indexed */
    bson_snprintf (filename, PATH_MAX, "ldjson%03d.txt", ctx->offset);
    bson_snprintf (path, PATH_MAX, "/tmp/TestJsonMultiExport/%s", filename);
-   fp = fopen (path, "w+");
-   if (!fp) {
-      perror ("fopen");
-      abort ();
+   if (export_test->buffered) {
+      fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) {
+         perror ("open");
+         abort ();
+      }
+   } else {
+      fp = fopen (path, "w+");
+      if (!fp) {
+         perror ("fopen");
+         abort ();
+      }
    }
 
    client = mongoc_client_pool_pop (ctx->test->pool);
@@ -440,13 +1522,37 @@ _export_thread (void *p)
       collection, MONGOC_QUERY_NONE, 0, 0, 0, &query, NULL, NULL);
 #endif
    total_sz = 0;
+   n_docs = 0;
+   allocations = perf_thread_allocations ();
    while (mongoc_cursor_next (cursor, &doc)) {
-      json = bson_as_legacy_extended_json (doc, &sz);
+      n_docs++;
+      if (export_test->buffered) {
+         perf_json_append_document (buf, doc, mode);
+         perf_json_buf_append (buf, "\n", 1);
+         if (buf->len >= EXPORT_BATCH_SZ) {
+            _export_write (fd, buf->data, buf->len);
+            total_sz += buf->len;
+            buf->len = 0;
+         }
+
+         continue;
+      }
+
+      json = _export_json (doc, export_test->format, &sz);
       if (fwrite (json, sizeof (char), sz, fp) < sz) {
          perror ("fwrite");
          abort ();
       }
 
+      if (export_test->format != EXPORT_LEGACY) {
+         if (fputc ('\n', fp) == EOF) {
+            perror ("fputc");
+            abort ();
+         }
+
+         sz++;
+      }
+
       bson_free (json);
       total_sz += sz;
    }
@@ -456,9 +1562,24 @@ _export_thread (void *p)
       abort ();
    }
 
+   if (buf->len) {
+      _export_write (fd, buf->data, buf->len);
+      total_sz += buf->len;
+      buf->len = 0;
+   }
+
+   ctx->n_allocations += perf_thread_allocations () - allocations;
+   ctx->n_docs += n_docs;
+   ctx->n_bytes += (int64_t) total_sz;
+
    assert (total_sz > 0);
 
-   fclose (fp);
+   if (export_test->buffered) {
+      close (fd);
+   } else {
+      fclose (fp);
+   }
+
    mongoc_cursor_destroy (cursor);
    mongoc_collection_destroy (collection);
    mongoc_client_pool_push (ctx->test->pool, client);
@@ -471,46 +1592,64 @@ static void
 export_task (perf_test_t *test)
 {
    export_test_t *export_test;
-   export_thread_context_t *contexts;
-   int i;
+   int64_t start;
+   int64_t syscw;
    void *r;
+   int i;
 
    export_test = (export_test_t *) test;
-   contexts = bson_malloc (export_test->cnt * sizeof (export_thread_context_t));
-
-   for (i = 0; i < export_test->cnt; i++) {
-      contexts[i].test = export_test;
-      contexts[i].offset = i;
-      pthread_create (
-         &export_test->threads[i], NULL, _export_thread, (void *) &contexts[i]);
+   start = bson_get_monotonic_time ();
+   syscw = perf_proc_io ("syscw");
+   perf_workers_run (&export_test->workers,
+                     _export_thread,
+                     export_test->contexts,
+                     sizeof (export_thread_context_t));
+   export_test->task_usec += bson_get_monotonic_time () - start;
+   if (syscw < 0 || export_test->syscw < 0) {
+      export_test->syscw = -1;
+   } else {
+      export_test->syscw += perf_proc_io ("syscw") - syscw;
    }
 
    for (i = 0; i < export_test->cnt; i++) {
-      if (pthread_join (export_test->threads[i], &r)) {
-         perror ("pthread_join");
-         abort ();
-      }
-
+      r = export_test->workers.workers[i].result;
       if ((intptr_t) r != 1) {
          MONGOC_ERROR ("export_thread returned %p\n", r);
          abort ();
       }
    }
-
-   bson_free (contexts);
 }
 
 
 static void
-export_after (perf_test_t *test)
+_export_report_io (export_test_t *export_test)
 {
-   export_test_t *export_test;
+   perf_test_t *test;
+   int64_t n_docs = 0;
+   int64_t n_bytes = 0;
+   int64_t n_allocations = 0;
+   int i;
 
-   export_test = (export_test_t *) test;
-   bson_free (export_test->threads);
-   export_test->threads = NULL;
+   test = &export_test->base;
+   for (i = 0; i < export_test->cnt; i++) {
+      n_docs += export_test->contexts[i].n_docs;
+      n_bytes += export_test->contexts[i].n_bytes;
+      n_allocations += export_test->contexts[i].n_allocations;
+   }
+
+   if (!n_docs || !export_test->task_usec) {
+      return;
+   }
 
-   perf_test_after (test);
+   perf_test_add_metric (
+      test, "docs_per_sec", n_docs * 1e6 / export_test->task_usec);
+   perf_test_add_metric (
+      test, "allocations_per_doc", (double) n_allocations / n_docs);
+   if (export_test->syscw >= 0 && n_bytes) {
+      perf_test_add_metric (test,
+                            "write_syscalls_per_mb",
+                            export_test->syscw / (n_bytes / 1048576.0));
+   }
 }
 
 
@@ -518,8 +1657,20 @@ static void
 export_teardown (perf_test_t *test)
 {
    export_test_t *export_test;
+   int i;
 
    export_test = (export_test_t *) test;
+   perf_workers_report (test, &export_test->workers);
+   if (export_test->report_io) {
+      _export_report_io (export_test);
+   }
+
+   perf_workers_destroy (&export_test->workers);
+   for (i = 0; i < export_test->cnt; i++) {
+      perf_json_buf_destroy (&export_test->contexts[i].buf);
+   }
+
+   bson_free (export_test->contexts);
    mongoc_client_pool_destroy (export_test->pool);
 
    perf_test_teardown (test);
@@ -535,8 +1686,8 @@ export_init (export_test_t *export_test)
    export_test->base.setup = export_setup;
    export_test->base.before = export_before;
    export_test->base.task = export_task;
-   export_test->base.after = export_after;
    export_test->base.teardown = export_teardown;
+   export_test->compression_level = -1;
 }
 
 
@@ -552,6 +1703,50 @@ export_perf_new (void)
 }
 
 
+static perf_test_t *
+export_compressed_perf_new (const char *compressor, int32_t level)
+{
+   export_test_t *export_test;
+
+   export_test = (export_test_t *) export_perf_new ();
+   export_test->compressor = compressor;
+   export_test->compression_level = level;
+   _compressed_test_name (export_test->name,
+                          sizeof (export_test->name),
+                          export_test->base.name,
+                          compressor,
+                          level);
+   export_test->base.name = export_test->name;
+   export_test->base.report_wire_bytes = true;
+
+   return (perf_test_t *) export_test;
+}
+
+
+static perf_test_t *
+export_format_perf_new (export_format_t format, bool buffered)
+{
+   const char *formats[] = {"legacy", "relaxed", "canonical"};
+   export_test_t *export_test;
+
+   export_test = (export_test_t *) export_perf_new ();
+   export_test->format = format;
+   export_test->buffered = buffered;
+   export_test->report_io = true;
+   if (format != EXPORT_LEGACY) {
+      bson_snprintf (export_test->name,
+                     sizeof (export_test->name),
+                     "%s%s/Format:%s",
+                     export_test->base.name,
+                     buffered ? "/Buffered" : "",
+                     formats[format]);
+      export_test->base.name = export_test->name;
+   }
+
+   return (perf_test_t *) export_test;
+}
+
+
 void
 parallel_perf (void)
 {
@@ -563,3 +1758,132 @@ parallel_perf (void)
 
    run_perf_tests (tests);
 }
+
+
+/* the import and export over each compressor libmongoc was built with */
+void
+parallel_compression_perf (void)
+{
+   perf_test_t *tests[] = {
+      import_compressed_perf_new (NULL, -1),
+      export_compressed_perf_new (NULL, -1),
+#ifdef MONGOC_ENABLE_COMPRESSION_SNAPPY
+      import_compressed_perf_new ("snappy", -1),
+      export_compressed_perf_new ("snappy", -1),
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZSTD
+      import_compressed_perf_new ("zstd", -1),
+      export_compressed_perf_new ("zstd", -1),
+#endif
+#ifdef MONGOC_ENABLE_COMPRESSION_ZLIB
+      import_compressed_perf_new ("zlib", 1),
+      export_compressed_perf_new ("zlib", 1),
+      import_compressed_perf_new ("zlib", 6),
+      export_compressed_perf_new ("zlib", 6),
+      import_compressed_perf_new ("zlib", 9),
+      export_compressed_perf_new ("zlib", 9),
+#endif
+      NULL,
+   };
+
+   run_perf_tests (tests);
+}
+
+
+/* the 100-thread import next to the same import in 100 processes */
+void
+parallel_processes_perf (void)
+{
+   perf_test_t *tests[] = {
+      import_perf_new (),
+      import_processes_perf_new (100),
+      NULL,
+   };
+
+   run_perf_tests (tests);
+}
+
+
+/* the thread-per-file import next to pipelines of several shapes, or of the
+ * one from --pipeline */
+void
+parallel_pipeline_perf (void)
+{
+   const int parsers[] = {1, 2, 4, 8};
+   const int writers[] = {1, 4, 16};
+   perf_test_t *tests[1 + 4 * 3 + 1];
+   int n_parsers;
+   int n_writers;
+   size_t n;
+   size_t i;
+   size_t j;
+
+   n = 0;
+   tests[n++] = import_perf_new ();
+   if (perf_pipeline_shape (&n_parsers, &n_writers)) {
+      tests[n++] = import_pipeline_perf_new (n_parsers, n_writers);
+      tests[n] = NULL;
+      run_perf_tests (tests);
+      return;
+   }
+
+   for (i = 0; i < sizeof (parsers) / sizeof (parsers[0]); i++) {
+      for (j = 0; j < sizeof (writers) / sizeof (writers[0]); j++) {
+         tests[n++] = import_pipeline_perf_new (parsers[i], writers[j]);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/* one bulk per file next to bulks of bounded size */
+void
+parallel_streaming_perf (void)
+{
+   const int flush_docs[] = {100, 1000, 10000};
+   const int64_t flush_mb[] = {1, 4};
+   perf_test_t *tests[1 + (3 + 2) * 2 + 1];
+   size_t n;
+   size_t i;
+   int double_buffer;
+
+   n = 0;
+   tests[n++] = import_streaming_perf_new (0, 0, false);
+   for (double_buffer = 0; double_buffer < 2; double_buffer++) {
+      for (i = 0; i < sizeof (flush_docs) / sizeof (flush_docs[0]); i++) {
+         tests[n++] =
+            import_streaming_perf_new (flush_docs[i], 0, double_buffer);
+      }
+
+      for (i = 0; i < sizeof (flush_mb) / sizeof (flush_mb[0]); i++) {
+         tests[n++] = import_streaming_perf_new (
+            0, flush_mb[i] * 1024 * 1024, double_buffer);
+      }
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
+
+
+/* the legacy export next to relaxed and canonical Extended JSON, each
+ * serialized by libbson into a string per document, then into reusable
+ * buffers */
+void
+parallel_export_perf (void)
+{
+   perf_test_t *tests[] = {
+      export_format_perf_new (EXPORT_LEGACY, false),
+      export_format_perf_new (EXPORT_RELAXED, false),
+      export_format_perf_new (EXPORT_CANONICAL, false),
+      export_format_perf_new (EXPORT_RELAXED, true),
+      export_format_perf_new (EXPORT_CANONICAL, true),
+      NULL,
+   };
+
+   run_perf_tests (tests);
+}
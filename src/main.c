@@ -25,13 +25,126 @@ gridfs_perf (void);
 extern void
 parallel_perf (void);
 extern void
+parallel_compression_perf (void);
+extern void
+parallel_pipeline_perf (void);
+extern void
+parallel_streaming_perf (void);
+extern void
+parallel_export_perf (void);
+extern void
+ldjson_parse_perf (void);
+extern void
 gridfs_parallel_perf (void);
 extern void
 parallel_client_perf (void);
+extern void
+parallel_client_pool_size_perf (void);
+extern void
+connection_perf (void);
+extern void
+driver_concern_perf (void);
+extern void
+driver_aggregate_perf (void);
+extern void
+driver_multi_ns_perf (void);
+extern void
+driver_bulk_split_perf (void);
+extern void
+driver_compression_perf (void);
+extern void
+driver_write_op_perf (void);
+extern void
+auth_perf (void);
+extern void
+server_selection_perf (void);
+extern void
+encryption_perf (void);
+extern void
+ycsb_perf (void);
+extern void
+driver_observe_perf (void);
+extern void
+parallel_client_observe_perf (void);
+extern void
+driver_replset_perf (void);
+extern void
+parallel_client_replset_perf (void);
+extern void
+parallel_processes_perf (void);
+extern void
+parallel_client_processes_perf (void);
+
+static void
+observe_perf (void)
+{
+   driver_observe_perf ();
+   parallel_client_observe_perf ();
+}
+
+static void
+replset_perf (void)
+{
+   driver_replset_perf ();
+   parallel_client_replset_perf ();
+}
+
+static void
+processes_perf (void)
+{
+   parallel_client_processes_perf ();
+   parallel_processes_perf ();
+}
+
+static void
+compression_perf (void)
+{
+   driver_compression_perf ();
+   parallel_compression_perf ();
+}
+
+typedef struct {
+   const char *name;
+   void (*run) (void);
+   /* only run when selected with --suite, e.g. it needs a replica set */
+   bool opt_in;
+} perf_suite_t;
+
+static const perf_suite_t suites[] = {
+   {"bson", bson_perf, false},
+   {"driver", driver_perf, false},
+   {"gridfs", gridfs_perf, false},
+   {"ldjson", parallel_perf, false},
+   {"gridfs-parallel", gridfs_parallel_perf, false},
+   {"parallel-client", parallel_client_perf, false},
+   {"connection", connection_perf, true},
+   {"concern", driver_concern_perf, true},
+   {"write-ops", driver_write_op_perf, true},
+   {"compression", compression_perf, true},
+   {"bulk-split", driver_bulk_split_perf, true},
+   {"multi-ns", driver_multi_ns_perf, true},
+   {"aggregate", driver_aggregate_perf, true},
+   {"auth", auth_perf, true},
+   {"observe", observe_perf, true},
+   {"replset", replset_perf, true},
+   {"selection", server_selection_perf, true},
+   {"encryption", encryption_perf, true},
+   {"ycsb", ycsb_perf, true},
+   {"pool-size", parallel_client_pool_size_perf, true},
+   {"processes", processes_perf, true},
+   {"ldjson-pipeline", parallel_pipeline_perf, true},
+   {"ldjson-streaming", parallel_streaming_perf, true},
+   {"ldjson-export", parallel_export_perf, true},
+   {"ldjson-parse", ldjson_parse_perf, true},
+   {NULL, NULL, false},
+};
 
 int
 main (int argc, char **argv)
 {
+   const perf_suite_t *suite;
+
+   perf_mem_init ();
    mongoc_init ();
 
    parse_args (argc, argv);
@@ -39,12 +152,11 @@ main (int argc, char **argv)
    open_output ();
    print_header ();
 
-   bson_perf ();
-   driver_perf ();
-   gridfs_perf ();
-   parallel_perf ();
-   gridfs_parallel_perf ();
-   parallel_client_perf ();
+   for (suite = suites; suite->name; suite++) {
+      if (should_run_suite (suite->name, suite->opt_in)) {
+         suite->run ();
+      }
+   }
 
    print_footer ();
    close_output ();
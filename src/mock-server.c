@@ -0,0 +1,555 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* A minimal replica set of mock members, enough for libmongoc to discover
+ * the topology and monitor it. Each member has an accept thread and a
+ * thread per connection. Members don't send topologyVersion, so clients
+ * poll them with hello instead of streaming. */
+
+#include "mock-server.h"
+
+#include <bson/bson.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+#define MOCK_SET_NAME "mock"
+#define MOCK_MAX_MESSAGE_SIZE (48 * 1000 * 1000)
+#define MOCK_HEADER_SIZE 16
+
+#define MOCK_OP_REPLY 1
+#define MOCK_OP_QUERY 2004
+#define MOCK_OP_MSG 2013
+
+typedef struct {
+   mock_server_t *server;
+   int index;
+   int listen_fd;
+   uint16_t port;
+   pthread_t accept_thread;
+   bson_t hello;
+   /* guarded by the server's mutex */
+   bool down;
+} mock_member_t;
+
+typedef struct _mock_connection_t {
+   int fd;
+   pthread_t thread;
+   mock_member_t *member;
+   struct _mock_connection_t *next;
+} mock_connection_t;
+
+struct _mock_server_t {
+   int n_members;
+   mock_member_t *members;
+   bson_t ok;
+   pthread_mutex_t mutex;
+   /* every connection accepted, closed in mock_server_destroy */
+   mock_connection_t *connections;
+   bool stopping;
+};
+
+static void
+_mock_host (const mock_member_t *member, char *host, size_t host_sz)
+{
+   bson_snprintf (host, host_sz, "127.0.0.1:%hu", member->port);
+}
+
+static void
+_mock_member_hello (mock_server_t *server, mock_member_t *member)
+{
+   bson_t *hello;
+   bson_t hosts;
+   bson_oid_t election_id;
+   char host[32];
+   char key[16];
+   int i;
+
+   hello = &member->hello;
+   bson_init (hello);
+   BSON_APPEND_BOOL (hello, "helloOk", true);
+   BSON_APPEND_BOOL (hello, "isWritablePrimary", member->index == 0);
+   BSON_APPEND_BOOL (hello, "ismaster", member->index == 0);
+   BSON_APPEND_BOOL (hello, "secondary", member->index != 0);
+   BSON_APPEND_UTF8 (hello, "setName", MOCK_SET_NAME);
+   BSON_APPEND_INT32 (hello, "setVersion", 1);
+   if (member->index == 0) {
+      bson_oid_init_from_string (&election_id, "7fffffff0000000000000001");
+      BSON_APPEND_OID (hello, "electionId", &election_id);
+   }
+
+   BSON_APPEND_ARRAY_BEGIN (hello, "hosts", &hosts);
+   for (i = 0; i < server->n_members; i++) {
+      bson_snprintf (key, sizeof (key), "%d", i);
+      _mock_host (&server->members[i], host, sizeof (host));
+      BSON_APPEND_UTF8 (&hosts, key, host);
+   }
+
+   bson_append_array_end (hello, &hosts);
+
+   _mock_host (&server->members[0], host, sizeof (host));
+   BSON_APPEND_UTF8 (hello, "primary", host);
+   _mock_host (member, host, sizeof (host));
+   BSON_APPEND_UTF8 (hello, "me", host);
+   BSON_APPEND_INT32 (hello, "maxBsonObjectSize", 16 * 1024 * 1024);
+   BSON_APPEND_INT32 (hello, "maxMessageSizeBytes", 48000000);
+   BSON_APPEND_INT32 (hello, "maxWriteBatchSize", 100000);
+   BSON_APPEND_INT32 (hello, "logicalSessionTimeoutMinutes", 30);
+   BSON_APPEND_INT32 (hello, "minWireVersion", 0);
+   BSON_APPEND_INT32 (hello, "maxWireVersion", 21);
+   BSON_APPEND_DOUBLE (hello, "ok", 1.0);
+}
+
+static bool
+_mock_member_is_down (mock_member_t *member)
+{
+   bool down;
+
+   pthread_mutex_lock (&member->server->mutex);
+   down = member->down;
+   pthread_mutex_unlock (&member->server->mutex);
+
+   return down;
+}
+
+static bool
+_mock_read_all (int fd, uint8_t *buf, size_t len)
+{
+   ssize_t r;
+
+   while (len > 0) {
+      r = recv (fd, buf, len, 0);
+      if (r < 0 && errno == EINTR) {
+         continue;
+      }
+
+      if (r <= 0) {
+         return false;
+      }
+
+      buf += r;
+      len -= (size_t) r;
+   }
+
+   return true;
+}
+
+static bool
+_mock_write_all (int fd, const uint8_t *buf, size_t len)
+{
+   ssize_t r;
+
+   while (len > 0) {
+      r = send (fd, buf, len, MSG_NOSIGNAL);
+      if (r < 0 && errno == EINTR) {
+         continue;
+      }
+
+      if (r <= 0) {
+         return false;
+      }
+
+      buf += r;
+      len -= (size_t) r;
+   }
+
+   return true;
+}
+
+static int32_t
+_mock_get_int32 (const uint8_t *p)
+{
+   int32_t v;
+
+   memcpy (&v, p, sizeof (v));
+   return BSON_INT32_FROM_LE (v);
+}
+
+static void
+_mock_put_int32 (uint8_t *p, int32_t v)
+{
+   v = BSON_INT32_TO_LE (v);
+   memcpy (p, &v, sizeof (v));
+}
+
+
+/* reply to an OP_QUERY with an OP_REPLY, or to an OP_MSG with an OP_MSG */
+static bool
+_mock_reply (mock_connection_t *conn,
+             int32_t response_to,
+             int32_t opcode,
+             const bson_t *doc)
+{
+   uint8_t *buf;
+   size_t len;
+   bool r;
+
+   if (opcode == MOCK_OP_QUERY) {
+      /* flags, cursor id, starting from and number returned */
+      len = MOCK_HEADER_SIZE + 20 + doc->len;
+   } else {
+      /* flags and a section of kind 0 */
+      len = MOCK_HEADER_SIZE + 5 + doc->len;
+   }
+
+   buf = bson_malloc0 (len);
+   _mock_put_int32 (buf, (int32_t) len);
+   _mock_put_int32 (buf + 8, response_to);
+
+   if (opcode == MOCK_OP_QUERY) {
+      _mock_put_int32 (buf + 12, MOCK_OP_REPLY);
+      _mock_put_int32 (buf + 32, 1 /* number returned */);
+      memcpy (buf + 36, bson_get_data (doc), doc->len);
+   } else {
+      _mock_put_int32 (buf + 12, MOCK_OP_MSG);
+      memcpy (buf + 21, bson_get_data (doc), doc->len);
+   }
+
+   r = _mock_write_all (conn->fd, buf, len);
+   bson_free (buf);
+
+   return r;
+}
+
+
+/* find the command document of an OP_QUERY or OP_MSG body */
+static bool
+_mock_parse_command (int32_t opcode,
+                     const uint8_t *body,
+                     size_t body_len,
+                     bson_t *cmd)
+{
+   size_t offset;
+   const uint8_t *nul;
+   int32_t doc_len;
+
+   if (opcode == MOCK_OP_QUERY) {
+      /* flags, then the namespace, then skip and number to return */
+      if (body_len < 4) {
+         return false;
+      }
+
+      nul = memchr (body + 4, '\0', body_len - 4);
+      if (!nul) {
+         return false;
+      }
+
+      offset = (size_t) (nul - body) + 1 + 8;
+   } else if (opcode == MOCK_OP_MSG) {
+      /* flags, then the kind 0 section clients send first */
+      if (body_len < 5 || body[4] != 0) {
+         return false;
+      }
+
+      offset = 5;
+   } else {
+      return false;
+   }
+
+   if (offset + 5 > body_len) {
+      return false;
+   }
+
+   doc_len = _mock_get_int32 (body + offset);
+   if (doc_len < 5 || (size_t) doc_len > body_len - offset) {
+      return false;
+   }
+
+   return bson_init_static (cmd, body + offset, (size_t) doc_len);
+}
+
+static bool
+_mock_is_hello (const bson_t *cmd)
+{
+   bson_iter_t iter;
+   const char *name;
+
+   if (!bson_iter_init (&iter, cmd) || !bson_iter_next (&iter)) {
+      return false;
+   }
+
+   name = bson_iter_key (&iter);
+   return !strcmp (name, "hello") || !strcasecmp (name, "isMaster");
+}
+
+
+/* handle one request, returns false to close the connection */
+static bool
+_mock_handle_message (mock_connection_t *conn)
+{
+   uint8_t header[MOCK_HEADER_SIZE];
+   uint8_t *body;
+   int32_t msg_len;
+   int32_t request_id;
+   int32_t opcode;
+   bson_t cmd;
+   bool r;
+
+   if (!_mock_read_all (conn->fd, header, sizeof (header))) {
+      return false;
+   }
+
+   msg_len = _mock_get_int32 (header);
+   request_id = _mock_get_int32 (header + 4);
+   opcode = _mock_get_int32 (header + 12);
+   if (msg_len < MOCK_HEADER_SIZE || msg_len > MOCK_MAX_MESSAGE_SIZE) {
+      return false;
+   }
+
+   body = bson_malloc ((size_t) msg_len - MOCK_HEADER_SIZE + 1);
+   r = _mock_read_all (conn->fd, body, (size_t) msg_len - MOCK_HEADER_SIZE);
+
+   if (r) {
+      r = _mock_parse_command (
+         opcode, body, (size_t) msg_len - MOCK_HEADER_SIZE, &cmd);
+   }
+
+   /* a member that is down hangs up instead of replying */
+   if (r && !_mock_member_is_down (conn->member)) {
+      r = _mock_reply (conn,
+                       request_id,
+                       opcode,
+                       _mock_is_hello (&cmd) ? &conn->member->hello
+                                             : &conn->member->server->ok);
+   } else {
+      r = false;
+   }
+
+   bson_free (body);
+
+   return r;
+}
+
+static void *
+_mock_connection_thread (void *p)
+{
+   mock_connection_t *conn;
+
+   conn = (mock_connection_t *) p;
+   while (_mock_handle_message (conn)) {
+   }
+
+   /* mock_server_destroy closes the socket */
+   shutdown (conn->fd, SHUT_RDWR);
+
+   return NULL;
+}
+
+static void *
+_mock_accept_thread (void *p)
+{
+   mock_member_t *member;
+   mock_server_t *server;
+   mock_connection_t *conn;
+   int fd;
+   int one;
+   int ret;
+
+   member = (mock_member_t *) p;
+   server = member->server;
+   one = 1;
+
+   for (;;) {
+      fd = accept (member->listen_fd, NULL, NULL);
+      if (fd < 0) {
+         if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+         }
+
+         /* mock_server_destroy shut down the listening socket */
+         return NULL;
+      }
+
+      pthread_mutex_lock (&server->mutex);
+
+      if (server->stopping || member->down) {
+         pthread_mutex_unlock (&server->mutex);
+         close (fd);
+         continue;
+      }
+
+      setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+      conn = (mock_connection_t *) bson_malloc0 (sizeof (mock_connection_t));
+      conn->fd = fd;
+      conn->member = member;
+      conn->next = server->connections;
+      server->connections = conn;
+
+      ret = pthread_create (
+         &conn->thread, NULL /* attr */, _mock_connection_thread, conn);
+      if (ret != 0) {
+         fprintf (stderr, "mock server: pthread_create returned %d\n", ret);
+         abort ();
+      }
+
+      pthread_mutex_unlock (&server->mutex);
+   }
+}
+
+static void
+_mock_member_listen (mock_member_t *member)
+{
+   struct sockaddr_in addr;
+   socklen_t addr_len;
+   int one;
+
+   member->listen_fd = socket (AF_INET, SOCK_STREAM, 0);
+   if (member->listen_fd < 0) {
+      perror ("mock server: socket");
+      abort ();
+   }
+
+   one = 1;
+   setsockopt (
+      member->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+
+   memset (&addr, 0, sizeof (addr));
+   addr.sin_family = AF_INET;
+   addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+   addr.sin_port = 0;
+
+   if (bind (member->listen_fd, (struct sockaddr *) &addr, sizeof (addr)) <
+          0 ||
+       listen (member->listen_fd, 128) < 0) {
+      perror ("mock server: bind");
+      abort ();
+   }
+
+   addr_len = sizeof (addr);
+   if (getsockname (
+          member->listen_fd, (struct sockaddr *) &addr, &addr_len) < 0) {
+      perror ("mock server: getsockname");
+      abort ();
+   }
+
+   member->port = ntohs (addr.sin_port);
+}
+
+mock_server_t *
+mock_server_new (int n_members)
+{
+   mock_server_t *server;
+   mock_member_t *member;
+   int i;
+   int ret;
+
+   server = (mock_server_t *) bson_malloc0 (sizeof (mock_server_t));
+   server->n_members = n_members;
+   server->members =
+      (mock_member_t *) bson_malloc0 (n_members * sizeof (mock_member_t));
+   pthread_mutex_init (&server->mutex, NULL);
+   bson_init (&server->ok);
+   BSON_APPEND_DOUBLE (&server->ok, "ok", 1.0);
+
+   /* every member's hello lists every port, so bind them all first */
+   for (i = 0; i < n_members; i++) {
+      member = &server->members[i];
+      member->server = server;
+      member->index = i;
+      _mock_member_listen (member);
+   }
+
+   for (i = 0; i < n_members; i++) {
+      member = &server->members[i];
+      _mock_member_hello (server, member);
+      ret = pthread_create (
+         &member->accept_thread, NULL /* attr */, _mock_accept_thread, member);
+      if (ret != 0) {
+         fprintf (stderr, "mock server: pthread_create returned %d\n", ret);
+         abort ();
+      }
+   }
+
+   return server;
+}
+
+char *
+mock_server_uri (const mock_server_t *server)
+{
+   char *uri;
+   size_t uri_sz;
+   size_t len;
+   char host[32];
+   int i;
+
+   uri_sz = server->n_members * sizeof (host) + 64;
+   uri = bson_malloc (uri_sz);
+   len = bson_snprintf (uri, uri_sz, "mongodb://");
+   for (i = 0; i < server->n_members; i++) {
+      _mock_host (&server->members[i], host, sizeof (host));
+      len += bson_snprintf (
+         uri + len, uri_sz - len, "%s%s", i ? "," : "", host);
+   }
+
+   bson_snprintf (uri + len, uri_sz - len, "/?replicaSet=" MOCK_SET_NAME);
+
+   return uri;
+}
+
+void
+mock_server_set_down (mock_server_t *server, int member, bool down)
+{
+   pthread_mutex_lock (&server->mutex);
+   server->members[member].down = down;
+   pthread_mutex_unlock (&server->mutex);
+}
+
+void
+mock_server_destroy (mock_server_t *server)
+{
+   mock_connection_t *conn;
+   mock_connection_t *next;
+   int i;
+
+   pthread_mutex_lock (&server->mutex);
+   server->stopping = true;
+   pthread_mutex_unlock (&server->mutex);
+
+   /* wakes the accept threads */
+   for (i = 0; i < server->n_members; i++) {
+      shutdown (server->members[i].listen_fd, SHUT_RDWR);
+      pthread_join (server->members[i].accept_thread, NULL);
+      close (server->members[i].listen_fd);
+      bson_destroy (&server->members[i].hello);
+   }
+
+   /* no new connections now, wake the connection threads */
+   for (conn = server->connections; conn; conn = conn->next) {
+      shutdown (conn->fd, SHUT_RDWR);
+   }
+
+   for (conn = server->connections; conn; conn = next) {
+      next = conn->next;
+      pthread_join (conn->thread, NULL);
+      close (conn->fd);
+      bson_free (conn);
+   }
+
+   bson_destroy (&server->ok);
+   pthread_mutex_destroy (&server->mutex);
+   bson_free (server->members);
+   bson_free (server);
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGO_C_PERFORMANCE_MOCK_SERVER_H
+#define MONGO_C_PERFORMANCE_MOCK_SERVER_H
+
+#include <bson/bson.h>
+
+/* A replica set of mock members on 127.0.0.1, each listening on its own
+ * port. Members answer "hello" and "isMaster", over OP_QUERY or OP_MSG, as
+ * the primary (member 0) or a secondary, and reply {ok: 1} to any other
+ * command. A member that is down closes every connection it receives. */
+typedef struct _mock_server_t mock_server_t;
+
+mock_server_t *
+mock_server_new (int n_members);
+/* a URI listing every member, free it with bson_free */
+char *
+mock_server_uri (const mock_server_t *server);
+void
+mock_server_set_down (mock_server_t *server, int member, bool down);
+void
+mock_server_destroy (mock_server_t *server);
+
+#endif // MONGO_C_PERFORMANCE_MOCK_SERVER_H
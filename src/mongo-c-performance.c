@@ -17,8 +17,18 @@
 #include <bson/bson.h>
 #include <mongoc/mongoc.h>
 #include <dirent.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "mongo-c-performance.h"
+#include "mutex-profiler.h"
+#include "thread-placement.h"
 
 
 const int NUM_ITERATIONS = 100;
@@ -27,10 +37,19 @@ const int MIN_TIME_USEC = 1 * 60 * 1000 * 1000;
 const int MAX_TIME_USEC = 5 * 60 * 1000 * 1000;
 const int TIME_USEC_QUICK = 5 * 1000 * 1000;
 
+#define MAX_SUITES 32
+
 static bool g_quick = false;
+static bool g_apm = false;
+static const char *g_uri_str;
 char *g_test_dir;
 static int g_num_tests;
 static char **g_test_names;
+static int g_num_suites;
+static const char *g_suite_names[MAX_SUITES];
+/* from --pipeline M:K, or 0 for the ldjson-pipeline suite's sweep */
+static int g_pipeline_parsers;
+static int g_pipeline_writers;
 
 
 void
@@ -66,16 +85,34 @@ prep_tmp_dir (const char *path)
 }
 
 
+static void
+usage_error (const char *usage)
+{
+   fprintf (stderr, "%s", usage);
+   exit (1);
+}
+
+
 void
 parse_args (int argc, char **argv)
 {
    const char *usage =
-      "USAGE: mongo-c-performance [--quick] TEST_DIR [TEST_NAME ...]\n"
+      "USAGE: mongo-c-performance [OPTIONS] TEST_DIR [TEST_NAME ...]\n"
       "\n"
       "Options:\n"
-      "  --quick      Run for at most 5 seconds\n";
+      "  --quick          Run for at most 5 seconds\n"
+      "  --apm            Report command monitoring metrics, at some cost\n"
+      "  --uri URI        Connect to URI instead of mongodb://127.0.0.1/\n"
+      "  --suite SUITE    Only run tests in SUITE, may be repeated\n"
+      "  --placement P    Pin worker threads: none, compact, scatter, core or "
+      "smt\n"
+      "  --pipeline M:K   Run the ldjson-pipeline suite with M parser and K "
+      "writer\n"
+      "                   threads instead of its sweep\n";
 
    char **argp;
+   perf_placement_t placement = PERF_PLACEMENT_NONE;
+   char extra;
 
    if (argc < 2) {
       fprintf (stderr, "%s", usage);
@@ -83,26 +120,183 @@ parse_args (int argc, char **argv)
    }
 
    argp = &argv[1];
-   if (argp[0][0] == '-') {
+   argc--;
+
+   while (argc > 0 && argp[0][0] == '-') {
       if (!strcmp (argp[0], "-h") || !strcmp (argp[0], "--help")) {
          printf ("%s", usage);
          exit (0);
       } else if (!strcmp (argp[0], "--quick")) {
          g_quick = true;
+      } else if (!strcmp (argp[0], "--apm")) {
+         g_apm = true;
+      } else if (!strcmp (argp[0], "--uri") && argc > 1) {
+         g_uri_str = argp[1];
+         argp++;
+         argc--;
+      } else if (!strcmp (argp[0], "--suite") && argc > 1) {
+         if (g_num_suites == MAX_SUITES) {
+            usage_error (usage);
+         }
+
+         g_suite_names[g_num_suites++] = argp[1];
          argp++;
          argc--;
+      } else if (!strcmp (argp[0], "--placement") && argc > 1) {
+         if (!perf_placement_parse (argp[1], &placement)) {
+            usage_error (usage);
+         }
 
-         if (argc < 2) {
-            fprintf (stderr, "%s", usage);
-            exit (1);
+         argp++;
+         argc--;
+      } else if (!strcmp (argp[0], "--pipeline") && argc > 1) {
+         if (sscanf (argp[1],
+                     "%d:%d%c",
+                     &g_pipeline_parsers,
+                     &g_pipeline_writers,
+                     &extra) != 2 ||
+             g_pipeline_parsers < 1 || g_pipeline_writers < 1) {
+            usage_error (usage);
          }
+
+         argp++;
+         argc--;
+      } else {
+         usage_error (usage);
       }
+
+      argp++;
+      argc--;
+   }
+
+   if (argc < 1) {
+      usage_error (usage);
    }
 
    g_test_dir = argp[0];
    argp++;
-   g_num_tests = argc - 2;
+   g_num_tests = argc - 1;
    g_test_names = g_num_tests ? argp : NULL;
+
+   perf_placement_init (placement);
+}
+
+
+bool
+should_run_suite (const char *name, bool opt_in)
+{
+   int i;
+
+   if (!g_num_suites) {
+      return !opt_in;
+   }
+
+   for (i = 0; i < g_num_suites; i++) {
+      if (!strcmp (g_suite_names[i], name)) {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+bool
+perf_pipeline_shape (int *n_parsers, int *n_writers)
+{
+   *n_parsers = g_pipeline_parsers;
+   *n_writers = g_pipeline_writers;
+
+   return g_pipeline_parsers > 0;
+}
+
+
+/* count the allocations libbson and libmongoc make on each thread */
+static __thread int64_t t_allocations;
+
+
+static void *
+counting_malloc (size_t num_bytes)
+{
+   t_allocations++;
+   return malloc (num_bytes);
+}
+
+
+static void *
+counting_calloc (size_t n_members, size_t num_bytes)
+{
+   t_allocations++;
+   return calloc (n_members, num_bytes);
+}
+
+
+static void *
+counting_realloc (void *mem, size_t num_bytes)
+{
+   t_allocations++;
+   return realloc (mem, num_bytes);
+}
+
+
+static void *
+counting_aligned_alloc (size_t alignment, size_t num_bytes)
+{
+   t_allocations++;
+   return aligned_alloc (alignment, num_bytes);
+}
+
+
+void
+perf_mem_init (void)
+{
+   bson_mem_vtable_t vtable = {
+      .malloc = counting_malloc,
+      .calloc = counting_calloc,
+      .realloc = counting_realloc,
+      .free = free,
+      .aligned_alloc = counting_aligned_alloc,
+   };
+
+   bson_mem_set_vtable (&vtable);
+}
+
+
+int64_t
+perf_thread_allocations (void)
+{
+   return t_allocations;
+}
+
+
+mongoc_uri_t *
+perf_uri_new (void)
+{
+   mongoc_uri_t *uri;
+   bson_error_t error;
+
+   /* a NULL string means the default, mongodb://127.0.0.1/ */
+   uri = mongoc_uri_new_with_error (g_uri_str, &error);
+   if (!uri) {
+      MONGOC_ERROR ("invalid URI: %s\n", error.message);
+      abort ();
+   }
+
+   return uri;
+}
+
+
+mongoc_client_t *
+perf_client_new (void)
+{
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+
+   uri = perf_uri_new ();
+   client = mongoc_client_new_from_uri (uri);
+   mongoc_uri_destroy (uri);
+
+   return client;
 }
 
 
@@ -177,6 +371,23 @@ write_one_byte_file (mongoc_gridfs_t *gridfs)
    mongoc_gridfs_file_destroy (file);
 }
 
+void
+set_uri_compressor (mongoc_uri_t *uri, const char *compressor, int32_t level)
+{
+   if (!mongoc_uri_set_compressors (uri, compressor)) {
+      MONGOC_ERROR ("compressor \"%s\" is not supported\n", compressor);
+      abort ();
+   }
+
+   /* only zlib has a configurable level */
+   if (level >= 0 &&
+       !mongoc_uri_set_option_as_int32 (
+          uri, MONGOC_URI_ZLIBCOMPRESSIONLEVEL, level)) {
+      MONGOC_ERROR ("invalid zlib compression level %d\n", level);
+      abort ();
+   }
+}
+
 void
 run_test_as_utility (perf_test_t *test)
 {
@@ -185,6 +396,10 @@ run_test_as_utility (perf_test_t *test)
    test->task (test);
    test->after (test);
    test->teardown (test);
+   bson_free (test->worker_cpus);
+   test->worker_cpus = NULL;
+   bson_free (test->mutex_sites);
+   test->mutex_sites = NULL;
 }
 
 
@@ -254,155 +469,1814 @@ perf_test_teardown (perf_test_t *test)
 
 
 void
-perf_test_init (perf_test_t *test,
-                const char *name,
-                const char *data_path,
-                int64_t data_sz)
+perf_test_add_metric (perf_test_t *test, const char *name, double value)
+{
+   perf_metric_t *metric;
+
+   if (test->n_metrics >= MAX_PERF_METRICS) {
+      MONGOC_ERROR ("%s: too many metrics\n", test->name);
+      abort ();
+   }
+
+   metric = &test->metrics[test->n_metrics++];
+   bson_snprintf (metric->name, sizeof (metric->name), "%s", name);
+   metric->value = value;
+}
+
+
+void
+perf_test_append_name (perf_test_t *test,
+                       char *name,
+                       size_t name_sz,
+                       const char *format,
+                       ...)
 {
+   char *base_name;
+   va_list args;
+   int len;
+
+   /* bson_snprintf's source and destination must not overlap */
+   base_name = bson_strdup (test->name);
+   len = bson_snprintf (name, name_sz, "%s", base_name);
+   bson_free (base_name);
+
+   if (len >= 0 && (size_t) len < name_sz) {
+      va_start (args, format);
+      bson_vsnprintf (name + len, name_sz - (size_t) len, format, args);
+      va_end (args);
+   }
+
    test->name = name;
-   test->data_path = data_path;
-   test->data_sz = data_sz;
+}
 
-   test->setup = perf_test_setup;
-   test->before = perf_test_before;
-   test->task = perf_test_task;
-   test->after = perf_test_after;
-   test->teardown = perf_test_teardown;
+
+void
+perf_latencies_init (perf_latencies_t *latencies)
+{
+   latencies->sz = 1024;
+   latencies->n = 0;
+   latencies->samples = bson_malloc (latencies->sz * sizeof (int64_t));
 }
 
 
-static FILE *output;
-static bool is_first_test;
+void
+perf_latencies_reserve (perf_latencies_t *latencies, size_t n)
+{
+   if (n > latencies->sz) {
+      latencies->sz = n;
+      latencies->samples =
+         bson_realloc (latencies->samples, latencies->sz * sizeof (int64_t));
+   }
+}
+
 
 void
-open_output (void)
+perf_latencies_add (perf_latencies_t *latencies, int64_t usec)
 {
-   printf ("opening results.json\n");
-   output = fopen ("results.json", "w");
+   if (latencies->n == latencies->sz) {
+      latencies->sz *= 2;
+      latencies->samples = bson_realloc (latencies->samples,
+                                         latencies->sz * sizeof (int64_t));
+   }
 
-   if (!output) {
-      perror ("results.json");
-      abort ();
+   latencies->samples[latencies->n++] = usec;
+}
+
+
+void
+perf_latencies_merge (perf_latencies_t *dst, const perf_latencies_t *src)
+{
+   size_t i;
+
+   for (i = 0; i < src->n; i++) {
+      perf_latencies_add (dst, src->samples[i]);
    }
 }
 
 
+static double
+percentile (const perf_latencies_t *latencies, double p)
+{
+   size_t idx;
+
+   idx = (size_t) (p / 100.0 * (double) (latencies->n - 1) + 0.5);
+   return (double) latencies->samples[BSON_MIN (idx, latencies->n - 1)];
+}
+
+
 void
-close_output (void)
+perf_latencies_report (perf_test_t *test,
+                       const char *prefix,
+                       perf_latencies_t *latencies)
 {
-   fclose (output);
+   const double percentiles[] = {50, 90, 99, 99.9};
+   char name[64];
+   size_t i;
+
+   if (!latencies->n) {
+      return;
+   }
+
+   qsort ((void *) latencies->samples, latencies->n, sizeof (int64_t), cmp);
+
+   for (i = 0; i < sizeof (percentiles) / sizeof (percentiles[0]); i++) {
+      bson_snprintf (name,
+                     sizeof (name),
+                     "%slatency_p%g_usec",
+                     prefix ? prefix : "",
+                     percentiles[i]);
+      perf_test_add_metric (test, name, percentile (latencies, percentiles[i]));
+   }
+
+   bson_snprintf (
+      name, sizeof (name), "%slatency_max_usec", prefix ? prefix : "");
+   perf_test_add_metric (
+      test, name, (double) latencies->samples[latencies->n - 1]);
 }
 
 
 void
-print_header (void)
+perf_latencies_destroy (perf_latencies_t *latencies)
 {
-   fprintf (output, "[\n");
+   bson_free (latencies->samples);
+   latencies->samples = NULL;
+   latencies->n = latencies->sz = 0;
+}
 
-   is_first_test = true;
+
+static void *
+perf_worker_thread (void *p)
+{
+   perf_worker_t *worker;
+   perf_workers_t *workers;
+   int64_t generation;
+   int64_t start;
+   void *ctx;
+
+   worker = (perf_worker_t *) p;
+   workers = worker->workers;
+   perf_placement_pin (worker->index);
+
+   /* the first run may have started before this thread got here; runs are
+    * numbered from 1, so wait for generation 0 to pass rather than for the
+    * current one */
+   generation = 0;
+
+   pthread_mutex_lock (&workers->mutex);
+
+   for (;;) {
+      while (!workers->stop && workers->generation == generation) {
+         pthread_cond_wait (&workers->start_cond, &workers->mutex);
+      }
+
+      if (workers->stop) {
+         break;
+      }
+
+      generation = workers->generation;
+      ctx = workers->contexts + worker->index * workers->context_sz;
+      pthread_mutex_unlock (&workers->mutex);
+
+      start = bson_get_monotonic_time ();
+      worker->result = workers->fn (ctx);
+      worker->usec = bson_get_monotonic_time () - start;
+      worker->total_usec += worker->usec;
+      worker->cpu = perf_placement_current_cpu ();
+
+      pthread_mutex_lock (&workers->mutex);
+      if (--workers->n_running == 0) {
+         pthread_cond_signal (&workers->done_cond);
+      }
+   }
+
+   pthread_mutex_unlock (&workers->mutex);
+
+   return NULL;
+}
+
+
+void
+perf_workers_init (perf_workers_t *workers, int n)
+{
+   int i;
+   int ret;
+
+   memset (workers, 0, sizeof (perf_workers_t));
+   workers->n = n;
+   workers->workers =
+      (perf_worker_t *) bson_malloc0 (n * sizeof (perf_worker_t));
+   pthread_mutex_init (&workers->mutex, NULL);
+   pthread_cond_init (&workers->start_cond, NULL);
+   pthread_cond_init (&workers->done_cond, NULL);
+
+   for (i = 0; i < n; i++) {
+      workers->workers[i].workers = workers;
+      workers->workers[i].index = i;
+      ret = pthread_create (&workers->workers[i].thread,
+                            NULL /* attr */,
+                            perf_worker_thread,
+                            &workers->workers[i]);
+      if (ret != 0) {
+         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
+         abort ();
+      }
+   }
 }
 
 
+/* call fn on each of the n contexts, each context_sz bytes, one per worker */
+void
+perf_workers_run (perf_workers_t *workers,
+                  perf_worker_fn_t fn,
+                  void *contexts,
+                  size_t context_sz)
+{
+   pthread_mutex_lock (&workers->mutex);
+   workers->fn = fn;
+   workers->contexts = (char *) contexts;
+   workers->context_sz = context_sz;
+   workers->n_running = workers->n;
+   workers->generation++;
+   pthread_cond_broadcast (&workers->start_cond);
+
+   while (workers->n_running > 0) {
+      pthread_cond_wait (&workers->done_cond, &workers->mutex);
+   }
+
+   workers->n_runs++;
+   pthread_mutex_unlock (&workers->mutex);
+}
+
+
+/* add "worker_sec_min" and "worker_sec_max", the mean time per run of the
+ * fastest and slowest worker, and record the CPU each worker ran on */
 static void
-print_result (const char *name, double ops_per_sec)
+report_workers (perf_test_t *test,
+                const perf_worker_t *workers,
+                int n,
+                int64_t n_runs)
 {
-   if (!is_first_test) {
-      fprintf (output, ",\n");
+   int64_t min_usec;
+   int64_t max_usec;
+   size_t sz;
+   size_t len;
+   int i;
+
+   if (!n || !n_runs) {
+      return;
    }
 
-   is_first_test = false;
+   /* "[", up to 11 characters and ", " per CPU, "]" */
+   sz = 2 + n * 13 + 1;
+   bson_free (test->worker_cpus);
+   test->worker_cpus = bson_malloc (sz);
+   len = bson_snprintf (test->worker_cpus, sz, "[");
+   for (i = 0; i < n; i++) {
+      len += bson_snprintf (test->worker_cpus + len,
+                            sz - len,
+                            "%s%d",
+                            i ? ", " : "",
+                            workers[i].cpu);
+   }
 
-   fprintf (output,
-            "  {\n"
-            "    \"info\": {\n"
-            "      \"test_name\": \"%s\"\n"
-            "    },\n"
-            "    \"metrics\": [\n"
-            "      {\n"
-            "        \"name\": \"ops_per_sec\",\n"
-            "        \"value\": %f\n"
-            "      }\n"
-            "    ]\n"
-            "  }",
-            name,
-            ops_per_sec);
+   bson_snprintf (test->worker_cpus + len, sz - len, "]");
+
+   min_usec = max_usec = workers[0].total_usec;
+   for (i = 1; i < n; i++) {
+      min_usec = BSON_MIN (min_usec, workers[i].total_usec);
+      max_usec = BSON_MAX (max_usec, workers[i].total_usec);
+   }
+
+   perf_test_add_metric (
+      test, "worker_sec_min", (double) min_usec / 1e6 / n_runs);
+   perf_test_add_metric (
+      test, "worker_sec_max", (double) max_usec / 1e6 / n_runs);
 }
 
 
 void
-print_footer (void)
+perf_workers_report (perf_test_t *test, const perf_workers_t *workers)
 {
-   fprintf (output,
-            "\n"
-            "]\n");
+   report_workers (test, workers->workers, workers->n, workers->n_runs);
 }
 
 
 void
-run_perf_tests (perf_test_t **tests)
+perf_workers_destroy (perf_workers_t *workers)
 {
-   perf_test_t *test;
-   int64_t *results;
-   size_t results_sz;
-   int test_idx;
-   size_t i;
-   int64_t task_start;
-   int64_t total_time;
-   int64_t min_time;
-   int64_t max_time;
-   int median_idx;
-   double median;
-   double ops_per_sec;
+   int i;
 
-   if (g_quick) {
-      min_time = max_time = TIME_USEC_QUICK;
-   } else {
-      min_time = MIN_TIME_USEC;
-      max_time = MAX_TIME_USEC;
+   pthread_mutex_lock (&workers->mutex);
+   workers->stop = true;
+   pthread_cond_broadcast (&workers->start_cond);
+   pthread_mutex_unlock (&workers->mutex);
+
+   for (i = 0; i < workers->n; i++) {
+      if (pthread_join (workers->workers[i].thread, NULL)) {
+         perror ("pthread_join");
+         abort ();
+      }
    }
 
-   results_sz = NUM_ITERATIONS;
-   results = bson_malloc (results_sz * sizeof (int64_t));
+   pthread_cond_destroy (&workers->start_cond);
+   pthread_cond_destroy (&workers->done_cond);
+   pthread_mutex_destroy (&workers->mutex);
+   bson_free (workers->workers);
+   workers->workers = NULL;
+   workers->n = 0;
+}
 
-   test_idx = 0;
-   while (tests[test_idx]) {
-      test = tests[test_idx];
-      if (should_run_test (test->name)) {
-         printf ("%20s\n", test->name);
-         fflush (stdout);
-         test->setup (test);
 
-         /* run at least 1 min, stop at 100 loops or 5 mins, whichever first */
-         total_time = 0;
-         for (i = 0; total_time < min_time ||
-                     (i < NUM_ITERATIONS && total_time < max_time);
-              i++) {
-            if (i >= results_sz) {
-               results_sz *= 2;
-               results = realloc (results, results_sz * sizeof (int64_t));
-            }
+struct _perf_processes_shared_t {
+   pthread_mutex_t mutex;
+   pthread_cond_t start_cond;
+   pthread_cond_t done_cond;
+   /* incremented to start a run */
+   int64_t generation;
+   int n_running;
+   int64_t n_runs;
+   bool stop;
+   /* each child's times and CPU; only those fields are used */
+   perf_worker_t workers[];
+};
 
-            test->before (test);
 
-            task_start = bson_get_monotonic_time ();
-            test->task (test);
-            total_time += results[i] = bson_get_monotonic_time () - task_start;
+static void
+perf_process_main (perf_processes_shared_t *shared,
+                   int index,
+                   perf_process_init_t init,
+                   perf_process_fn_t fn,
+                   void *ctx)
+{
+   perf_worker_t *worker;
+   int64_t generation;
+   int64_t start;
+   void *state;
+
+   worker = &shared->workers[index];
+   perf_placement_pin (index);
+   state = init (ctx, index);
+
+   pthread_mutex_lock (&shared->mutex);
+   generation = shared->generation;
+   if (--shared->n_running == 0) {
+      pthread_cond_signal (&shared->done_cond);
+   }
 
-            test->after (test);
-         }
+   for (;;) {
+      while (!shared->stop && shared->generation == generation) {
+         pthread_cond_wait (&shared->start_cond, &shared->mutex);
+      }
 
-         printf ("Ran %zu iterations of %s\n", i, test->name);
+      if (shared->stop) {
+         break;
+      }
+
+      generation = shared->generation;
+      pthread_mutex_unlock (&shared->mutex);
+
+      start = bson_get_monotonic_time ();
+      fn (state);
+      worker->usec = bson_get_monotonic_time () - start;
+      worker->total_usec += worker->usec;
+      worker->cpu = perf_placement_current_cpu ();
+
+      pthread_mutex_lock (&shared->mutex);
+      if (--shared->n_running == 0) {
+         pthread_cond_signal (&shared->done_cond);
+      }
+   }
+
+   pthread_mutex_unlock (&shared->mutex);
+
+   /* skip atexit handlers and stdio buffers inherited from the parent */
+   _exit (0);
+}
+
+
+/* call with shared->mutex locked. wait for the children to finish, and abort
+ * if one dies instead, e.g. it aborted on an error */
+static void
+perf_processes_wait (perf_processes_t *processes)
+{
+   perf_processes_shared_t *shared;
+   struct timespec deadline;
+   int status;
+   int i;
+
+   shared = processes->shared;
+   while (shared->n_running > 0) {
+      clock_gettime (CLOCK_REALTIME, &deadline);
+      deadline.tv_sec++;
+      pthread_cond_timedwait (&shared->done_cond, &shared->mutex, &deadline);
+
+      for (i = 0; i < processes->n; i++) {
+         if (waitpid (processes->pids[i], &status, WNOHANG) ==
+             processes->pids[i]) {
+            MONGOC_ERROR ("child process %d exited with status %d\n",
+                          (int) processes->pids[i],
+                          status);
+            abort ();
+         }
+      }
+   }
+}
+
+
+void
+perf_processes_init (perf_processes_t *processes,
+                     int n,
+                     perf_process_init_t init,
+                     perf_process_fn_t fn,
+                     void *ctx)
+{
+   perf_processes_shared_t *shared;
+   pthread_mutexattr_t mutex_attr;
+   pthread_condattr_t cond_attr;
+   pid_t pid;
+   int i;
+
+   processes->n = n;
+   processes->pids = (pid_t *) bson_malloc0 (n * sizeof (pid_t));
+   processes->shared_sz =
+      sizeof (perf_processes_shared_t) + n * sizeof (perf_worker_t);
+   shared = mmap (NULL,
+                  processes->shared_sz,
+                  PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS,
+                  -1,
+                  0);
+   if (shared == MAP_FAILED) {
+      perror ("mmap");
+      abort ();
+   }
+
+   memset (shared, 0, processes->shared_sz);
+   processes->shared = shared;
+
+   pthread_mutexattr_init (&mutex_attr);
+   pthread_mutexattr_setpshared (&mutex_attr, PTHREAD_PROCESS_SHARED);
+   pthread_mutex_init (&shared->mutex, &mutex_attr);
+   pthread_mutexattr_destroy (&mutex_attr);
+   pthread_condattr_init (&cond_attr);
+   pthread_condattr_setpshared (&cond_attr, PTHREAD_PROCESS_SHARED);
+   pthread_cond_init (&shared->start_cond, &cond_attr);
+   pthread_cond_init (&shared->done_cond, &cond_attr);
+   pthread_condattr_destroy (&cond_attr);
+
+   shared->n_running = n;
+
+   /* don't let the children flush the parent's buffered output */
+   fflush (stdout);
+   fflush (stderr);
+
+   for (i = 0; i < n; i++) {
+      shared->workers[i].index = i;
+      pid = fork ();
+      if (pid < 0) {
+         perror ("fork");
+         abort ();
+      }
+
+      if (pid == 0) {
+         perf_process_main (shared, i, init, fn, ctx);
+      }
+
+      processes->pids[i] = pid;
+   }
+
+   /* wait for each child's init, which isn't timed */
+   pthread_mutex_lock (&shared->mutex);
+   perf_processes_wait (processes);
+   pthread_mutex_unlock (&shared->mutex);
+}
+
+
+void
+perf_processes_run (perf_processes_t *processes)
+{
+   perf_processes_shared_t *shared;
+
+   shared = processes->shared;
+   pthread_mutex_lock (&shared->mutex);
+   shared->n_running = processes->n;
+   shared->generation++;
+   pthread_cond_broadcast (&shared->start_cond);
+   perf_processes_wait (processes);
+   shared->n_runs++;
+   pthread_mutex_unlock (&shared->mutex);
+}
+
+
+void
+perf_processes_report (perf_test_t *test, const perf_processes_t *processes)
+{
+   report_workers (test,
+                   processes->shared->workers,
+                   processes->n,
+                   processes->shared->n_runs);
+}
+
+
+void
+perf_processes_destroy (perf_processes_t *processes)
+{
+   perf_processes_shared_t *shared;
+   int status;
+   int i;
+
+   shared = processes->shared;
+   pthread_mutex_lock (&shared->mutex);
+   shared->stop = true;
+   pthread_cond_broadcast (&shared->start_cond);
+   pthread_mutex_unlock (&shared->mutex);
+
+   for (i = 0; i < processes->n; i++) {
+      if (waitpid (processes->pids[i], &status, 0) < 0) {
+         perror ("waitpid");
+         abort ();
+      }
+
+      if (!WIFEXITED (status) || WEXITSTATUS (status) != 0) {
+         MONGOC_ERROR ("child process %d exited with status %d\n",
+                       (int) processes->pids[i],
+                       status);
+         abort ();
+      }
+   }
+
+   pthread_cond_destroy (&shared->start_cond);
+   pthread_cond_destroy (&shared->done_cond);
+   pthread_mutex_destroy (&shared->mutex);
+   munmap (shared, processes->shared_sz);
+   bson_free (processes->pids);
+   processes->shared = NULL;
+   processes->pids = NULL;
+   processes->n = 0;
+}
+
+
+static void
+server_hello (bson_t *reply)
+{
+   mongoc_client_t *client;
+   bson_t *cmd;
+   bson_error_t error;
+
+   client = perf_client_new ();
+   cmd = BCON_NEW ("hello", BCON_INT32 (1));
+   if (!mongoc_client_command_simple (
+          client, "admin", cmd, NULL, reply, &error)) {
+      MONGOC_ERROR ("hello: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (cmd);
+   mongoc_client_destroy (client);
+}
+
+
+bool
+is_replica_set (void)
+{
+   bson_t reply;
+   bson_iter_t iter;
+   bool r;
+
+   server_hello (&reply);
+   r = bson_iter_init_find (&iter, &reply, "setName");
+   bson_destroy (&reply);
+
+   return r;
+}
+
+
+int32_t
+server_max_wire_version (void)
+{
+   bson_t reply;
+   bson_iter_t iter;
+   int32_t r;
+
+   server_hello (&reply);
+   r = bson_iter_init_find (&iter, &reply, "maxWireVersion")
+          ? (int32_t) bson_iter_as_int64 (&iter)
+          : 0;
+   bson_destroy (&reply);
+
+   return r;
+}
+
+
+/* the number of members in the hello response's "hosts", or 1 */
+int32_t
+replica_set_size (void)
+{
+   bson_t reply;
+   bson_iter_t iter;
+   bson_iter_t child;
+   int32_t r;
+
+   server_hello (&reply);
+   r = 0;
+   if (bson_iter_init_find (&iter, &reply, "hosts") &&
+       BSON_ITER_HOLDS_ARRAY (&iter) && bson_iter_recurse (&iter, &child)) {
+      while (bson_iter_next (&child)) {
+         r++;
+      }
+   }
+
+   bson_destroy (&reply);
+
+   return BSON_MAX (r, 1);
+}
+
+
+/* replset-benchmark.py tags the members "dc": "east", "east" and "west" */
+const perf_read_pref_t PERF_READ_PREFS[] = {
+   {"primary", MONGOC_READ_PRIMARY, NULL, MONGOC_NO_MAX_STALENESS},
+   {"secondaryPreferred",
+    MONGOC_READ_SECONDARY_PREFERRED,
+    NULL,
+    MONGOC_NO_MAX_STALENESS},
+   {"nearest", MONGOC_READ_NEAREST, NULL, MONGOC_NO_MAX_STALENESS},
+   {"secondaryPreferred/Tags:dc=west",
+    MONGOC_READ_SECONDARY_PREFERRED,
+    "west",
+    MONGOC_NO_MAX_STALENESS},
+   {"nearest/MaxStaleness:90", MONGOC_READ_NEAREST, NULL, 90},
+};
+
+const size_t PERF_N_READ_PREFS =
+   sizeof (PERF_READ_PREFS) / sizeof (PERF_READ_PREFS[0]);
+
+
+mongoc_read_prefs_t *
+perf_read_prefs_new (const perf_read_pref_t *read_pref)
+{
+   mongoc_read_prefs_t *prefs;
+   bson_t *tags;
+
+   prefs = mongoc_read_prefs_new (read_pref->mode);
+
+   if (read_pref->dc) {
+      /* the empty tag set matches any member if no member has the tag */
+      tags = BCON_NEW ("0",
+                       "{",
+                       "dc",
+                       BCON_UTF8 (read_pref->dc),
+                       "}",
+                       "1",
+                       "{",
+                       "}");
+      mongoc_read_prefs_set_tags (prefs, tags);
+      bson_destroy (tags);
+   }
+
+   if (read_pref->max_staleness_seconds != MONGOC_NO_MAX_STALENESS) {
+      mongoc_read_prefs_set_max_staleness_seconds (
+         prefs, read_pref->max_staleness_seconds);
+   }
+
+   if (!mongoc_read_prefs_is_valid (prefs)) {
+      MONGOC_ERROR ("invalid read preference %s\n", read_pref->name);
+      abort ();
+   }
+
+   return prefs;
+}
+
+
+/* commands started by clients with perf_apm callbacks, by command name. The
+ * round trips, durations and sizes only count commands run by "task". */
+#define MAX_APM_COMMANDS 32
+
+typedef struct {
+   char name[32];
+   int64_t count;
+   int64_t round_trips;
+   int64_t duration_usec;
+   int64_t request_bytes;
+   int64_t reply_bytes;
+} apm_command_stats_t;
+
+static pthread_mutex_t g_apm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static apm_command_stats_t g_apm_commands[MAX_APM_COMMANDS];
+static int g_apm_n_commands;
+static bool g_apm_in_task;
+
+
+/* call with g_apm_mutex locked. returns NULL if there are too many names. */
+static apm_command_stats_t *
+apm_command_stats (const char *name)
+{
+   apm_command_stats_t *stats;
+   int i;
+
+   for (i = 0; i < g_apm_n_commands; i++) {
+      if (!strcmp (g_apm_commands[i].name, name)) {
+         return &g_apm_commands[i];
+      }
+   }
+
+   if (g_apm_n_commands == MAX_APM_COMMANDS) {
+      return NULL;
+   }
+
+   stats = &g_apm_commands[g_apm_n_commands++];
+   memset (stats, 0, sizeof (*stats));
+   bson_snprintf (stats->name, sizeof (stats->name), "%s", name);
+
+   return stats;
+}
+
+
+static void
+apm_command_started (const mongoc_apm_command_started_t *event)
+{
+   apm_command_stats_t *stats;
+
+   pthread_mutex_lock (&g_apm_mutex);
+
+   stats =
+      apm_command_stats (mongoc_apm_command_started_get_command_name (event));
+   if (stats) {
+      stats->count++;
+      if (g_apm_in_task) {
+         stats->round_trips++;
+         stats->request_bytes +=
+            mongoc_apm_command_started_get_command (event)->len;
+      }
+   }
+
+   pthread_mutex_unlock (&g_apm_mutex);
+}
+
+
+static void
+apm_command_finished (const char *name,
+                      int64_t duration_usec,
+                      const bson_t *reply)
+{
+   apm_command_stats_t *stats;
+
+   pthread_mutex_lock (&g_apm_mutex);
+
+   stats = apm_command_stats (name);
+   if (stats && g_apm_in_task) {
+      stats->duration_usec += duration_usec;
+      stats->reply_bytes += reply ? reply->len : 0;
+   }
+
+   pthread_mutex_unlock (&g_apm_mutex);
+}
+
+
+static void
+apm_command_succeeded (const mongoc_apm_command_succeeded_t *event)
+{
+   apm_command_finished (
+      mongoc_apm_command_succeeded_get_command_name (event),
+      mongoc_apm_command_succeeded_get_duration (event),
+      mongoc_apm_command_succeeded_get_reply (event));
+}
+
+
+static void
+apm_command_failed (const mongoc_apm_command_failed_t *event)
+{
+   apm_command_finished (mongoc_apm_command_failed_get_command_name (event),
+                         mongoc_apm_command_failed_get_duration (event),
+                         mongoc_apm_command_failed_get_reply (event));
+}
+
+
+static mongoc_apm_callbacks_t *
+apm_callbacks_new (void)
+{
+   mongoc_apm_callbacks_t *callbacks;
+
+   callbacks = mongoc_apm_callbacks_new ();
+   mongoc_apm_set_command_started_cb (callbacks, apm_command_started);
+   mongoc_apm_set_command_succeeded_cb (callbacks, apm_command_succeeded);
+   mongoc_apm_set_command_failed_cb (callbacks, apm_command_failed);
+
+   return callbacks;
+}
+
+
+void
+perf_apm_set_callbacks (mongoc_client_t *client)
+{
+   mongoc_apm_callbacks_t *callbacks;
+
+   callbacks = apm_callbacks_new ();
+   mongoc_client_set_apm_callbacks (client, callbacks, NULL);
+   mongoc_apm_callbacks_destroy (callbacks);
+}
+
+
+void
+perf_apm_set_pool_callbacks (mongoc_client_pool_t *pool)
+{
+   mongoc_apm_callbacks_t *callbacks;
+
+   callbacks = apm_callbacks_new ();
+   mongoc_client_pool_set_apm_callbacks (pool, callbacks, NULL);
+   mongoc_apm_callbacks_destroy (callbacks);
+}
+
+
+/* with --apm, tests instrument their clients with these */
+void
+perf_apm_instrument (mongoc_client_t *client)
+{
+   if (g_apm) {
+      perf_apm_set_callbacks (client);
+   }
+}
+
+
+void
+perf_apm_instrument_pool (mongoc_client_pool_t *pool)
+{
+   if (g_apm) {
+      perf_apm_set_pool_callbacks (pool);
+   }
+}
+
+
+/* the observability variants: the plain run, APM callbacks that do nothing,
+ * APM callbacks that serialize each event to JSON like a logger would, and
+ * structured logging to a handler that serializes each entry, at each max
+ * level */
+const perf_observe_t PERF_OBSERVE_MODES[] = {
+   {"none", PERF_OBSERVE_NONE, MONGOC_STRUCTURED_LOG_LEVEL_EMERGENCY},
+   {"apm-noop", PERF_OBSERVE_APM_NOOP, MONGOC_STRUCTURED_LOG_LEVEL_EMERGENCY},
+   {"apm-serialize",
+    PERF_OBSERVE_APM_SERIALIZE,
+    MONGOC_STRUCTURED_LOG_LEVEL_EMERGENCY},
+   {"log-emergency", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_EMERGENCY},
+   {"log-alert", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_ALERT},
+   {"log-critical", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_CRITICAL},
+   {"log-error", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_ERROR},
+   {"log-warning", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_WARNING},
+   {"log-notice", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_NOTICE},
+   {"log-info", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_INFO},
+   {"log-debug", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_DEBUG},
+   {"log-trace", PERF_OBSERVE_LOG, MONGOC_STRUCTURED_LOG_LEVEL_TRACE},
+};
+
+const size_t PERF_N_OBSERVE_MODES =
+   sizeof (PERF_OBSERVE_MODES) / sizeof (PERF_OBSERVE_MODES[0]);
+
+
+static void
+observe_apm_noop_started (const mongoc_apm_command_started_t *event)
+{
+}
+
+
+static void
+observe_apm_noop_succeeded (const mongoc_apm_command_succeeded_t *event)
+{
+}
+
+
+static void
+observe_apm_noop_failed (const mongoc_apm_command_failed_t *event)
+{
+}
+
+
+static void
+observe_serialize (const bson_t *doc)
+{
+   char *json;
+
+   json = bson_as_relaxed_extended_json (doc, NULL);
+   bson_free (json);
+}
+
+
+static void
+observe_apm_serialize_started (const mongoc_apm_command_started_t *event)
+{
+   observe_serialize (mongoc_apm_command_started_get_command (event));
+}
+
+
+static void
+observe_apm_serialize_succeeded (const mongoc_apm_command_succeeded_t *event)
+{
+   observe_serialize (mongoc_apm_command_succeeded_get_reply (event));
+}
+
+
+static void
+observe_apm_serialize_failed (const mongoc_apm_command_failed_t *event)
+{
+   observe_serialize (mongoc_apm_command_failed_get_reply (event));
+}
+
+
+static void
+observe_log_handler (const mongoc_structured_log_entry_t *entry,
+                     void *user_data)
+{
+   bson_t *message;
+
+   message = mongoc_structured_log_entry_message_as_bson (entry);
+   observe_serialize (message);
+   bson_destroy (message);
+}
+
+
+static mongoc_apm_callbacks_t *
+observe_apm_callbacks_new (const perf_observe_t *observe)
+{
+   mongoc_apm_callbacks_t *callbacks;
+
+   callbacks = mongoc_apm_callbacks_new ();
+   if (observe->mode == PERF_OBSERVE_APM_NOOP) {
+      mongoc_apm_set_command_started_cb (callbacks, observe_apm_noop_started);
+      mongoc_apm_set_command_succeeded_cb (callbacks,
+                                           observe_apm_noop_succeeded);
+      mongoc_apm_set_command_failed_cb (callbacks, observe_apm_noop_failed);
+   } else {
+      mongoc_apm_set_command_started_cb (callbacks,
+                                         observe_apm_serialize_started);
+      mongoc_apm_set_command_succeeded_cb (callbacks,
+                                           observe_apm_serialize_succeeded);
+      mongoc_apm_set_command_failed_cb (callbacks,
+                                        observe_apm_serialize_failed);
+   }
+
+   return callbacks;
+}
+
+
+static mongoc_structured_log_opts_t *
+observe_log_opts_new (const perf_observe_t *observe)
+{
+   mongoc_structured_log_opts_t *opts;
+
+   opts = mongoc_structured_log_opts_new ();
+   mongoc_structured_log_opts_set_handler (
+      opts, observe_log_handler, NULL /* user data */);
+   if (!mongoc_structured_log_opts_set_max_level_for_all_components (
+          opts, observe->log_level)) {
+      MONGOC_ERROR ("invalid structured log level for %s\n", observe->name);
+      abort ();
+   }
+
+   return opts;
+}
+
+
+/* apply an observability variant to a client, before its first command */
+void
+perf_observe_client (mongoc_client_t *client, const perf_observe_t *observe)
+{
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_structured_log_opts_t *opts;
+
+   switch (observe->mode) {
+   case PERF_OBSERVE_NONE:
+      break;
+   case PERF_OBSERVE_APM_NOOP:
+   case PERF_OBSERVE_APM_SERIALIZE:
+      callbacks = observe_apm_callbacks_new (observe);
+      mongoc_client_set_apm_callbacks (client, callbacks, NULL);
+      mongoc_apm_callbacks_destroy (callbacks);
+      break;
+   case PERF_OBSERVE_LOG:
+      opts = observe_log_opts_new (observe);
+      mongoc_client_set_structured_log_opts (client, opts);
+      mongoc_structured_log_opts_destroy (opts);
+      break;
+   default:
+      abort ();
+   }
+}
+
+
+/* apply an observability variant to a pool, before the first pop */
+void
+perf_observe_pool (mongoc_client_pool_t *pool, const perf_observe_t *observe)
+{
+   mongoc_apm_callbacks_t *callbacks;
+   mongoc_structured_log_opts_t *opts;
+
+   switch (observe->mode) {
+   case PERF_OBSERVE_NONE:
+      break;
+   case PERF_OBSERVE_APM_NOOP:
+   case PERF_OBSERVE_APM_SERIALIZE:
+      callbacks = observe_apm_callbacks_new (observe);
+      mongoc_client_pool_set_apm_callbacks (pool, callbacks, NULL);
+      mongoc_apm_callbacks_destroy (callbacks);
+      break;
+   case PERF_OBSERVE_LOG:
+      opts = observe_log_opts_new (observe);
+      mongoc_client_pool_set_structured_log_opts (pool, opts);
+      mongoc_structured_log_opts_destroy (opts);
+      break;
+   default:
+      abort ();
+   }
+}
+
+
+static void
+apm_reset (void)
+{
+   pthread_mutex_lock (&g_apm_mutex);
+   g_apm_n_commands = 0;
+   pthread_mutex_unlock (&g_apm_mutex);
+}
+
+
+static void
+apm_set_in_task (bool in_task)
+{
+   pthread_mutex_lock (&g_apm_mutex);
+   g_apm_in_task = in_task;
+   pthread_mutex_unlock (&g_apm_mutex);
+}
+
+
+/* add "commands_<name>" metrics, the mean commands of each name per
+ * iteration, including those sent by "before" and "after" */
+static void
+apm_report (perf_test_t *test, size_t iterations)
+{
+   char name[64];
+   int i;
+
+   pthread_mutex_lock (&g_apm_mutex);
+
+   for (i = 0; i < g_apm_n_commands; i++) {
+      bson_snprintf (
+         name, sizeof (name), "commands_%s", g_apm_commands[i].name);
+      perf_test_add_metric (
+         test, name, (double) g_apm_commands[i].count / iterations);
+   }
+
+   pthread_mutex_unlock (&g_apm_mutex);
+}
+
+
+/* add the --apm metrics for the commands "task" ran. apm_driver_sec is the
+ * wall time not spent waiting for round trips; round trips overlap in
+ * multithreaded tests, so it is only meaningful for single-threaded ones. */
+static void
+apm_report_wire (perf_test_t *test, size_t iterations, int64_t total_time)
+{
+   apm_command_stats_t *stats;
+   char name[64];
+   int64_t round_trips;
+   int64_t duration_usec;
+   int64_t bytes;
+   int i;
+
+   round_trips = duration_usec = bytes = 0;
+
+   pthread_mutex_lock (&g_apm_mutex);
+
+   for (i = 0; i < g_apm_n_commands; i++) {
+      stats = &g_apm_commands[i];
+      if (!stats->round_trips) {
+         continue;
+      }
+
+      round_trips += stats->round_trips;
+      duration_usec += stats->duration_usec;
+      bytes += stats->request_bytes + stats->reply_bytes;
+
+      bson_snprintf (name, sizeof (name), "apm_%s_count", stats->name);
+      perf_test_add_metric (
+         test, name, (double) stats->round_trips / iterations);
+      bson_snprintf (name, sizeof (name), "apm_%s_usec", stats->name);
+      perf_test_add_metric (
+         test, name, (double) stats->duration_usec / stats->round_trips);
+      bson_snprintf (name, sizeof (name), "apm_%s_request_bytes", stats->name);
+      perf_test_add_metric (
+         test, name, (double) stats->request_bytes / stats->round_trips);
+      bson_snprintf (name, sizeof (name), "apm_%s_reply_bytes", stats->name);
+      perf_test_add_metric (
+         test, name, (double) stats->reply_bytes / stats->round_trips);
+   }
+
+   pthread_mutex_unlock (&g_apm_mutex);
+
+   if (!round_trips) {
+      return;
+   }
+
+   perf_test_add_metric (
+      test, "apm_round_trips", (double) round_trips / iterations);
+   perf_test_add_metric (
+      test, "apm_round_trip_sec", (double) duration_usec / 1e6 / iterations);
+   perf_test_add_metric (test,
+                         "apm_driver_sec",
+                         (double) (total_time - duration_usec) / 1e6 /
+                            iterations);
+   perf_test_add_metric (
+      test, "apm_round_trips_per_mb", (double) round_trips / (bytes / 1e6));
+}
+
+
+void
+perf_test_init (perf_test_t *test,
+                const char *name,
+                const char *data_path,
+                int64_t data_sz)
+{
+   test->name = name;
+   test->data_path = data_path;
+   test->data_sz = data_sz;
+
+   test->setup = perf_test_setup;
+   test->before = perf_test_before;
+   test->task = perf_test_task;
+   test->after = perf_test_after;
+   test->teardown = perf_test_teardown;
+   test->report_wire_bytes = false;
+   test->report_commands = false;
+   test->report_peak_rss = false;
+   test->n_metrics = 0;
+   test->worker_cpus = NULL;
+   test->mutex_sites = NULL;
+}
+
+
+static FILE *output;
+static bool is_first_test;
+
+void
+open_output (void)
+{
+   printf ("opening results.json\n");
+   output = fopen ("results.json", "w");
+
+   if (!output) {
+      perror ("results.json");
+      abort ();
+   }
+}
+
+
+void
+close_output (void)
+{
+   fclose (output);
+}
+
+
+void
+print_header (void)
+{
+   fprintf (output, "[\n");
+
+   is_first_test = true;
+}
+
+
+static void
+print_metric (const char *name, double value, bool is_last)
+{
+   fprintf (output,
+            "      {\n"
+            "        \"name\": \"%s\",\n"
+            "        \"value\": %f\n"
+            "      }%s\n",
+            name,
+            value,
+            is_last ? "" : ",");
+}
+
+
+static void
+print_result (perf_test_t *test, double ops_per_sec)
+{
+   int i;
+
+   if (!is_first_test) {
+      fprintf (output, ",\n");
+   }
+
+   is_first_test = false;
+
+   fprintf (output,
+            "  {\n"
+            "    \"info\": {\n"
+            "      \"test_name\": \"%s\"",
+            test->name);
+
+   if (test->worker_cpus) {
+      fprintf (output,
+               ",\n"
+               "      \"placement\": \"%s\",\n"
+               "      \"worker_cpus\": %s",
+               perf_placement_name (perf_placement ()),
+               test->worker_cpus);
+   }
+
+   if (test->mutex_sites) {
+      fprintf (output,
+               ",\n"
+               "      \"mutex_sites\": %s",
+               test->mutex_sites);
+   }
+
+   fprintf (output,
+            "\n"
+            "    },\n"
+            "    \"metrics\": [\n");
+
+   print_metric ("ops_per_sec", ops_per_sec, test->n_metrics == 0);
+
+   for (i = 0; i < test->n_metrics; i++) {
+      print_metric (test->metrics[i].name,
+                    test->metrics[i].value,
+                    i == test->n_metrics - 1);
+   }
+
+   fprintf (output,
+            "    ]\n"
+            "  }");
+}
+
+
+void
+print_footer (void)
+{
+   fprintf (output,
+            "\n"
+            "]\n");
+}
+
+
+static int64_t
+get_cpu_time (void)
+{
+   struct rusage usage;
+
+   if (getrusage (RUSAGE_SELF, &usage) != 0) {
+      perror ("getrusage");
+      abort ();
+   }
+
+   return (int64_t) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+          usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+/* a "field: value" line of a /proc file, such as VmHWM in
+ * /proc/self/status in kB, or -1 if unknown */
+static int64_t
+read_proc_field (const char *path, const char *field)
+{
+   FILE *fp;
+   char line[256];
+   size_t len;
+   int64_t value = -1;
+
+   fp = fopen (path, "r");
+   if (!fp) {
+      return -1;
+   }
+
+   len = strlen (field);
+   while (fgets (line, sizeof (line), fp)) {
+      if (!strncmp (line, field, len) && line[len] == ':') {
+         value = strtoll (line + len + 1, NULL, 10);
+         break;
+      }
+   }
+
+   fclose (fp);
+
+   return value;
+}
+
+
+int64_t
+perf_proc_io (const char *field)
+{
+   return read_proc_field ("/proc/self/io", field);
+}
+
+
+/* reset VmHWM, the peak RSS, to the current RSS (Linux 4.0+) */
+static bool
+reset_peak_rss (void)
+{
+   FILE *fp;
+   bool ok;
+
+   fp = fopen ("/proc/self/clear_refs", "w");
+   if (!fp) {
+      return false;
+   }
+
+   ok = fputs ("5", fp) >= 0;
+   ok = fclose (fp) == 0 && ok;
+
+   return ok;
+}
+
+
+/* read the server's network counters, which count compressed bytes */
+static void
+get_wire_bytes (mongoc_client_t *client, int64_t *bytes_in, int64_t *bytes_out)
+{
+   bson_t *cmd;
+   bson_t reply;
+   bson_iter_t iter;
+   bson_error_t error;
+
+   cmd = BCON_NEW ("serverStatus", BCON_INT32 (1));
+   if (!mongoc_client_command_simple (
+          client, "admin", cmd, NULL, &reply, &error)) {
+      MONGOC_ERROR ("serverStatus: %s\n", error.message);
+      abort ();
+   }
+
+   if (!bson_iter_init (&iter, &reply) ||
+       !bson_iter_find_descendant (&iter, "network.bytesIn", &iter)) {
+      MONGOC_ERROR ("serverStatus: no network.bytesIn\n");
+      abort ();
+   }
+
+   *bytes_in = bson_iter_as_int64 (&iter);
+
+   if (!bson_iter_init (&iter, &reply) ||
+       !bson_iter_find_descendant (&iter, "network.bytesOut", &iter)) {
+      MONGOC_ERROR ("serverStatus: no network.bytesOut\n");
+      abort ();
+   }
+
+   *bytes_out = bson_iter_as_int64 (&iter);
+
+   bson_destroy (&reply);
+   bson_destroy (cmd);
+}
+
+
+/* serverStatus fields snapshotted after "setup" and after the last
+ * iteration. Fields a server doesn't report are skipped. */
+typedef struct {
+   const char *path;
+   const char *metric;
+   /* report the change per iteration, else the value after the test */
+   bool counter;
+} server_status_field_t;
+
+static const server_status_field_t SERVER_STATUS_FIELDS[] = {
+   {"opcounters.insert", "server_opcounters_insert", true},
+   {"opcounters.query", "server_opcounters_query", true},
+   {"opcounters.update", "server_opcounters_update", true},
+   {"opcounters.delete", "server_opcounters_delete", true},
+   {"opcounters.getmore", "server_opcounters_getmore", true},
+   {"opcounters.command", "server_opcounters_command", true},
+   {"network.bytesIn", "server_bytes_in", true},
+   {"network.bytesOut", "server_bytes_out", true},
+   {"network.numRequests", "server_num_requests", true},
+   {"wiredTiger.cache.bytes read into cache",
+    "server_wt_cache_bytes_read",
+    true},
+   {"wiredTiger.cache.bytes written from cache",
+    "server_wt_cache_bytes_written",
+    true},
+   {"wiredTiger.cache.pages evicted by application threads",
+    "server_wt_app_thread_evictions",
+    true},
+   {"wiredTiger.cache.bytes currently in the cache",
+    "server_wt_cache_bytes",
+    false},
+   {"queues.execution.read.totalTimeQueuedMicros",
+    "server_read_ticket_queued_usec",
+    true},
+   {"queues.execution.write.totalTimeQueuedMicros",
+    "server_write_ticket_queued_usec",
+    true},
+   {"connections.current", "server_connections_current", false},
+   {"connections.totalCreated", "server_connections_created", true},
+};
+
+#define N_SERVER_STATUS_FIELDS \
+   (sizeof (SERVER_STATUS_FIELDS) / sizeof (SERVER_STATUS_FIELDS[0]))
+
+typedef struct {
+   bool ok;
+   bool found[N_SERVER_STATUS_FIELDS];
+   int64_t values[N_SERVER_STATUS_FIELDS];
+} server_status_t;
+
+/* set once serverStatus fails, e.g. no server for the bson suite */
+static bool g_server_status_disabled;
+
+
+static mongoc_client_t *
+server_status_client_new (void)
+{
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+
+   if (g_server_status_disabled) {
+      return NULL;
+   }
+
+   /* don't wait long for a server that isn't there */
+   uri = perf_uri_new ();
+   mongoc_uri_set_option_as_int32 (
+      uri, MONGOC_URI_SERVERSELECTIONTIMEOUTMS, 1000);
+   client = mongoc_client_new_from_uri (uri);
+   mongoc_uri_destroy (uri);
+
+   return client;
+}
+
+
+static void
+server_status_snapshot (mongoc_client_t *client, server_status_t *status)
+{
+   bson_t *cmd;
+   bson_t reply;
+   bson_iter_t iter;
+   bson_error_t error;
+   size_t i;
+
+   status->ok = false;
+   if (!client || g_server_status_disabled) {
+      return;
+   }
+
+   cmd = BCON_NEW ("serverStatus", BCON_INT32 (1));
+   if (!mongoc_client_command_simple (
+          client, "admin", cmd, NULL, &reply, &error)) {
+      fprintf (stderr,
+               "serverStatus failed, not recording server metrics: %s\n",
+               error.message);
+      g_server_status_disabled = true;
+      bson_destroy (&reply);
+      bson_destroy (cmd);
+      return;
+   }
+
+   for (i = 0; i < N_SERVER_STATUS_FIELDS; i++) {
+      status->found[i] =
+         bson_iter_init (&iter, &reply) &&
+         bson_iter_find_descendant (
+            &iter, SERVER_STATUS_FIELDS[i].path, &iter);
+      status->values[i] = status->found[i] ? bson_iter_as_int64 (&iter) : 0;
+   }
+
+   status->ok = true;
+
+   bson_destroy (&reply);
+   bson_destroy (cmd);
+}
+
+
+/* add "server_*" metrics: counters' changes per iteration, including the
+ * work of "before" and "after", and gauges' values after the test */
+static void
+server_status_report (perf_test_t *test,
+                      const server_status_t *start,
+                      const server_status_t *end,
+                      size_t iterations)
+{
+   const server_status_field_t *field;
+   size_t i;
+
+   if (!start->ok || !end->ok) {
+      return;
+   }
+
+   for (i = 0; i < N_SERVER_STATUS_FIELDS; i++) {
+      field = &SERVER_STATUS_FIELDS[i];
+      if (!end->found[i]) {
+         continue;
+      }
+
+      if (!field->counter) {
+         perf_test_add_metric (test, field->metric, (double) end->values[i]);
+      } else if (start->found[i]) {
+         perf_test_add_metric (test,
+                               field->metric,
+                               (double) (end->values[i] - start->values[i]) /
+                                  iterations);
+      }
+   }
+}
+
+
+/* the sites in the "mutex_sites" info of each result */
+#define MUTEX_PROFILER_TOP_SITES 10
+
+static bool g_mutex_profiler_checked;
+static perf_mutex_profiler_reset_t g_mutex_profiler_reset;
+static perf_mutex_profiler_pause_t g_mutex_profiler_pause;
+static perf_mutex_profiler_sites_t g_mutex_profiler_sites;
+
+
+/* find libmongo-c-performance-mutex-profiler's functions, if it was loaded
+ * with LD_PRELOAD */
+static bool
+mutex_profiler_loaded (void)
+{
+   void *self;
+
+   if (!g_mutex_profiler_checked) {
+      g_mutex_profiler_checked = true;
+      self = dlopen (NULL, RTLD_LAZY);
+      if (self) {
+         g_mutex_profiler_reset = (perf_mutex_profiler_reset_t) dlsym (
+            self, "perf_mutex_profiler_reset");
+         g_mutex_profiler_pause = (perf_mutex_profiler_pause_t) dlsym (
+            self, "perf_mutex_profiler_pause");
+         g_mutex_profiler_sites = (perf_mutex_profiler_sites_t) dlsym (
+            self, "perf_mutex_profiler_sites");
+         dlclose (self);
+      }
+
+      if (g_mutex_profiler_reset && g_mutex_profiler_pause &&
+          g_mutex_profiler_sites) {
+         printf ("profiling mutexes\n");
+      }
+   }
+
+   return g_mutex_profiler_reset && g_mutex_profiler_pause &&
+          g_mutex_profiler_sites;
+}
+
+
+static void
+mutex_profiler_reset (void)
+{
+   if (mutex_profiler_loaded ()) {
+      g_mutex_profiler_reset ();
+   }
+}
+
+
+/* only count locks during test->task, not the hooks around it or the
+ * harness's own clients */
+static void
+mutex_profiler_pause (bool paused)
+{
+   if (mutex_profiler_loaded ()) {
+      g_mutex_profiler_pause (paused);
+   }
+}
+
+
+/* add "mutex_locks", "mutex_contended" and "mutex_wait_sec" per iteration
+ * over all call sites, and the top sites by wait time as "mutex_sites" */
+static void
+mutex_profiler_report (perf_test_t *test, size_t iterations)
+{
+   perf_mutex_site_t *sites;
+   perf_mutex_site_t *site;
+   int64_t n_locks = 0;
+   int64_t n_contended = 0;
+   int64_t wait_nsec = 0;
+   size_t n;
+   size_t sz;
+   size_t len;
+   size_t i;
+
+   if (!mutex_profiler_loaded () || !iterations) {
+      return;
+   }
+
+   sites = (perf_mutex_site_t *) bson_malloc (
+      (PERF_MUTEX_PROFILER_N_SITES + 1) * sizeof (perf_mutex_site_t));
+   n = g_mutex_profiler_sites (sites, PERF_MUTEX_PROFILER_N_SITES + 1);
+   for (i = 0; i < n; i++) {
+      n_locks += sites[i].n_locks;
+      n_contended += sites[i].n_contended;
+      wait_nsec += sites[i].wait_nsec;
+   }
+
+   perf_test_add_metric (test, "mutex_locks", (double) n_locks / iterations);
+   perf_test_add_metric (
+      test, "mutex_contended", (double) n_contended / iterations);
+   perf_test_add_metric (
+      test, "mutex_wait_sec", (double) wait_nsec / 1e9 / iterations);
+
+   n = BSON_MIN (n, MUTEX_PROFILER_TOP_SITES);
+   sz = 2 + n * 512 + 1;
+   bson_free (test->mutex_sites);
+   test->mutex_sites = bson_malloc (sz);
+   len = bson_snprintf (test->mutex_sites, sz, "[");
+   for (i = 0; i < n; i++) {
+      site = &sites[i];
+      len += bson_snprintf (test->mutex_sites + len,
+                            sz - len,
+                            "%s{\"site\": \"%s\", "
+                            "\"locks\": %.1f, "
+                            "\"contended\": %.1f, "
+                            "\"wait_usec\": %.1f, "
+                            "\"hold_usec\": %.1f, "
+                            "\"cond_waits\": %.1f, "
+                            "\"cond_wait_usec\": %.1f}",
+                            i ? ", " : "",
+                            site->name,
+                            (double) site->n_locks / iterations,
+                            (double) site->n_contended / iterations,
+                            (double) site->wait_nsec / 1e3 / iterations,
+                            (double) site->hold_nsec / 1e3 / iterations,
+                            (double) site->n_cond_waits / iterations,
+                            (double) site->cond_wait_nsec / 1e3 / iterations);
+   }
+
+   bson_snprintf (test->mutex_sites + len, sz - len, "]");
+   bson_free (sites);
+}
+
+
+void
+run_perf_tests (perf_test_t **tests)
+{
+   perf_test_t *test;
+   int64_t *results;
+   size_t results_sz;
+   int test_idx;
+   size_t i;
+   int64_t task_start;
+   int64_t total_time;
+   int64_t min_time;
+   int64_t max_time;
+   int median_idx;
+   double median;
+   double ops_per_sec;
+   int64_t cpu_start;
+   int64_t total_cpu_time;
+   mongoc_client_t *status_client;
+   int64_t in_start;
+   int64_t out_start;
+   int64_t in_end;
+   int64_t out_end;
+   int64_t in_overhead;
+   int64_t out_overhead;
+   int64_t total_in;
+   int64_t total_out;
+   mongoc_client_t *server_status_client;
+   server_status_t server_status_start;
+   server_status_t server_status_end;
+   bool track_rss;
+   int64_t rss_start;
+   int64_t rss_end;
+   int64_t peak_rss;
+   int64_t peak_rss_growth;
+
+   if (g_quick) {
+      min_time = max_time = TIME_USEC_QUICK;
+   } else {
+      min_time = MIN_TIME_USEC;
+      max_time = MAX_TIME_USEC;
+   }
+
+   results_sz = NUM_ITERATIONS;
+   results = bson_malloc (results_sz * sizeof (int64_t));
+
+   test_idx = 0;
+   while (tests[test_idx]) {
+      test = tests[test_idx];
+      if (should_run_test (test->name)) {
+         printf ("%20s\n", test->name);
+         fflush (stdout);
+         test->setup (test);
+
+         status_client = NULL;
+         in_overhead = out_overhead = 0;
+         if (test->report_wire_bytes) {
+            status_client = perf_client_new ();
+            /* measure the bytes of a serverStatus round trip itself */
+            get_wire_bytes (status_client, &in_start, &out_start);
+            get_wire_bytes (status_client, &in_end, &out_end);
+            in_overhead = in_end - in_start;
+            out_overhead = out_end - out_start;
+         }
+
+         if (test->report_commands || g_apm) {
+            apm_reset ();
+         }
+
+         server_status_client = server_status_client_new ();
+         server_status_snapshot (server_status_client, &server_status_start);
+         mutex_profiler_reset ();
+         mutex_profiler_pause (true);
+
+         /* run at least 1 min, stop at 100 loops or 5 mins, whichever first */
+         total_time = 0;
+         total_cpu_time = 0;
+         total_in = total_out = 0;
+         track_rss = test->report_peak_rss;
+         peak_rss = peak_rss_growth = 0;
+         for (i = 0; total_time < min_time ||
+                     (i < NUM_ITERATIONS && total_time < max_time);
+              i++) {
+            if (i >= results_sz) {
+               results_sz *= 2;
+               results = realloc (results, results_sz * sizeof (int64_t));
+            }
+
+            test->before (test);
+
+            if (status_client) {
+               get_wire_bytes (status_client, &in_start, &out_start);
+            }
+
+            if (track_rss) {
+               rss_start = read_proc_field ("/proc/self/status", "VmRSS");
+               track_rss = rss_start >= 0 && reset_peak_rss ();
+            }
+
+            if (g_apm) {
+               apm_set_in_task (true);
+            }
+
+            mutex_profiler_pause (false);
+            cpu_start = get_cpu_time ();
+            task_start = bson_get_monotonic_time ();
+            test->task (test);
+            total_time += results[i] = bson_get_monotonic_time () - task_start;
+            total_cpu_time += get_cpu_time () - cpu_start;
+            mutex_profiler_pause (true);
+
+            if (g_apm) {
+               apm_set_in_task (false);
+            }
+
+            if (track_rss) {
+               rss_end = read_proc_field ("/proc/self/status", "VmHWM");
+               peak_rss = BSON_MAX (peak_rss, rss_end);
+               peak_rss_growth =
+                  BSON_MAX (peak_rss_growth, rss_end - rss_start);
+            }
+
+            if (status_client) {
+               get_wire_bytes (status_client, &in_end, &out_end);
+               total_in += in_end - in_start - in_overhead;
+               total_out += out_end - out_start - out_overhead;
+            }
+
+            test->after (test);
+         }
+
+         printf ("Ran %zu iterations of %s\n", i, test->name);
+
+         mutex_profiler_report (test, i);
+
+         server_status_snapshot (server_status_client, &server_status_end);
+         server_status_report (
+            test, &server_status_start, &server_status_end, i);
+         if (server_status_client) {
+            mongoc_client_destroy (server_status_client);
+         }
+
+         perf_test_add_metric (
+            test, "client_cpu_sec", (double) total_cpu_time / 1e6 / i);
+
+         if (status_client) {
+            perf_test_add_metric (test, "wire_bytes_in", (double) total_in / i);
+            perf_test_add_metric (
+               test, "wire_bytes_out", (double) total_out / i);
+            mongoc_client_destroy (status_client);
+         }
+
+         if (test->report_commands) {
+            apm_report (test, i);
+         }
+
+         if (track_rss) {
+            perf_test_add_metric (test, "peak_rss_mb", peak_rss / 1024.0);
+            perf_test_add_metric (
+               test, "peak_rss_growth_mb", peak_rss_growth / 1024.0);
+         }
+
+         if (g_apm) {
+            apm_report_wire (test, i, total_time);
+         }
 
          qsort ((void *) results, i, sizeof (int64_t), cmp);
          median_idx = BSON_MIN (BSON_MAX (0, (int) i / 2), (int) i - 1);
          median = (double) (results[median_idx]) / 1e6;
          ops_per_sec = test->data_sz / median;
-         print_result (test->name, ops_per_sec);
          printf (" %9.0f\n", ops_per_sec);
 
+         /* teardown may add metrics, like latency percentiles */
          test->teardown (test);
+         print_result (test, ops_per_sec);
       }
 
+      bson_free (test->worker_cpus);
+      bson_free (test->mutex_sites);
       bson_free (test);
       test_idx++;
    }
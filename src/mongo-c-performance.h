@@ -22,6 +22,8 @@
 
 #include <stddef.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sys/types.h>
 
 extern const int NUM_ITERATIONS;
 extern const int NUM_DOCS;
@@ -31,6 +33,108 @@ typedef struct _perf_test_t perf_test_t;
 
 typedef void (*perf_callback_t) (perf_test_t *test);
 
+#define MAX_PERF_METRICS 128
+
+/* an extra metric reported in results.json next to ops_per_sec */
+typedef struct {
+   char name[64];
+   double value;
+} perf_metric_t;
+
+/* per-operation latencies in microseconds, reported as percentiles */
+typedef struct {
+   int64_t *samples;
+   size_t n;
+   size_t sz;
+} perf_latencies_t;
+
+/* command monitoring or structured logging that a test runs under, to
+ * measure the cost of observability */
+typedef enum {
+   PERF_OBSERVE_NONE,
+   PERF_OBSERVE_APM_NOOP,
+   PERF_OBSERVE_APM_SERIALIZE,
+   PERF_OBSERVE_LOG,
+} perf_observe_mode_t;
+
+typedef struct {
+   const char *name;
+   perf_observe_mode_t mode;
+   /* the max level for all components, with PERF_OBSERVE_LOG */
+   mongoc_structured_log_level_t log_level;
+} perf_observe_t;
+
+extern const perf_observe_t PERF_OBSERVE_MODES[];
+extern const size_t PERF_N_OBSERVE_MODES;
+
+/* a read preference for the replset suite */
+typedef struct {
+   const char *name;
+   mongoc_read_mode_t mode;
+   /* optional "dc" tag to prefer, falling back to any member */
+   const char *dc;
+   /* or MONGOC_NO_MAX_STALENESS */
+   int64_t max_staleness_seconds;
+} perf_read_pref_t;
+
+extern const perf_read_pref_t PERF_READ_PREFS[];
+extern const size_t PERF_N_READ_PREFS;
+
+/* long-lived threads for a parallel test's task, created in setup so thread
+ * creation isn't timed. Between runs the workers wait on a condition;
+ * perf_workers_run releases them together and returns once each has called
+ * the function on its context. */
+typedef void *(*perf_worker_fn_t) (void *ctx);
+
+typedef struct _perf_workers_t perf_workers_t;
+
+typedef struct {
+   perf_workers_t *workers;
+   pthread_t thread;
+   int index;
+   /* the CPU it last ran on, see thread-placement.h */
+   int cpu;
+   /* this worker's time in the function, in the last run and all runs */
+   int64_t usec;
+   int64_t total_usec;
+   /* what the function returned in the last run */
+   void *result;
+} perf_worker_t;
+
+struct _perf_workers_t {
+   perf_worker_t *workers;
+   int n;
+   pthread_mutex_t mutex;
+   pthread_cond_t start_cond;
+   pthread_cond_t done_cond;
+   /* incremented to start a run */
+   int64_t generation;
+   int n_running;
+   int64_t n_runs;
+   bool stop;
+   perf_worker_fn_t fn;
+   char *contexts;
+   size_t context_sz;
+};
+
+/* like perf_workers_t, but forked processes, to compare with threads at the
+ * same concurrency. Each child calls init once, with the context and its
+ * index, and calls fn on init's return value for each run. Children share
+ * nothing with the parent but a MAP_SHARED region, so they must create their
+ * own clients in init; fork them before the parent creates a pool or any
+ * other thread. */
+typedef void *(*perf_process_init_t) (void *ctx, int index);
+typedef void (*perf_process_fn_t) (void *state);
+
+typedef struct _perf_processes_shared_t perf_processes_shared_t;
+
+typedef struct {
+   int n;
+   pid_t *pids;
+   perf_processes_shared_t *shared;
+   size_t shared_sz;
+} perf_processes_t;
+
 struct _perf_test_t {
    const char *name;
    const char *data_path;
@@ -40,6 +144,18 @@ struct _perf_test_t {
    perf_callback_t task;
    perf_callback_t after;
    perf_callback_t teardown;
+   /* report serverStatus network bytes per iteration */
+   bool report_wire_bytes;
+   /* report commands per iteration, from clients with perf_apm callbacks */
+   bool report_commands;
+   /* report the process's peak RSS during the timed task (Linux only) */
+   bool report_peak_rss;
+   int n_metrics;
+   perf_metric_t metrics[MAX_PERF_METRICS];
+   /* a JSON array of the CPU each worker last ran on, or NULL */
+   char *worker_cpus;
+   /* a JSON array of the most contended mutex call sites, or NULL */
+   char *mutex_sites;
 };
 
 
@@ -47,6 +163,25 @@ void
 prep_tmp_dir (const char *path);
 void
 parse_args (int argc, char **argv);
+bool
+should_run_suite (const char *name, bool opt_in);
+/* the parser and writer threads from --pipeline M:K, false if not given */
+bool
+perf_pipeline_shape (int *n_parsers, int *n_writers);
+/* install a libbson allocator that counts allocations per thread; call
+ * before mongoc_init */
+void
+perf_mem_init (void);
+/* calls to bson_malloc, bson_realloc and the like on this thread so far */
+int64_t
+perf_thread_allocations (void);
+/* a field of /proc/self/io, such as "syscw", or -1 if unknown */
+int64_t
+perf_proc_io (const char *field);
+mongoc_uri_t *
+perf_uri_new (void);
+mongoc_client_t *
+perf_client_new (void);
 const char *
 get_ext (const char *filename);
 void
@@ -54,6 +189,8 @@ read_json_file (const char *data_path, bson_t *bson);
 void
 write_one_byte_file (mongoc_gridfs_t *gridfs);
 void
+set_uri_compressor (mongoc_uri_t *uri, const char *compressor, int32_t level);
+void
 run_test_as_utility (perf_test_t *test);
 void
 perf_test_init (perf_test_t *test,
@@ -61,6 +198,75 @@ perf_test_init (perf_test_t *test,
                 const char *data_path,
                 int64_t data_sz);
 void
+perf_test_add_metric (perf_test_t *test, const char *name, double value);
+/* format a suffix such as "/W:1" after test->name into name, a buffer of
+ * name_sz bytes, and point test->name at it. test->name may already be name,
+ * so wrappers can be stacked */
+void
+perf_test_append_name (perf_test_t *test,
+                       char *name,
+                       size_t name_sz,
+                       const char *format,
+                       ...) BSON_GNUC_PRINTF (4, 5);
+void
+perf_latencies_init (perf_latencies_t *latencies);
+/* make room for n samples in all, so adding them doesn't reallocate */
+void
+perf_latencies_reserve (perf_latencies_t *latencies, size_t n);
+void
+perf_latencies_add (perf_latencies_t *latencies, int64_t usec);
+void
+perf_latencies_merge (perf_latencies_t *dst, const perf_latencies_t *src);
+void
+perf_latencies_report (perf_test_t *test,
+                       const char *prefix,
+                       perf_latencies_t *latencies);
+void
+perf_latencies_destroy (perf_latencies_t *latencies);
+void
+perf_workers_init (perf_workers_t *workers, int n);
+void
+perf_workers_run (perf_workers_t *workers,
+                  perf_worker_fn_t fn,
+                  void *contexts,
+                  size_t context_sz);
+void
+perf_workers_report (perf_test_t *test, const perf_workers_t *workers);
+void
+perf_workers_destroy (perf_workers_t *workers);
+void
+perf_processes_init (perf_processes_t *processes,
+                     int n,
+                     perf_process_init_t init,
+                     perf_process_fn_t fn,
+                     void *ctx);
+void
+perf_processes_run (perf_processes_t *processes);
+void
+perf_processes_report (perf_test_t *test, const perf_processes_t *processes);
+void
+perf_processes_destroy (perf_processes_t *processes);
+bool
+is_replica_set (void);
+int32_t
+server_max_wire_version (void);
+int32_t
+replica_set_size (void);
+mongoc_read_prefs_t *
+perf_read_prefs_new (const perf_read_pref_t *read_pref);
+void
+perf_apm_set_callbacks (mongoc_client_t *client);
+void
+perf_apm_set_pool_callbacks (mongoc_client_pool_t *pool);
+void
+perf_apm_instrument (mongoc_client_t *client);
+void
+perf_apm_instrument_pool (mongoc_client_pool_t *pool);
+void
+perf_observe_client (mongoc_client_t *client, const perf_observe_t *observe);
+void
+perf_observe_pool (mongoc_client_pool_t *pool, const perf_observe_t *observe);
+void
 perf_test_teardown (perf_test_t *test);
 void
 perf_test_setup (perf_test_t *test);
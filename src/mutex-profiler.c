@@ -0,0 +1,417 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* An LD_PRELOAD library that profiles mutex contention, see
+ * mutex-profiler.h. It only depends on libc and libdl, and must not allocate
+ * or lock in the interposed functions: the sites are a fixed open-addressing
+ * table updated with atomics, and each thread tracks the mutexes it holds in
+ * thread-local storage. */
+
+/* for RTLD_NEXT, dladdr and dlvsym */
+#define _GNU_SOURCE
+
+#include "mutex-profiler.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* a power of two */
+#define N_SITES PERF_MUTEX_PROFILER_N_SITES
+/* mutexes a thread can hold at once and still have their hold time counted */
+#define MAX_HELD 32
+
+typedef struct {
+   _Atomic (uintptr_t) site;
+   _Atomic (int64_t) n_locks;
+   _Atomic (int64_t) n_contended;
+   _Atomic (int64_t) wait_nsec;
+   _Atomic (int64_t) hold_nsec;
+   _Atomic (int64_t) n_cond_waits;
+   _Atomic (int64_t) cond_wait_nsec;
+} site_t;
+
+typedef struct {
+   pthread_mutex_t *mutex;
+   site_t *site;
+   int64_t start;
+} held_t;
+
+static site_t g_sites[N_SITES];
+/* for call sites that don't fit in g_sites */
+static site_t g_overflow;
+
+/* see perf_mutex_profiler_pause */
+static _Atomic (bool) g_paused;
+static _Atomic (int64_t) g_resumed;
+
+static __thread held_t t_held[MAX_HELD]
+   __attribute__ ((tls_model ("initial-exec")));
+static __thread int t_n_held __attribute__ ((tls_model ("initial-exec")));
+
+static int (*real_mutex_lock) (pthread_mutex_t *);
+static int (*real_mutex_unlock) (pthread_mutex_t *);
+static int (*real_cond_wait) (pthread_cond_t *, pthread_mutex_t *);
+static int (*real_cond_timedwait) (pthread_cond_t *,
+                                   pthread_mutex_t *,
+                                   const struct timespec *);
+
+static void *
+_resolve_symbol (const char *name)
+{
+   void *sym = NULL;
+
+#ifdef __GLIBC__
+   /* dlsym returns the pre-2.3.2 pthread_cond_* on some platforms, which
+    * must not be mixed with conditions initialized by the current ones */
+   sym = dlvsym (RTLD_NEXT, name, "GLIBC_2.3.2");
+#endif
+   if (!sym) {
+      sym = dlsym (RTLD_NEXT, name);
+   }
+
+   if (!sym) {
+      fprintf (stderr, "mutex profiler: can't find %s\n", name);
+      abort ();
+   }
+
+   return sym;
+}
+
+__attribute__ ((constructor)) static void
+_resolve (void)
+{
+   if (real_mutex_lock) {
+      return;
+   }
+
+   real_mutex_unlock = _resolve_symbol ("pthread_mutex_unlock");
+   real_cond_wait = _resolve_symbol ("pthread_cond_wait");
+   real_cond_timedwait = _resolve_symbol ("pthread_cond_timedwait");
+   real_mutex_lock = _resolve_symbol ("pthread_mutex_lock");
+}
+
+static int64_t
+_now (void)
+{
+   struct timespec ts;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* the time since start to count, or -1 while paused */
+static int64_t
+_elapsed (int64_t start)
+{
+   int64_t resumed;
+
+   if (atomic_load_explicit (&g_paused, memory_order_relaxed)) {
+      return -1;
+   }
+
+   resumed = atomic_load_explicit (&g_resumed, memory_order_relaxed);
+
+   return _now () - (start > resumed ? start : resumed);
+}
+
+static site_t *
+_find_site (const void *addr)
+{
+   uintptr_t site = (uintptr_t) addr;
+   uintptr_t found;
+   size_t i;
+   size_t n;
+
+   i = (size_t) ((site >> 4) * 2654435761u) & (N_SITES - 1);
+   for (n = 0; n < N_SITES; n++, i = (i + 1) & (N_SITES - 1)) {
+      found = atomic_load_explicit (&g_sites[i].site, memory_order_acquire);
+      if (found == site) {
+         return &g_sites[i];
+      }
+
+      if (found == 0) {
+         if (atomic_compare_exchange_strong (&g_sites[i].site, &found, site) ||
+             found == site) {
+            return &g_sites[i];
+         }
+      }
+   }
+
+   return &g_overflow;
+}
+
+static void
+_add (_Atomic (int64_t) *counter, int64_t value)
+{
+   atomic_fetch_add_explicit (counter, value, memory_order_relaxed);
+}
+
+static void
+_push_held (pthread_mutex_t *mutex, site_t *site)
+{
+   if (t_n_held < MAX_HELD) {
+      t_held[t_n_held].mutex = mutex;
+      t_held[t_n_held].site = site;
+      t_held[t_n_held].start = _now ();
+      t_n_held++;
+   }
+}
+
+/* add the time since the latest lock of mutex to its site's hold time */
+static void
+_pop_held (pthread_mutex_t *mutex)
+{
+   int64_t elapsed;
+   int i;
+
+   for (i = t_n_held - 1; i >= 0; i--) {
+      if (t_held[i].mutex == mutex) {
+         elapsed = _elapsed (t_held[i].start);
+         if (elapsed >= 0) {
+            _add (&t_held[i].site->hold_nsec, elapsed);
+         }
+
+         t_held[i] = t_held[--t_n_held];
+         return;
+      }
+   }
+}
+
+int
+pthread_mutex_lock (pthread_mutex_t *mutex)
+{
+   site_t *site;
+   int64_t start;
+   int64_t elapsed;
+   int ret;
+
+   _resolve ();
+   site = _find_site (__builtin_return_address (0));
+
+   ret = pthread_mutex_trylock (mutex);
+   if (ret == EBUSY) {
+      start = _now ();
+      ret = real_mutex_lock (mutex);
+      elapsed = _elapsed (start);
+      if (ret == 0 && elapsed >= 0) {
+         _add (&site->n_contended, 1);
+         _add (&site->wait_nsec, elapsed);
+      }
+   }
+
+   if (ret == 0) {
+      if (!atomic_load_explicit (&g_paused, memory_order_relaxed)) {
+         _add (&site->n_locks, 1);
+      }
+
+      _push_held (mutex, site);
+   }
+
+   return ret;
+}
+
+int
+pthread_mutex_unlock (pthread_mutex_t *mutex)
+{
+   _resolve ();
+   _pop_held (mutex);
+
+   return real_mutex_unlock (mutex);
+}
+
+/* the wait releases the mutex, ending a hold, and the mutex is held again
+ * from this site afterward */
+int
+pthread_cond_wait (pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+   site_t *site;
+   int64_t start;
+   int64_t elapsed;
+   int ret;
+
+   _resolve ();
+   site = _find_site (__builtin_return_address (0));
+   _pop_held (mutex);
+
+   start = _now ();
+   ret = real_cond_wait (cond, mutex);
+   elapsed = _elapsed (start);
+   if (elapsed >= 0) {
+      _add (&site->n_cond_waits, 1);
+      _add (&site->cond_wait_nsec, elapsed);
+   }
+
+   _push_held (mutex, site);
+
+   return ret;
+}
+
+int
+pthread_cond_timedwait (pthread_cond_t *cond,
+                        pthread_mutex_t *mutex,
+                        const struct timespec *abstime)
+{
+   site_t *site;
+   int64_t start;
+   int64_t elapsed;
+   int ret;
+
+   _resolve ();
+   site = _find_site (__builtin_return_address (0));
+   _pop_held (mutex);
+
+   start = _now ();
+   ret = real_cond_timedwait (cond, mutex, abstime);
+   elapsed = _elapsed (start);
+   if (elapsed >= 0) {
+      _add (&site->n_cond_waits, 1);
+      _add (&site->cond_wait_nsec, elapsed);
+   }
+
+   _push_held (mutex, site);
+
+   return ret;
+}
+
+void
+perf_mutex_profiler_reset (void)
+{
+   site_t *site;
+   size_t i;
+
+   for (i = 0; i <= N_SITES; i++) {
+      site = i < N_SITES ? &g_sites[i] : &g_overflow;
+      atomic_store (&site->n_locks, 0);
+      atomic_store (&site->n_contended, 0);
+      atomic_store (&site->wait_nsec, 0);
+      atomic_store (&site->hold_nsec, 0);
+      atomic_store (&site->n_cond_waits, 0);
+      atomic_store (&site->cond_wait_nsec, 0);
+   }
+}
+
+void
+perf_mutex_profiler_pause (bool paused)
+{
+   if (!paused) {
+      atomic_store (&g_resumed, _now ());
+   }
+
+   atomic_store (&g_paused, paused);
+}
+
+/* "libmongoc2.so.2!mongoc_client_pool_pop+0x4f", or "object+0x..." if the
+ * symbol isn't exported */
+static void
+_site_name (const void *addr, char *name, size_t name_sz)
+{
+   Dl_info info;
+   const char *object;
+
+   if (!addr) {
+      snprintf (name, name_sz, "other");
+      return;
+   }
+
+   if (!dladdr (addr, &info) || !info.dli_fname) {
+      snprintf (name, name_sz, "%p", addr);
+      return;
+   }
+
+   object = strrchr (info.dli_fname, '/');
+   object = object ? object + 1 : info.dli_fname;
+   if (info.dli_sname) {
+      snprintf (name,
+                name_sz,
+                "%s!%s+0x%tx",
+                object,
+                info.dli_sname,
+                (const char *) addr - (const char *) info.dli_saddr);
+   } else {
+      snprintf (name,
+                name_sz,
+                "%s+0x%tx",
+                object,
+                (const char *) addr - (const char *) info.dli_fbase);
+   }
+}
+
+static int
+_cmp_wait (const void *a, const void *b)
+{
+   const perf_mutex_site_t *x = (const perf_mutex_site_t *) a;
+   const perf_mutex_site_t *y = (const perf_mutex_site_t *) b;
+
+   if (x->wait_nsec != y->wait_nsec) {
+      return x->wait_nsec < y->wait_nsec ? 1 : -1;
+   }
+
+   return x->hold_nsec < y->hold_nsec   ? 1
+          : x->hold_nsec > y->hold_nsec ? -1
+                                        : 0;
+}
+
+size_t
+perf_mutex_profiler_sites (perf_mutex_site_t *sites, size_t max)
+{
+   perf_mutex_site_t *all;
+   perf_mutex_site_t *out;
+   site_t *site;
+   size_t n;
+   size_t i;
+
+   all = (perf_mutex_site_t *) calloc (N_SITES + 1, sizeof (*all));
+   if (!all) {
+      abort ();
+   }
+
+   n = 0;
+   for (i = 0; i <= N_SITES; i++) {
+      site = i < N_SITES ? &g_sites[i] : &g_overflow;
+      out = &all[n];
+      out->n_locks = atomic_load (&site->n_locks);
+      out->n_cond_waits = atomic_load (&site->n_cond_waits);
+      if (!out->n_locks && !out->n_cond_waits) {
+         continue;
+      }
+
+      out->site = (const void *) atomic_load (&site->site);
+      out->n_contended = atomic_load (&site->n_contended);
+      out->wait_nsec = atomic_load (&site->wait_nsec);
+      out->hold_nsec = atomic_load (&site->hold_nsec);
+      out->cond_wait_nsec = atomic_load (&site->cond_wait_nsec);
+      n++;
+   }
+
+   qsort (all, n, sizeof (*all), _cmp_wait);
+
+   n = n < max ? n : max;
+   for (i = 0; i < n; i++) {
+      _site_name (all[i].site, all[i].name, sizeof (all[i].name));
+      sites[i] = all[i];
+   }
+
+   free (all);
+
+   return n;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGO_C_PERFORMANCE_MUTEX_PROFILER_H
+#define MONGO_C_PERFORMANCE_MUTEX_PROFILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The interface of libmongo-c-performance-mutex-profiler, a library to run
+ * mongo-c-performance under with LD_PRELOAD. It interposes
+ * pthread_mutex_lock, pthread_mutex_unlock, pthread_cond_wait and
+ * pthread_cond_timedwait, and counts per call site, the address a lock was
+ * taken from, how long threads waited for the mutex and held it.
+ *
+ * mongo-c-performance doesn't link the library; it looks these functions up
+ * with dlsym and reports nothing if they aren't loaded. */
+
+/* the most call sites it tracks separately; it adds up the rest in one
+ * more, whose site is NULL */
+#define PERF_MUTEX_PROFILER_N_SITES 4096
+
+typedef struct {
+   /* the return address of the lock call, and its "object!symbol+offset" */
+   const void *site;
+   char name[128];
+   int64_t n_locks;
+   /* locks that found the mutex taken, and the time they waited for it */
+   int64_t n_contended;
+   int64_t wait_nsec;
+   /* time from the lock to the unlock, or to a condition wait */
+   int64_t hold_nsec;
+   /* condition waits from this site, and the time in them */
+   int64_t n_cond_waits;
+   int64_t cond_wait_nsec;
+} perf_mutex_site_t;
+
+/* zero the counters of every site */
+typedef void (*perf_mutex_profiler_reset_t) (void);
+/* stop or resume counting. Waits and holds in progress when counting
+ * resumes count from then on */
+typedef void (*perf_mutex_profiler_pause_t) (bool paused);
+/* copy up to max sites, with the most wait_nsec first, and return how many */
+typedef size_t (*perf_mutex_profiler_sites_t) (perf_mutex_site_t *sites,
+                                               size_t max);
+
+void
+perf_mutex_profiler_reset (void);
+void
+perf_mutex_profiler_pause (bool paused);
+size_t
+perf_mutex_profiler_sites (perf_mutex_site_t *sites, size_t max);
+
+#endif // MONGO_C_PERFORMANCE_MUTEX_PROFILER_H
@@ -25,19 +25,49 @@
 #include <bson/bson.h>
 #include <mongoc/mongoc.h>
 
+#include <math.h>
 #include <pthread.h>
 
+struct _parallel_pool_perf_test_t;
+
 typedef struct {
-   pthread_t thread;
    mongoc_client_t *client;
    int n_operations_to_run;
+   /* with a read preference, record each operation's latency */
+   const mongoc_read_prefs_t *read_prefs;
+   perf_latencies_t latencies;
+   /* with pop_per_op, the operations this thread took from the test's
+    * budget and its time blocked in mongoc_client_pool_pop, over all
+    * iterations */
+   struct _parallel_pool_perf_test_t *test;
+   int64_t n_operations_done;
+   int64_t pop_wait_usec;
+   int64_t pop_wait_max_usec;
+   int64_t n_pop_timeouts;
 } parallel_pool_thread_context_t;
 
-typedef struct {
+typedef struct _parallel_pool_perf_test_t {
    perf_test_t base;
    mongoc_client_pool_t *pool;
    int n_threads;
    parallel_pool_thread_context_t *contexts;
+   perf_workers_t workers;
+   /* maxPoolSize and waitQueueTimeoutMS, or 0 for the defaults */
+   int max_pool_size;
+   int wait_queue_timeout_ms;
+   /* pop a client for each operation instead of holding one per thread,
+    * so there may be more threads than clients. The threads take
+    * operations from a shared budget until it runs out. */
+   bool pop_per_op;
+   pthread_mutex_t budget_mutex;
+   int64_t budget;
+   int n_iterations;
+   /* optional APM or structured logging, applied to the pool */
+   const perf_observe_t *observe;
+   /* optional read preference for the pings, and their latencies */
+   mongoc_read_prefs_t *read_prefs;
+   perf_latencies_t latencies;
+   char name[128];
 } parallel_pool_perf_test_t;
 
 /* PING_COMMAND_SIZE is the size of the BSON document {"ping": 1}.
@@ -49,12 +79,31 @@ typedef struct {
 static const int PING_COMMAND_SIZE = 15;
 /* OPERATION_COUNT is the total number of operations done by each thread. */
 static const int OPERATION_COUNT = 10000;
+/* POP_PER_OP_OPERATION_COUNT is the total number of operations done by all
+ * threads of a pop_per_op test. */
+static const int POP_PER_OP_OPERATION_COUNT = 100000;
+/* WAIT_QUEUE_TIMEOUT_MS is the waitQueueTimeoutMS of pools with more
+ * threads than clients */
+static const int WAIT_QUEUE_TIMEOUT_MS = 1000;
 
 /* MONGOC_DEFAULT_MAX_POOL_SIZE is the default number of clients that can be
  * popped at one time in a mongoc_client_pool_t */
 static const int MONGOC_DEFAULT_MAX_POOL_SIZE = 100;
 
 
+/* the pool's maxPoolSize, large enough for a thread holding each client
+ * unless the test sets it */
+static int
+_pool_size (const parallel_pool_perf_test_t *parallel_pool_test)
+{
+   if (parallel_pool_test->max_pool_size) {
+      return parallel_pool_test->max_pool_size;
+   }
+
+   return BSON_MAX (parallel_pool_test->n_threads,
+                    MONGOC_DEFAULT_MAX_POOL_SIZE);
+}
+
 static void
 parallel_pool_perf_setup (perf_test_t *test)
 {
@@ -66,13 +115,26 @@ parallel_pool_perf_setup (perf_test_t *test)
    mongoc_database_t *db;
    bson_error_t error;
    int i;
+   int pool_size;
    mongoc_client_t **clients;
 
-   clients =
-      bson_malloc0 (MONGOC_DEFAULT_MAX_POOL_SIZE * sizeof (mongoc_client_t *));
+   pool_size = _pool_size (parallel_pool_test);
+   clients = bson_malloc0 (pool_size * sizeof (mongoc_client_t *));
+
+   uri = perf_uri_new ();
+   mongoc_uri_set_option_as_int32 (uri, MONGOC_URI_MAXPOOLSIZE, pool_size);
+   if (parallel_pool_test->wait_queue_timeout_ms) {
+      mongoc_uri_set_option_as_int32 (
+         uri,
+         MONGOC_URI_WAITQUEUETIMEOUTMS,
+         parallel_pool_test->wait_queue_timeout_ms);
+   }
 
-   uri = mongoc_uri_new (NULL);
    pool = mongoc_client_pool_new (uri);
+   if (parallel_pool_test->observe) {
+      perf_observe_pool (pool, parallel_pool_test->observe);
+   }
+
    parallel_pool_test->pool = pool;
    parallel_pool_test->contexts =
       (parallel_pool_thread_context_t *) bson_malloc0 (
@@ -88,7 +150,7 @@ parallel_pool_perf_setup (perf_test_t *test)
    mongoc_database_destroy (db);
    mongoc_client_pool_push (pool, client);
    /* Warm up each connection by popping all clients and sending one ping. */
-   for (i = 0; i < MONGOC_DEFAULT_MAX_POOL_SIZE; i++) {
+   for (i = 0; i < pool_size; i++) {
       bson_t *cmd = BCON_NEW ("ping", BCON_INT32 (1));
 
       clients[i] = mongoc_client_pool_pop (pool);
@@ -103,18 +165,117 @@ parallel_pool_perf_setup (perf_test_t *test)
       }
       bson_destroy (cmd);
    }
-   for (i = 0; i < MONGOC_DEFAULT_MAX_POOL_SIZE; i++) {
+   for (i = 0; i < pool_size; i++) {
       mongoc_client_pool_push (pool, clients[i]);
    }
+   for (i = 0; i < parallel_pool_test->n_threads; i++) {
+      parallel_pool_test->contexts[i].test = parallel_pool_test;
+   }
+   if (parallel_pool_test->pop_per_op) {
+      pthread_mutex_init (&parallel_pool_test->budget_mutex, NULL);
+   }
+   perf_workers_init (&parallel_pool_test->workers,
+                      parallel_pool_test->n_threads);
+   if (parallel_pool_test->read_prefs) {
+      perf_latencies_init (&parallel_pool_test->latencies);
+      for (i = 0; i < parallel_pool_test->n_threads; i++) {
+         parallel_pool_test->contexts[i].read_prefs =
+            parallel_pool_test->read_prefs;
+         perf_latencies_init (&parallel_pool_test->contexts[i].latencies);
+      }
+   }
+
    mongoc_uri_destroy (uri);
    bson_free (clients);
 }
 
+/* report how evenly the threads shared the pool, and how long they waited
+ * for a client, per iteration */
+static void
+_report_pop_per_op (parallel_pool_perf_test_t *parallel_pool_test)
+{
+   perf_test_t *test = (perf_test_t *) parallel_pool_test;
+   parallel_pool_thread_context_t *ctx;
+   double n_iterations;
+   double ops;
+   double ops_min;
+   double ops_max;
+   double ops_sum;
+   double ops_sum_sq;
+   double mean;
+   double wait_usec;
+   double wait_max_usec;
+   double n_timeouts;
+   int i;
+
+   if (!parallel_pool_test->n_iterations) {
+      return;
+   }
+
+   n_iterations = (double) parallel_pool_test->n_iterations;
+   ops_min = ops_max =
+      (double) parallel_pool_test->contexts[0].n_operations_done;
+   ops_sum = ops_sum_sq = wait_usec = wait_max_usec = n_timeouts = 0;
+
+   for (i = 0; i < parallel_pool_test->n_threads; i++) {
+      ctx = &parallel_pool_test->contexts[i];
+      ops = (double) ctx->n_operations_done;
+      ops_min = BSON_MIN (ops_min, ops);
+      ops_max = BSON_MAX (ops_max, ops);
+      ops_sum += ops;
+      ops_sum_sq += ops * ops;
+      wait_usec += (double) ctx->pop_wait_usec;
+      wait_max_usec = BSON_MAX (wait_max_usec, (double) ctx->pop_wait_max_usec);
+      n_timeouts += (double) ctx->n_pop_timeouts;
+   }
+
+   /* the spread of operations per thread: the fewest, the most, and their
+    * coefficient of variation, 0 when every thread did the same number */
+   mean = ops_sum / parallel_pool_test->n_threads;
+   perf_test_add_metric (test, "thread_ops_min", ops_min / n_iterations);
+   perf_test_add_metric (test, "thread_ops_max", ops_max / n_iterations);
+   perf_test_add_metric (
+      test,
+      "thread_ops_cv",
+      mean > 0 ? sqrt (BSON_MAX (0.0,
+                                 ops_sum_sq / parallel_pool_test->n_threads -
+                                    mean * mean)) /
+                    mean
+               : 0);
+
+   /* time blocked in mongoc_client_pool_pop, summed over the threads */
+   perf_test_add_metric (
+      test, "pool_pop_wait_sec", wait_usec / 1e6 / n_iterations);
+   perf_test_add_metric (
+      test, "pool_pop_wait_usec_per_op", wait_usec / ops_sum);
+   perf_test_add_metric (test, "pool_pop_wait_max_usec", wait_max_usec);
+   perf_test_add_metric (test, "pool_pop_timeouts", n_timeouts / n_iterations);
+}
+
 static void
 parallel_pool_perf_teardown (perf_test_t *test)
 {
    parallel_pool_perf_test_t *parallel_pool_test =
       (parallel_pool_perf_test_t *) test;
+   int i;
+
+   perf_workers_report (test, &parallel_pool_test->workers);
+   perf_workers_destroy (&parallel_pool_test->workers);
+
+   if (parallel_pool_test->pop_per_op) {
+      _report_pop_per_op (parallel_pool_test);
+      pthread_mutex_destroy (&parallel_pool_test->budget_mutex);
+   }
+
+   if (parallel_pool_test->read_prefs) {
+      for (i = 0; i < parallel_pool_test->n_threads; i++) {
+         perf_latencies_destroy (&parallel_pool_test->contexts[i].latencies);
+      }
+
+      perf_latencies_report (test, NULL, &parallel_pool_test->latencies);
+      perf_latencies_destroy (&parallel_pool_test->latencies);
+      mongoc_read_prefs_destroy (parallel_pool_test->read_prefs);
+   }
 
    mongoc_client_pool_destroy (parallel_pool_test->pool);
    bson_free (parallel_pool_test->contexts);
@@ -127,6 +288,11 @@ parallel_pool_perf_before (perf_test_t *test)
       (parallel_pool_perf_test_t *) test;
    int i;
 
+   if (parallel_pool_test->pop_per_op) {
+      parallel_pool_test->budget = POP_PER_OP_OPERATION_COUNT;
+      return;
+   }
+
    for (i = 0; i < parallel_pool_test->n_threads; i++) {
       parallel_pool_test->contexts[i].client =
          mongoc_client_pool_pop (parallel_pool_test->pool);
@@ -141,10 +307,17 @@ parallel_pool_perf_after (perf_test_t *test)
       (parallel_pool_perf_test_t *) test;
    int i;
 
-
+   parallel_pool_test->n_iterations++;
    for (i = 0; i < parallel_pool_test->n_threads; i++) {
-      mongoc_client_pool_push (parallel_pool_test->pool,
-                               parallel_pool_test->contexts[i].client);
+      if (!parallel_pool_test->pop_per_op) {
+         mongoc_client_pool_push (parallel_pool_test->pool,
+                                  parallel_pool_test->contexts[i].client);
+      }
+      if (parallel_pool_test->read_prefs) {
+         perf_latencies_merge (&parallel_pool_test->latencies,
+                               &parallel_pool_test->contexts[i].latencies);
+         parallel_pool_test->contexts[i].latencies.n = 0;
+      }
    }
 }
 
@@ -153,6 +326,7 @@ _parallel_pool_perf_thread (void *p)
 {
    parallel_pool_thread_context_t *ctx = (parallel_pool_thread_context_t *) p;
    int i;
+   int64_t start;
    bson_t cmd = BSON_INITIALIZER;
 
    bson_append_int32 (&cmd, "ping", 4, 1);
@@ -160,51 +334,100 @@ _parallel_pool_perf_thread (void *p)
    for (i = 0; i < ctx->n_operations_to_run; i++) {
       bson_error_t error;
 
+      start = ctx->read_prefs ? bson_get_monotonic_time () : 0;
       if (!mongoc_client_command_simple (ctx->client,
                                          "db",
                                          &cmd,
-                                         NULL /* read prefs */,
+                                         ctx->read_prefs,
                                          NULL /* reply */,
                                          &error)) {
          MONGOC_ERROR ("Error from ping: %s", error.message);
          abort ();
       }
+
+      if (ctx->read_prefs) {
+         perf_latencies_add (&ctx->latencies,
+                             bson_get_monotonic_time () - start);
+      }
    }
 
    bson_destroy (&cmd);
    return NULL;
 }
 
-static void
-parallel_pool_perf_task (perf_test_t *test)
+/* take an operation from the shared budget, false once it runs out */
+static bool
+_take_operation (parallel_pool_perf_test_t *parallel_pool_test)
 {
-   parallel_pool_perf_test_t *parallel_pool_test =
-      (parallel_pool_perf_test_t *) test;
-   int i;
-   int ret;
-
-   for (i = 0; i < parallel_pool_test->n_threads; i++) {
-      parallel_pool_thread_context_t *ctx;
+   bool taken;
 
-      ctx = &parallel_pool_test->contexts[i];
-      ret = pthread_create (
-         &ctx->thread, NULL /* attr */, _parallel_pool_perf_thread, ctx);
-      if (ret != 0) {
-         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
-         abort ();
-      }
+   pthread_mutex_lock (&parallel_pool_test->budget_mutex);
+   taken = parallel_pool_test->budget > 0;
+   if (taken) {
+      parallel_pool_test->budget--;
    }
+   pthread_mutex_unlock (&parallel_pool_test->budget_mutex);
 
-   for (i = 0; i < parallel_pool_test->n_threads; i++) {
-      parallel_pool_thread_context_t *ctx;
+   return taken;
+}
 
-      ctx = &parallel_pool_test->contexts[i];
-      ret = pthread_join (ctx->thread, NULL /* out */);
-      if (ret != 0) {
-         MONGOC_ERROR ("Error: pthread_join returned %d", ret);
+static void *
+_parallel_pool_pop_per_op_thread (void *p)
+{
+   parallel_pool_thread_context_t *ctx = (parallel_pool_thread_context_t *) p;
+   mongoc_client_t *client;
+   int64_t start;
+   int64_t wait;
+   bson_t cmd = BSON_INITIALIZER;
+
+   bson_append_int32 (&cmd, "ping", 4, 1);
+
+   while (_take_operation (ctx->test)) {
+      bson_error_t error;
+
+      /* with waitQueueTimeoutMS, pop returns NULL after waiting that long;
+       * wait again so every operation in the budget is done */
+      do {
+         start = bson_get_monotonic_time ();
+         client = mongoc_client_pool_pop (ctx->test->pool);
+         wait = bson_get_monotonic_time () - start;
+         ctx->pop_wait_usec += wait;
+         ctx->pop_wait_max_usec = BSON_MAX (ctx->pop_wait_max_usec, wait);
+         if (!client) {
+            ctx->n_pop_timeouts++;
+         }
+      } while (!client);
+
+      if (!mongoc_client_command_simple (client,
+                                         "db",
+                                         &cmd,
+                                         NULL /* read prefs */,
+                                         NULL /* reply */,
+                                         &error)) {
+         MONGOC_ERROR ("Error from ping: %s", error.message);
          abort ();
       }
+
+      mongoc_client_pool_push (ctx->test->pool, client);
+      ctx->n_operations_done++;
    }
+
+   bson_destroy (&cmd);
+   return NULL;
+}
+
+static void
+parallel_pool_perf_task (perf_test_t *test)
+{
+   parallel_pool_perf_test_t *parallel_pool_test =
+      (parallel_pool_perf_test_t *) test;
+
+   perf_workers_run (&parallel_pool_test->workers,
+                     parallel_pool_test->pop_per_op
+                        ? _parallel_pool_pop_per_op_thread
+                        : _parallel_pool_perf_thread,
+                     parallel_pool_test->contexts,
+                     sizeof (parallel_pool_thread_context_t));
 }
 
 static perf_test_t *
@@ -216,18 +439,7 @@ parallel_pool_perf_new (const char *name, int n_threads)
    int64_t data_size;
 
    parallel_pool_test->n_threads = n_threads;
-   data_size = PING_COMMAND_SIZE * OPERATION_COUNT * n_threads;
-
-   if (n_threads > MONGOC_DEFAULT_MAX_POOL_SIZE) {
-      MONGOC_ERROR ("Error: trying to start test with %d threads.", n_threads);
-      MONGOC_ERROR ("Cannot start test with n_threads > %d.",
-                    MONGOC_DEFAULT_MAX_POOL_SIZE);
-      MONGOC_ERROR (
-         "libmongoc uses a default maxPoolSize of %d. Cannot pop more.",
-         MONGOC_DEFAULT_MAX_POOL_SIZE);
-      MONGOC_ERROR ("Consider revising this test to use a larger pool size.");
-      abort ();
-   }
+   data_size = (int64_t) PING_COMMAND_SIZE * OPERATION_COUNT * n_threads;
 
    perf_test_init (test, name, NULL /* data path */, data_size);
    test->task = parallel_pool_perf_task;
@@ -238,8 +450,80 @@ parallel_pool_perf_new (const char *name, int n_threads)
    return test;
 }
 
+/* run a pool test with command monitoring or structured logging */
+static perf_test_t *
+parallel_pool_perf_with_observe (perf_test_t *test,
+                                 const perf_observe_t *observe)
+{
+   parallel_pool_perf_test_t *parallel_pool_test =
+      (parallel_pool_perf_test_t *) test;
+
+   parallel_pool_test->observe = observe;
+   perf_test_append_name (test,
+                          parallel_pool_test->name,
+                          sizeof (parallel_pool_test->name),
+                          "/Observe:%s",
+                          observe->name);
+
+   return test;
+}
+
+/* run a pool test's pings with a read preference */
+static perf_test_t *
+parallel_pool_perf_with_read_prefs (perf_test_t *test,
+                                    const perf_read_pref_t *read_pref)
+{
+   parallel_pool_perf_test_t *parallel_pool_test =
+      (parallel_pool_perf_test_t *) test;
+
+   parallel_pool_test->read_prefs = perf_read_prefs_new (read_pref);
+   perf_test_append_name (test,
+                          parallel_pool_test->name,
+                          sizeof (parallel_pool_test->name),
+                          "/ReadPref:%s",
+                          read_pref->name);
+
+   return test;
+}
+
+/* threads that pop a client for each ping from a pool of max_pool_size,
+ * waiting at most wait_queue_timeout_ms if it is not 0 */
+static perf_test_t *
+parallel_pool_pop_per_op_perf_new (int n_threads,
+                                   int max_pool_size,
+                                   int wait_queue_timeout_ms)
+{
+   parallel_pool_perf_test_t *parallel_pool_test;
+   perf_test_t *test;
+   char timeout[64];
+
+   test = parallel_pool_perf_new (NULL /* name */, n_threads);
+   parallel_pool_test = (parallel_pool_perf_test_t *) test;
+   parallel_pool_test->max_pool_size = max_pool_size;
+   parallel_pool_test->wait_queue_timeout_ms = wait_queue_timeout_ms;
+   parallel_pool_test->pop_per_op = true;
+   test->data_sz = (int64_t) PING_COMMAND_SIZE * POP_PER_OP_OPERATION_COUNT;
+
+   timeout[0] = '\0';
+   if (wait_queue_timeout_ms) {
+      bson_snprintf (timeout,
+                     sizeof (timeout),
+                     "/WaitQueueTimeoutMS:%d",
+                     wait_queue_timeout_ms);
+   }
+
+   bson_snprintf (parallel_pool_test->name,
+                  sizeof (parallel_pool_test->name),
+                  "Parallel/PoolPopPerOp/Threads:%d/MaxPoolSize:%d%s",
+                  n_threads,
+                  max_pool_size,
+                  timeout);
+   test->name = parallel_pool_test->name;
+
+   return test;
+}
+
 typedef struct {
-   pthread_t thread;
    mongoc_client_t *client;
    int n_operations_to_run;
 } parallel_single_thread_context_t;
@@ -247,8 +531,11 @@ typedef struct {
 typedef struct {
    perf_test_t base;
    mongoc_client_t **clients;
+   /* at least a client per thread */
+   int n_clients;
    int n_threads;
    parallel_single_thread_context_t *contexts;
+   perf_workers_t workers;
 } parallel_single_perf_test_t;
 
 static void
@@ -262,10 +549,12 @@ parallel_single_perf_setup (perf_test_t *test)
    bson_error_t error;
    int i;
 
-   uri = mongoc_uri_new (NULL);
-   parallel_single_test->clients =
-      bson_malloc0 (MONGOC_DEFAULT_MAX_POOL_SIZE * sizeof (mongoc_client_t *));
-   for (i = 0; i < MONGOC_DEFAULT_MAX_POOL_SIZE; i++) {
+   uri = perf_uri_new ();
+   parallel_single_test->n_clients =
+      BSON_MAX (parallel_single_test->n_threads, MONGOC_DEFAULT_MAX_POOL_SIZE);
+   parallel_single_test->clients = bson_malloc0 (
+      parallel_single_test->n_clients * sizeof (mongoc_client_t *));
+   for (i = 0; i < parallel_single_test->n_clients; i++) {
       parallel_single_test->clients[i] = mongoc_client_new_from_uri (uri);
    }
    parallel_single_test->contexts =
@@ -281,7 +570,7 @@ parallel_single_perf_setup (perf_test_t *test)
    }
    mongoc_database_destroy (db);
    /* Warm up each connection by sending one ping to each client. */
-   for (i = 0; i < MONGOC_DEFAULT_MAX_POOL_SIZE; i++) {
+   for (i = 0; i < parallel_single_test->n_clients; i++) {
       bson_t *cmd = BCON_NEW ("ping", BCON_INT32 (1));
 
       client = parallel_single_test->clients[i];
@@ -296,6 +585,8 @@ parallel_single_perf_setup (perf_test_t *test)
       }
       bson_destroy (cmd);
    }
+   perf_workers_init (&parallel_single_test->workers,
+                      parallel_single_test->n_threads);
    mongoc_uri_destroy (uri);
 }
 
@@ -306,7 +597,9 @@ parallel_single_perf_teardown (perf_test_t *test)
    parallel_single_perf_test_t *parallel_single_test =
       (parallel_single_perf_test_t *) test;
 
-   for (i = 0; i < MONGOC_DEFAULT_MAX_POOL_SIZE; i++) {
+   perf_workers_report (test, &parallel_single_test->workers);
+   perf_workers_destroy (&parallel_single_test->workers);
+   for (i = 0; i < parallel_single_test->n_clients; i++) {
       mongoc_client_destroy (parallel_single_test->clients[i]);
    }
    bson_free (parallel_single_test->contexts);
@@ -361,31 +654,11 @@ parallel_single_perf_task (perf_test_t *test)
 {
    parallel_single_perf_test_t *parallel_single_test =
       (parallel_single_perf_test_t *) test;
-   int i;
-   int ret;
 
-   for (i = 0; i < parallel_single_test->n_threads; i++) {
-      parallel_single_thread_context_t *ctx;
-
-      ctx = &parallel_single_test->contexts[i];
-      ret = pthread_create (
-         &ctx->thread, NULL /* attr */, _parallel_single_perf_thread, ctx);
-      if (ret != 0) {
-         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
-         abort ();
-      }
-   }
-
-   for (i = 0; i < parallel_single_test->n_threads; i++) {
-      parallel_single_thread_context_t *ctx;
-
-      ctx = &parallel_single_test->contexts[i];
-      ret = pthread_join (ctx->thread, NULL /* out */);
-      if (ret != 0) {
-         MONGOC_ERROR ("Error: pthread_join returned %d", ret);
-         abort ();
-      }
-   }
+   perf_workers_run (&parallel_single_test->workers,
+                     _parallel_single_perf_thread,
+                     parallel_single_test->contexts,
+                     sizeof (parallel_single_thread_context_t));
 }
 
 static perf_test_t *
@@ -397,17 +670,7 @@ parallel_single_perf_new (const char *name, int n_threads)
    int64_t data_size;
 
    parallel_single_test->n_threads = n_threads;
-   data_size = PING_COMMAND_SIZE * OPERATION_COUNT * n_threads;
-
-   if (n_threads > MONGOC_DEFAULT_MAX_POOL_SIZE) {
-      MONGOC_ERROR ("Error: trying to start test with %d threads.", n_threads);
-      MONGOC_ERROR ("Cannot start test with n_threads > %d.",
-                    MONGOC_DEFAULT_MAX_POOL_SIZE);
-      MONGOC_ERROR ("Test has a hard-coded maximum of %d clients.",
-                    MONGOC_DEFAULT_MAX_POOL_SIZE);
-      MONGOC_ERROR ("Consider revising this test to use a larger pool size.");
-      abort ();
-   }
+   data_size = (int64_t) PING_COMMAND_SIZE * OPERATION_COUNT * n_threads;
 
    perf_test_init (test, name, NULL /* data path */, data_size);
    test->task = parallel_single_perf_task;
@@ -418,6 +681,120 @@ parallel_single_perf_new (const char *name, int n_threads)
    return test;
 }
 
+typedef struct {
+   perf_test_t base;
+   int n_processes;
+   perf_processes_t processes;
+} parallel_processes_perf_test_t;
+
+/* runs in each child: its own client, warmed up with a ping */
+static void *
+_parallel_processes_init (void *p, int index)
+{
+   parallel_single_thread_context_t *ctx;
+   mongoc_uri_t *uri;
+   bson_t *cmd;
+   bson_error_t error;
+
+   ctx = (parallel_single_thread_context_t *) bson_malloc0 (
+      sizeof (parallel_single_thread_context_t));
+   uri = perf_uri_new ();
+   ctx->client = mongoc_client_new_from_uri (uri);
+   ctx->n_operations_to_run = OPERATION_COUNT;
+
+   cmd = BCON_NEW ("ping", BCON_INT32 (1));
+   if (!mongoc_client_command_simple (ctx->client,
+                                      "db",
+                                      cmd,
+                                      NULL /* read prefs */,
+                                      NULL /* reply */,
+                                      &error)) {
+      MONGOC_ERROR ("client_command_simple error: %s", error.message);
+      abort ();
+   }
+
+   bson_destroy (cmd);
+   mongoc_uri_destroy (uri);
+
+   return ctx;
+}
+
+static void
+_parallel_processes_run (void *p)
+{
+   _parallel_single_perf_thread (p);
+}
+
+static void
+parallel_processes_perf_setup (perf_test_t *test)
+{
+   parallel_processes_perf_test_t *parallel_processes_test =
+      (parallel_processes_perf_test_t *) test;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_database_t *db;
+   bson_error_t error;
+
+   /* fork before this process opens any connection */
+   perf_processes_init (&parallel_processes_test->processes,
+                        parallel_processes_test->n_processes,
+                        _parallel_processes_init,
+                        _parallel_processes_run,
+                        NULL);
+
+   uri = perf_uri_new ();
+   client = mongoc_client_new_from_uri (uri);
+   db = mongoc_client_get_database (client, "perftest");
+   if (!mongoc_database_drop (db, &error)) {
+      MONGOC_ERROR ("database_drop: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_database_destroy (db);
+   mongoc_client_destroy (client);
+   mongoc_uri_destroy (uri);
+}
+
+static void
+parallel_processes_perf_teardown (perf_test_t *test)
+{
+   parallel_processes_perf_test_t *parallel_processes_test =
+      (parallel_processes_perf_test_t *) test;
+
+   perf_processes_report (test, &parallel_processes_test->processes);
+   perf_processes_destroy (&parallel_processes_test->processes);
+}
+
+static void
+parallel_processes_perf_task (perf_test_t *test)
+{
+   parallel_processes_perf_test_t *parallel_processes_test =
+      (parallel_processes_perf_test_t *) test;
+
+   perf_processes_run (&parallel_processes_test->processes);
+}
+
+/* like parallel_single_perf_new, with a process per client instead of a
+ * thread */
+static perf_test_t *
+parallel_processes_perf_new (const char *name, int n_processes)
+{
+   parallel_processes_perf_test_t *parallel_processes_test =
+      bson_malloc0 (sizeof (parallel_processes_perf_test_t));
+   perf_test_t *test = (perf_test_t *) parallel_processes_test;
+   int64_t data_size;
+
+   parallel_processes_test->n_processes = n_processes;
+   data_size = (int64_t) PING_COMMAND_SIZE * OPERATION_COUNT * n_processes;
+
+   perf_test_init (test, name, NULL /* data path */, data_size);
+   test->task = parallel_processes_perf_task;
+   test->setup = parallel_processes_perf_setup;
+   test->teardown = parallel_processes_perf_teardown;
+
+   return test;
+}
+
 void
 parallel_client_perf (void)
 {
@@ -432,3 +809,97 @@ parallel_client_perf (void)
 
    run_perf_tests (perf_tests);
 }
+
+/* pool tests against a replica set under each of PERF_READ_PREFS */
+void
+parallel_client_replset_perf (void)
+{
+   perf_test_t **perf_tests;
+   size_t n;
+   size_t i;
+
+   perf_tests = (perf_test_t **) bson_malloc0 (
+      (2 * PERF_N_READ_PREFS + 1) * sizeof (perf_test_t *));
+
+   n = 0;
+   for (i = 0; i < PERF_N_READ_PREFS; i++) {
+      perf_tests[n++] = parallel_pool_perf_with_read_prefs (
+         parallel_pool_perf_new ("Parallel/Pool/Threads:10", 10),
+         &PERF_READ_PREFS[i]);
+      perf_tests[n++] = parallel_pool_perf_with_read_prefs (
+         parallel_pool_perf_new ("Parallel/Pool/Threads:100", 100),
+         &PERF_READ_PREFS[i]);
+   }
+
+   run_perf_tests (perf_tests);
+
+   bson_free (perf_tests);
+}
+
+/* the cost of observability under 100-thread contention */
+void
+parallel_client_observe_perf (void)
+{
+   perf_test_t **perf_tests;
+   size_t i;
+
+   perf_tests = (perf_test_t **) bson_malloc0 (
+      (PERF_N_OBSERVE_MODES + 1) * sizeof (perf_test_t *));
+
+   for (i = 0; i < PERF_N_OBSERVE_MODES; i++) {
+      perf_tests[i] = parallel_pool_perf_with_observe (
+         parallel_pool_perf_new ("Parallel/Pool/Threads:100", 100),
+         &PERF_OBSERVE_MODES[i]);
+   }
+
+   run_perf_tests (perf_tests);
+
+   bson_free (perf_tests);
+}
+
+
+/* threads sharing pools of several sizes, including more threads than
+ * clients, each popping a client per operation */
+void
+parallel_client_pool_size_perf (void)
+{
+   const int threads[] = {16, 64, 256, 1024};
+   const int pool_sizes[] = {16, 64, 256};
+   perf_test_t *perf_tests[4 * 3 + 1];
+   size_t n;
+   size_t i;
+   size_t j;
+
+   n = 0;
+   for (i = 0; i < sizeof (threads) / sizeof (threads[0]); i++) {
+      for (j = 0; j < sizeof (pool_sizes) / sizeof (pool_sizes[0]); j++) {
+         /* threads beyond the pool size queue for a client */
+         perf_tests[n++] = parallel_pool_pop_per_op_perf_new (
+            threads[i],
+            pool_sizes[j],
+            threads[i] > pool_sizes[j] ? WAIT_QUEUE_TIMEOUT_MS : 0);
+      }
+   }
+
+   perf_tests[n] = NULL;
+
+   run_perf_tests (perf_tests);
+}
+
+
+/* each client in its own thread, then in its own process, at the same
+ * concurrency */
+void
+parallel_client_processes_perf (void)
+{
+   perf_test_t *perf_tests[] = {
+      parallel_single_perf_new ("Parallel/Single/Threads:1", 1),
+      parallel_processes_perf_new ("Parallel/Single/Processes:1", 1),
+      parallel_single_perf_new ("Parallel/Single/Threads:10", 10),
+      parallel_processes_perf_new ("Parallel/Single/Processes:10", 10),
+      parallel_single_perf_new ("Parallel/Single/Threads:100", 100),
+      parallel_processes_perf_new ("Parallel/Single/Processes:100", 100),
+      NULL};
+
+   run_perf_tests (perf_tests);
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests the cost of server selection and topology monitoring at scale:
+ * threads sharing a pool select servers from a mock replica set of many
+ * members, optionally while a member goes up and down. Needs no mongod.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+#include "mock-server.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <pthread.h>
+#include <time.h>
+
+
+/* SELECTION_COUNT is the number of selections by each thread */
+static const int SELECTION_COUNT = 10000;
+
+/* FLAP_INTERVAL_MS is how long the flapping member stays up or down. The
+ * pool's monitors check each member every HEARTBEAT_FREQUENCY_MS, the
+ * minimum libmongoc allows. */
+static const int FLAP_INTERVAL_MS = 1000;
+static const int HEARTBEAT_FREQUENCY_MS = 500;
+
+/* how long setup waits for the pool to discover every member */
+static const int64_t DISCOVERY_TIMEOUT_USEC = 10 * 1000 * 1000;
+
+typedef struct {
+   mongoc_client_t *client;
+   const mongoc_read_prefs_t *read_prefs;
+   perf_latencies_t latencies;
+} select_thread_context_t;
+
+typedef struct {
+   perf_test_t base;
+   int n_members;
+   int n_threads;
+   /* take the last member up and down while the test runs */
+   bool flap;
+   mock_server_t *server;
+   mongoc_client_pool_t *pool;
+   mongoc_read_prefs_t *read_prefs;
+   select_thread_context_t *contexts;
+   perf_workers_t workers;
+   pthread_t flap_thread;
+   pthread_mutex_t flap_mutex;
+   pthread_cond_t flap_cond;
+   bool flap_stop;
+   perf_latencies_t latencies;
+   char name[128];
+} select_test_t;
+
+static int
+_known_members (mongoc_client_t *client)
+{
+   mongoc_server_description_t **sds;
+   size_t n;
+   size_t i;
+   int known;
+
+   sds = mongoc_client_get_server_descriptions (client, &n);
+   known = 0;
+   for (i = 0; i < n; i++) {
+      if (strcmp (mongoc_server_description_type (sds[i]), "Unknown") != 0) {
+         known++;
+      }
+   }
+
+   mongoc_server_descriptions_destroy_all (sds, n);
+
+   return known;
+}
+
+static void *
+_flap_thread (void *p)
+{
+   select_test_t *select_test;
+   struct timespec deadline;
+   bool down;
+
+   select_test = (select_test_t *) p;
+   down = false;
+
+   pthread_mutex_lock (&select_test->flap_mutex);
+
+   while (!select_test->flap_stop) {
+      clock_gettime (CLOCK_REALTIME, &deadline);
+      deadline.tv_sec += FLAP_INTERVAL_MS / 1000;
+      deadline.tv_nsec += (FLAP_INTERVAL_MS % 1000) * 1000 * 1000;
+      if (deadline.tv_nsec >= 1000 * 1000 * 1000) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000 * 1000 * 1000;
+      }
+
+      pthread_cond_timedwait (
+         &select_test->flap_cond, &select_test->flap_mutex, &deadline);
+
+      if (!select_test->flap_stop) {
+         down = !down;
+         mock_server_set_down (
+            select_test->server, select_test->n_members - 1, down);
+      }
+   }
+
+   pthread_mutex_unlock (&select_test->flap_mutex);
+
+   mock_server_set_down (
+      select_test->server, select_test->n_members - 1, false);
+
+   return NULL;
+}
+
+static void
+select_setup (perf_test_t *test)
+{
+   select_test_t *select_test;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   bson_error_t error;
+   char *uri_str;
+   int64_t deadline;
+   int i;
+   int ret;
+
+   perf_test_setup (test);
+
+   select_test = (select_test_t *) test;
+   select_test->server = mock_server_new (select_test->n_members);
+   uri_str = mock_server_uri (select_test->server);
+   uri = mongoc_uri_new_with_error (uri_str, &error);
+   if (!uri) {
+      MONGOC_ERROR ("invalid mock server URI: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_uri_set_option_as_int32 (
+      uri, MONGOC_URI_HEARTBEATFREQUENCYMS, HEARTBEAT_FREQUENCY_MS);
+   select_test->pool = mongoc_client_pool_new (uri);
+   select_test->read_prefs = mongoc_read_prefs_new (MONGOC_READ_NEAREST);
+   perf_latencies_init (&select_test->latencies);
+
+   select_test->contexts = (select_thread_context_t *) bson_malloc0 (
+      select_test->n_threads * sizeof (select_thread_context_t));
+   for (i = 0; i < select_test->n_threads; i++) {
+      select_test->contexts[i].client =
+         mongoc_client_pool_pop (select_test->pool);
+      select_test->contexts[i].read_prefs = select_test->read_prefs;
+      perf_latencies_init (&select_test->contexts[i].latencies);
+   }
+
+   /* start with the whole topology discovered */
+   client = select_test->contexts[0].client;
+   deadline = bson_get_monotonic_time () + DISCOVERY_TIMEOUT_USEC;
+   while (_known_members (client) < select_test->n_members) {
+      if (bson_get_monotonic_time () > deadline) {
+         MONGOC_ERROR ("discovered %d of %d mock members\n",
+                       _known_members (client),
+                       select_test->n_members);
+         abort ();
+      }
+
+      mongoc_server_description_destroy (mongoc_client_select_server (
+         client, false /* for writes */, select_test->read_prefs, NULL));
+      bson_usleep (10 * 1000);
+   }
+
+   perf_workers_init (&select_test->workers, select_test->n_threads);
+
+   if (select_test->flap) {
+      select_test->flap_stop = false;
+      pthread_mutex_init (&select_test->flap_mutex, NULL);
+      pthread_cond_init (&select_test->flap_cond, NULL);
+      ret = pthread_create (
+         &select_test->flap_thread, NULL /* attr */, _flap_thread, test);
+      if (ret != 0) {
+         MONGOC_ERROR ("Error: pthread_create returned %d", ret);
+         abort ();
+      }
+   }
+
+   mongoc_uri_destroy (uri);
+   bson_free (uri_str);
+}
+
+static void *
+_select_thread (void *p)
+{
+   select_thread_context_t *ctx;
+   mongoc_server_description_t *sd;
+   bson_error_t error;
+   int64_t start;
+   int i;
+
+   ctx = (select_thread_context_t *) p;
+
+   for (i = 0; i < SELECTION_COUNT; i++) {
+      start = bson_get_monotonic_time ();
+      sd = mongoc_client_select_server (
+         ctx->client, false /* for writes */, ctx->read_prefs, &error);
+      if (!sd) {
+         MONGOC_ERROR ("select_server: %s\n", error.message);
+         abort ();
+      }
+
+      perf_latencies_add (&ctx->latencies, bson_get_monotonic_time () - start);
+      mongoc_server_description_destroy (sd);
+   }
+
+   return NULL;
+}
+
+static void
+select_task (perf_test_t *test)
+{
+   select_test_t *select_test;
+
+   select_test = (select_test_t *) test;
+   perf_workers_run (&select_test->workers,
+                     _select_thread,
+                     select_test->contexts,
+                     sizeof (select_thread_context_t));
+}
+
+static void
+select_after (perf_test_t *test)
+{
+   select_test_t *select_test;
+   int i;
+
+   select_test = (select_test_t *) test;
+   for (i = 0; i < select_test->n_threads; i++) {
+      perf_latencies_merge (&select_test->latencies,
+                            &select_test->contexts[i].latencies);
+      select_test->contexts[i].latencies.n = 0;
+   }
+
+   perf_test_after (test);
+}
+
+static void
+select_teardown (perf_test_t *test)
+{
+   select_test_t *select_test;
+   int i;
+
+   select_test = (select_test_t *) test;
+
+   if (select_test->flap) {
+      pthread_mutex_lock (&select_test->flap_mutex);
+      select_test->flap_stop = true;
+      pthread_cond_signal (&select_test->flap_cond);
+      pthread_mutex_unlock (&select_test->flap_mutex);
+      pthread_join (select_test->flap_thread, NULL);
+      pthread_mutex_destroy (&select_test->flap_mutex);
+      pthread_cond_destroy (&select_test->flap_cond);
+   }
+
+   perf_workers_report (test, &select_test->workers);
+   perf_workers_destroy (&select_test->workers);
+
+   for (i = 0; i < select_test->n_threads; i++) {
+      mongoc_client_pool_push (select_test->pool,
+                               select_test->contexts[i].client);
+      perf_latencies_destroy (&select_test->contexts[i].latencies);
+   }
+
+   perf_latencies_report (test, NULL, &select_test->latencies);
+   perf_latencies_destroy (&select_test->latencies);
+   mongoc_client_pool_destroy (select_test->pool);
+   mongoc_read_prefs_destroy (select_test->read_prefs);
+   mock_server_destroy (select_test->server);
+   bson_free (select_test->contexts);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+select_perf_new (int n_members, int n_threads, bool flap)
+{
+   select_test_t *select_test;
+   perf_test_t *test;
+
+   select_test = (select_test_t *) bson_malloc0 (sizeof (select_test_t));
+   test = (perf_test_t *) select_test;
+   select_test->n_members = n_members;
+   select_test->n_threads = n_threads;
+   select_test->flap = flap;
+   bson_snprintf (select_test->name,
+                  sizeof (select_test->name),
+                  "TestSelectServer/Members:%d/Threads:%d%s",
+                  n_members,
+                  n_threads,
+                  flap ? "/Flapping" : "");
+
+   /* ops_per_sec is selections per second */
+   perf_test_init (test,
+                   select_test->name,
+                   NULL /* data path */,
+                   (int64_t) SELECTION_COUNT * n_threads);
+   test->setup = select_setup;
+   test->task = select_task;
+   test->after = select_after;
+   test->teardown = select_teardown;
+
+   return test;
+}
+
+void
+server_selection_perf (void)
+{
+   const int members[] = {3, 10, 40};
+   const int threads[] = {1, 10, 100};
+   perf_test_t *tests[3 * 3 + 3 + 1];
+   size_t n;
+   size_t i;
+   size_t j;
+
+   n = 0;
+   for (i = 0; i < sizeof (members) / sizeof (members[0]); i++) {
+      for (j = 0; j < sizeof (threads) / sizeof (threads[0]); j++) {
+         tests[n++] = select_perf_new (members[i], threads[j], false);
+      }
+   }
+
+   /* a member of a 10-member set going up and down */
+   for (j = 0; j < sizeof (threads) / sizeof (threads[0]); j++) {
+      tests[n++] = select_perf_new (10, threads[j], true);
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __linux__
+/* for pthread_setaffinity_np, sched_getaffinity and sched_getcpu */
+#define _GNU_SOURCE
+#endif
+
+#include "thread-placement.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+typedef struct {
+   int cpu;
+   int package;
+   int core;
+   /* the core's rank in its package, and this CPU's rank among the core's
+    * SMT siblings */
+   int core_rank;
+   int smt_rank;
+} perf_cpu_t;
+
+static const char *PLACEMENT_NAMES[] = {
+   "none",
+   "compact",
+   "scatter",
+   "core",
+   "smt",
+};
+
+static perf_placement_t g_placement = PERF_PLACEMENT_NONE;
+static perf_cpu_t *g_cpus;
+static int g_n_cpus;
+
+bool
+perf_placement_parse (const char *name, perf_placement_t *placement)
+{
+   size_t i;
+
+   for (i = 0; i < sizeof (PLACEMENT_NAMES) / sizeof (PLACEMENT_NAMES[0]);
+        i++) {
+      if (!strcmp (name, PLACEMENT_NAMES[i])) {
+         *placement = (perf_placement_t) i;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+const char *
+perf_placement_name (perf_placement_t placement)
+{
+   return PLACEMENT_NAMES[placement];
+}
+
+perf_placement_t
+perf_placement (void)
+{
+   return g_placement;
+}
+
+#ifdef __linux__
+
+static int
+_read_topology (int cpu, const char *name)
+{
+   char path[256];
+   FILE *fp;
+   int value;
+
+   bson_snprintf (path,
+                  sizeof (path),
+                  "/sys/devices/system/cpu/cpu%d/topology/%s",
+                  cpu,
+                  name);
+   fp = fopen (path, "r");
+   if (!fp) {
+      perror (path);
+      abort ();
+   }
+
+   if (fscanf (fp, "%d", &value) != 1) {
+      MONGOC_ERROR ("can't parse %s\n", path);
+      abort ();
+   }
+
+   fclose (fp);
+
+   return value;
+}
+
+static int
+_cmp_compact (const void *a, const void *b)
+{
+   const perf_cpu_t *x = (const perf_cpu_t *) a;
+   const perf_cpu_t *y = (const perf_cpu_t *) b;
+
+   if (x->package != y->package) {
+      return x->package - y->package;
+   }
+
+   if (x->smt_rank != y->smt_rank) {
+      return x->smt_rank - y->smt_rank;
+   }
+
+   return x->core_rank - y->core_rank;
+}
+
+static int
+_cmp_scatter (const void *a, const void *b)
+{
+   const perf_cpu_t *x = (const perf_cpu_t *) a;
+   const perf_cpu_t *y = (const perf_cpu_t *) b;
+
+   if (x->smt_rank != y->smt_rank) {
+      return x->smt_rank - y->smt_rank;
+   }
+
+   if (x->core_rank != y->core_rank) {
+      return x->core_rank - y->core_rank;
+   }
+
+   return x->package - y->package;
+}
+
+static int
+_cmp_smt (const void *a, const void *b)
+{
+   const perf_cpu_t *x = (const perf_cpu_t *) a;
+   const perf_cpu_t *y = (const perf_cpu_t *) b;
+
+   if (x->package != y->package) {
+      return x->package - y->package;
+   }
+
+   if (x->core_rank != y->core_rank) {
+      return x->core_rank - y->core_rank;
+   }
+
+   return x->smt_rank - y->smt_rank;
+}
+
+void
+perf_placement_init (perf_placement_t placement)
+{
+   cpu_set_t allowed;
+   perf_cpu_t *cpu;
+   int i;
+   int j;
+   int n;
+
+   g_placement = placement;
+   if (placement == PERF_PLACEMENT_NONE) {
+      return;
+   }
+
+   /* only the CPUs this process may run on, e.g. under taskset */
+   if (sched_getaffinity (0, sizeof (allowed), &allowed) != 0) {
+      perror ("sched_getaffinity");
+      abort ();
+   }
+
+   g_cpus = (perf_cpu_t *) bson_malloc0 (CPU_SETSIZE * sizeof (perf_cpu_t));
+   g_n_cpus = 0;
+   for (i = 0; i < CPU_SETSIZE; i++) {
+      if (CPU_ISSET (i, &allowed)) {
+         cpu = &g_cpus[g_n_cpus++];
+         cpu->cpu = i;
+         cpu->package = _read_topology (i, "physical_package_id");
+         cpu->core = _read_topology (i, "core_id");
+      }
+   }
+
+   for (i = 0; i < g_n_cpus; i++) {
+      cpu = &g_cpus[i];
+      for (j = 0; j < i; j++) {
+         if (g_cpus[j].package == cpu->package &&
+             g_cpus[j].core == cpu->core) {
+            cpu->smt_rank++;
+         }
+      }
+   }
+
+   /* rank the distinct cores of each package by core id */
+   for (i = 0; i < g_n_cpus; i++) {
+      cpu = &g_cpus[i];
+      for (j = 0; j < g_n_cpus; j++) {
+         if (g_cpus[j].smt_rank == 0 && g_cpus[j].package == cpu->package &&
+             g_cpus[j].core < cpu->core) {
+            cpu->core_rank++;
+         }
+      }
+   }
+
+   switch (placement) {
+   case PERF_PLACEMENT_COMPACT:
+      qsort (g_cpus, g_n_cpus, sizeof (perf_cpu_t), _cmp_compact);
+      break;
+   case PERF_PLACEMENT_SCATTER:
+      qsort (g_cpus, g_n_cpus, sizeof (perf_cpu_t), _cmp_scatter);
+      break;
+   case PERF_PLACEMENT_CORE:
+      /* the first SMT sibling of each core */
+      qsort (g_cpus, g_n_cpus, sizeof (perf_cpu_t), _cmp_smt);
+      n = 0;
+      for (i = 0; i < g_n_cpus; i++) {
+         if (g_cpus[i].smt_rank == 0) {
+            g_cpus[n++] = g_cpus[i];
+         }
+      }
+
+      g_n_cpus = n;
+      break;
+   case PERF_PLACEMENT_SMT:
+      qsort (g_cpus, g_n_cpus, sizeof (perf_cpu_t), _cmp_smt);
+      break;
+   case PERF_PLACEMENT_NONE:
+   default:
+      abort ();
+   }
+}
+
+void
+perf_placement_pin (int index)
+{
+   cpu_set_t set;
+   int ret;
+
+   if (g_placement == PERF_PLACEMENT_NONE) {
+      return;
+   }
+
+   CPU_ZERO (&set);
+   CPU_SET (g_cpus[index % g_n_cpus].cpu, &set);
+   ret = pthread_setaffinity_np (pthread_self (), sizeof (set), &set);
+   if (ret != 0) {
+      MONGOC_ERROR ("pthread_setaffinity_np returned %d\n", ret);
+      abort ();
+   }
+}
+
+int
+perf_placement_current_cpu (void)
+{
+   return sched_getcpu ();
+}
+
+#else
+
+void
+perf_placement_init (perf_placement_t placement)
+{
+   g_placement = placement;
+   if (placement != PERF_PLACEMENT_NONE) {
+      MONGOC_ERROR ("--placement is only supported on Linux\n");
+      abort ();
+   }
+}
+
+void
+perf_placement_pin (int index)
+{
+}
+
+int
+perf_placement_current_cpu (void)
+{
+   return -1;
+}
+
+#endif
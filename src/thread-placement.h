@@ -0,0 +1,57 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONGO_C_PERFORMANCE_THREAD_PLACEMENT_H
+#define MONGO_C_PERFORMANCE_THREAD_PLACEMENT_H
+
+#include <bson/bson.h>
+
+/* Where perf_workers_t pins its threads, from the CPU topology in
+ * /sys/devices/system/cpu. Worker i gets the i-th CPU of the policy's order,
+ * wrapping around when there are more workers than CPUs:
+ *
+ * compact: every physical core of the first socket, then their SMT siblings,
+ *          then the next socket.
+ * scatter: round-robin across sockets, one thread per core before siblings.
+ * core:    one thread per physical core, never on a sibling.
+ * smt:     SMT siblings of a core next to each other, core after core.
+ *
+ * Only supported on Linux. */
+typedef enum {
+   PERF_PLACEMENT_NONE,
+   PERF_PLACEMENT_COMPACT,
+   PERF_PLACEMENT_SCATTER,
+   PERF_PLACEMENT_CORE,
+   PERF_PLACEMENT_SMT,
+} perf_placement_t;
+
+bool
+perf_placement_parse (const char *name, perf_placement_t *placement);
+const char *
+perf_placement_name (perf_placement_t placement);
+/* read the topology and choose the policy's CPU order */
+void
+perf_placement_init (perf_placement_t placement);
+perf_placement_t
+perf_placement (void);
+/* pin the calling thread to worker index's CPU, if there is a policy */
+void
+perf_placement_pin (int index);
+/* the CPU the calling thread is running on, or -1 if unknown */
+int
+perf_placement_current_cpu (void);
+
+#endif // MONGO_C_PERFORMANCE_THREAD_PLACEMENT_H
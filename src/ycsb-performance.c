@@ -0,0 +1,761 @@
+/*
+ * Copyright 2026-present MongoDB, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Tests a client pool under the mixed traffic of the YCSB core workloads A-F
+ * (https://github.com/brianfrankcooper/YCSB/wiki/Core-Workloads): threads
+ * sharing a pool read, update, insert, scan and read-modify-write records of
+ * a "usertable" collection, choosing keys from a uniform, scrambled Zipfian
+ * or latest distribution as YCSB does.
+ * The task definitions are not part of the "MongoDB Driver Performance
+ * Benchmarking" specification. */
+
+#include "mongo-c-performance.h"
+
+#include <bson/bson.h>
+#include <mongoc/mongoc.h>
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+
+/* RECORD_COUNT records of FIELD_COUNT fields of FIELD_LENGTH bytes are loaded
+ * in setup, YCSB's defaults */
+static const int64_t RECORD_COUNT = 10000;
+static const int FIELD_COUNT = 10;
+#define FIELD_LENGTH 100
+
+/* OPERATION_COUNT is the number of operations per iteration, divided among
+ * the threads */
+static const int OPERATION_COUNT = 10000;
+
+/* scans read between 1 and MAX_SCAN_LENGTH records */
+static const int MAX_SCAN_LENGTH = 100;
+
+/* YCSB's Zipfian constant, and the item count and zeta of its scrambled
+ * Zipfian generator, which hashes a value from a much larger key space */
+static const double ZIPFIAN_CONSTANT = 0.99;
+static const int64_t SCRAMBLED_ITEM_COUNT = 10000000000LL;
+static const double SCRAMBLED_ZETAN = 26.46902820178302;
+
+typedef enum {
+   YCSB_READ,
+   YCSB_UPDATE,
+   YCSB_INSERT,
+   YCSB_SCAN,
+   YCSB_READ_MODIFY_WRITE,
+   YCSB_N_OPS,
+} ycsb_op_t;
+
+static const char *YCSB_OP_NAMES[] = {
+   "read",
+   "update",
+   "insert",
+   "scan",
+   "read_modify_write",
+};
+
+typedef enum {
+   YCSB_UNIFORM,
+   YCSB_ZIPFIAN,
+   YCSB_LATEST,
+} ycsb_distribution_t;
+
+static const char *YCSB_DISTRIBUTION_NAMES[] = {
+   "Uniform",
+   "Zipfian",
+   "Latest",
+};
+
+typedef struct {
+   const char *name;
+   /* the percentage of operations of each ycsb_op_t */
+   int proportions[YCSB_N_OPS];
+   ycsb_distribution_t distribution;
+} ycsb_workload_t;
+
+static const ycsb_workload_t YCSB_WORKLOADS[] = {
+   /* update heavy */
+   {"A", {50, 50, 0, 0, 0}, YCSB_ZIPFIAN},
+   /* read mostly */
+   {"B", {95, 5, 0, 0, 0}, YCSB_ZIPFIAN},
+   /* read only */
+   {"C", {100, 0, 0, 0, 0}, YCSB_ZIPFIAN},
+   /* read latest */
+   {"D", {95, 0, 5, 0, 0}, YCSB_LATEST},
+   /* short ranges */
+   {"E", {0, 0, 5, 95, 0}, YCSB_ZIPFIAN},
+   /* read-modify-write */
+   {"F", {50, 0, 0, 0, 50}, YCSB_ZIPFIAN},
+};
+
+/* YCSB's ZipfianGenerator, after "Quickly Generating Billion-Record
+ * Synthetic Databases", Gray et al, SIGMOD 1994 */
+typedef struct {
+   int64_t items;
+   double alpha;
+   double zetan;
+   double eta;
+   double zeta2theta;
+} ycsb_zipfian_t;
+
+struct _ycsb_test_t;
+
+typedef struct {
+   struct _ycsb_test_t *test;
+   mongoc_client_t *client;
+   mongoc_collection_t *collection;
+   int n_operations_to_run;
+   uint64_t rng;
+   /* with YCSB_LATEST, over the records inserted so far */
+   ycsb_zipfian_t latest;
+   char value[FIELD_LENGTH + 1];
+   int64_t counts[YCSB_N_OPS];
+   perf_latencies_t latencies[YCSB_N_OPS];
+} ycsb_thread_context_t;
+
+typedef struct _ycsb_test_t {
+   perf_test_t base;
+   const ycsb_workload_t *workload;
+   ycsb_distribution_t distribution;
+   int n_threads;
+   mongoc_client_pool_t *pool;
+   ycsb_thread_context_t *contexts;
+   perf_workers_t workers;
+   ycsb_zipfian_t scrambled;
+   /* records loaded or inserted, the next insert's key number */
+   _Atomic (int64_t) n_records;
+   int64_t task_usec;
+   int64_t counts[YCSB_N_OPS];
+   perf_latencies_t latencies[YCSB_N_OPS];
+   char name[128];
+} ycsb_test_t;
+
+/* xorshift64*, each thread has its own state */
+static uint64_t
+_rand (uint64_t *state)
+{
+   uint64_t x;
+
+   x = *state;
+   x ^= x >> 12;
+   x ^= x << 25;
+   x ^= x >> 27;
+   *state = x;
+
+   return x * 0x2545F4914F6CDD1DULL;
+}
+
+/* a double in [0, 1) */
+static double
+_rand_double (uint64_t *state)
+{
+   return (double) (_rand (state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t
+_fnv_hash64 (uint64_t value)
+{
+   uint64_t hash;
+   int i;
+
+   hash = 0xCBF29CE484222325ULL;
+   for (i = 0; i < 8; i++) {
+      hash ^= value & 0xff;
+      hash *= 1099511628211ULL;
+      value >>= 8;
+   }
+
+   return hash;
+}
+
+/* the sum of 1 / (i + 1) ^ theta for i from start to n - 1, plus sum */
+static double
+_zeta (int64_t start, int64_t n, double sum)
+{
+   int64_t i;
+
+   for (i = start; i < n; i++) {
+      sum += 1.0 / pow ((double) (i + 1), ZIPFIAN_CONSTANT);
+   }
+
+   return sum;
+}
+
+static void
+_zipfian_set_eta (ycsb_zipfian_t *zipfian)
+{
+   zipfian->eta =
+      (1.0 - pow (2.0 / (double) zipfian->items, 1.0 - ZIPFIAN_CONSTANT)) /
+      (1.0 - zipfian->zeta2theta / zipfian->zetan);
+}
+
+static void
+_zipfian_init (ycsb_zipfian_t *zipfian, int64_t items, double zetan)
+{
+   zipfian->items = items;
+   zipfian->alpha = 1.0 / (1.0 - ZIPFIAN_CONSTANT);
+   zipfian->zetan = zetan;
+   zipfian->zeta2theta = _zeta (0, 2, 0.0);
+   _zipfian_set_eta (zipfian);
+}
+
+/* a value in [0, items), 0 the most popular. Extends zeta when the item
+ * count has grown, like YCSB does for the latest distribution. */
+static int64_t
+_zipfian_next (ycsb_zipfian_t *zipfian, uint64_t *rng, int64_t items)
+{
+   double u;
+   double uz;
+   int64_t value;
+
+   if (items > zipfian->items) {
+      zipfian->zetan = _zeta (zipfian->items, items, zipfian->zetan);
+      zipfian->items = items;
+      _zipfian_set_eta (zipfian);
+   }
+
+   u = _rand_double (rng);
+   uz = u * zipfian->zetan;
+   if (uz < 1.0) {
+      return 0;
+   }
+
+   if (uz < 1.0 + pow (0.5, ZIPFIAN_CONSTANT)) {
+      return 1;
+   }
+
+   value = (int64_t) ((double) zipfian->items *
+                      pow (zipfian->eta * u - zipfian->eta + 1.0,
+                           zipfian->alpha));
+
+   return BSON_MIN (value, zipfian->items - 1);
+}
+
+/* YCSB inserts keys in hashed order, so a record's key is "user" followed by
+ * the hash of its key number */
+static void
+_key (int64_t keynum, char *key, size_t key_sz)
+{
+   bson_snprintf (
+      key, key_sz, "user%" PRIu64, _fnv_hash64 ((uint64_t) keynum));
+}
+
+static void
+_random_value (uint64_t *rng, char *value)
+{
+   int i;
+
+   for (i = 0; i < FIELD_LENGTH; i++) {
+      value[i] = (char) ('a' + _rand (rng) % 26);
+   }
+
+   value[FIELD_LENGTH] = '\0';
+}
+
+static void
+_record (bson_t *doc, const char *key, uint64_t *rng, char *value)
+{
+   char field[16];
+   int i;
+
+   BSON_APPEND_UTF8 (doc, "_id", key);
+   for (i = 0; i < FIELD_COUNT; i++) {
+      bson_snprintf (field, sizeof (field), "field%d", i);
+      _random_value (rng, value);
+      BSON_APPEND_UTF8 (doc, field, value);
+   }
+}
+
+/* the key number of an existing record to read, update or scan from */
+static int64_t
+_choose_keynum (ycsb_thread_context_t *ctx)
+{
+   int64_t n;
+   int64_t keynum;
+
+   n = atomic_load (&ctx->test->n_records);
+
+   switch (ctx->test->distribution) {
+   case YCSB_UNIFORM:
+      return (int64_t) (_rand (&ctx->rng) % (uint64_t) n);
+   case YCSB_ZIPFIAN:
+      keynum = _zipfian_next (
+         &ctx->test->scrambled, &ctx->rng, SCRAMBLED_ITEM_COUNT);
+      return (int64_t) (_fnv_hash64 ((uint64_t) keynum) % (uint64_t) n);
+   case YCSB_LATEST:
+      return n - 1 - _zipfian_next (&ctx->latest, &ctx->rng, n);
+   default:
+      abort ();
+   }
+}
+
+static ycsb_op_t
+_choose_op (ycsb_thread_context_t *ctx)
+{
+   int r;
+   int op;
+
+   r = (int) (_rand (&ctx->rng) % 100);
+   for (op = 0; op < YCSB_N_OPS - 1; op++) {
+      r -= ctx->test->workload->proportions[op];
+      if (r < 0) {
+         break;
+      }
+   }
+
+   return (ycsb_op_t) op;
+}
+
+static void
+_ycsb_read (ycsb_thread_context_t *ctx, const char *key)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_t filter;
+   bson_t *opts;
+   bson_error_t error;
+
+   bson_init (&filter);
+   BSON_APPEND_UTF8 (&filter, "_id", key);
+   opts = BCON_NEW ("limit", BCON_INT64 (1));
+   cursor = mongoc_collection_find_with_opts (
+      ctx->collection, &filter, opts, NULL /* read prefs */);
+
+   /* a concurrent insert's key may not be readable yet */
+   while (mongoc_cursor_next (cursor, &doc)) {
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      MONGOC_ERROR ("read: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_cursor_destroy (cursor);
+   bson_destroy (opts);
+   bson_destroy (&filter);
+}
+
+static void
+_ycsb_update (ycsb_thread_context_t *ctx, const char *key)
+{
+   char field[16];
+   bson_t filter;
+   bson_t *update;
+   bson_error_t error;
+
+   bson_init (&filter);
+   BSON_APPEND_UTF8 (&filter, "_id", key);
+   bson_snprintf (field,
+                  sizeof (field),
+                  "field%d",
+                  (int) (_rand (&ctx->rng) % (uint64_t) FIELD_COUNT));
+   _random_value (&ctx->rng, ctx->value);
+   update = BCON_NEW ("$set", "{", field, BCON_UTF8 (ctx->value), "}");
+
+   if (!mongoc_collection_update_one (ctx->collection,
+                                      &filter,
+                                      update,
+                                      NULL /* opts */,
+                                      NULL /* reply */,
+                                      &error)) {
+      MONGOC_ERROR ("update: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (update);
+   bson_destroy (&filter);
+}
+
+static void
+_ycsb_insert (ycsb_thread_context_t *ctx)
+{
+   char key[32];
+   int64_t keynum;
+   bson_t doc;
+   bson_error_t error;
+
+   keynum = atomic_fetch_add (&ctx->test->n_records, 1);
+
+   _key (keynum, key, sizeof (key));
+   bson_init (&doc);
+   _record (&doc, key, &ctx->rng, ctx->value);
+
+   if (!mongoc_collection_insert_one (
+          ctx->collection, &doc, NULL /* opts */, NULL /* reply */, &error)) {
+      MONGOC_ERROR ("insert: %s\n", error.message);
+      abort ();
+   }
+
+   bson_destroy (&doc);
+}
+
+static void
+_ycsb_scan (ycsb_thread_context_t *ctx, const char *key)
+{
+   mongoc_cursor_t *cursor;
+   const bson_t *doc;
+   bson_t *filter;
+   bson_t *opts;
+   bson_error_t error;
+   int64_t length;
+
+   length = 1 + (int64_t) (_rand (&ctx->rng) % (uint64_t) MAX_SCAN_LENGTH);
+   filter = BCON_NEW ("_id", "{", "$gte", BCON_UTF8 (key), "}");
+   opts = BCON_NEW (
+      "sort", "{", "_id", BCON_INT32 (1), "}", "limit", BCON_INT64 (length));
+   cursor = mongoc_collection_find_with_opts (
+      ctx->collection, filter, opts, NULL /* read prefs */);
+
+   while (mongoc_cursor_next (cursor, &doc)) {
+   }
+
+   if (mongoc_cursor_error (cursor, &error)) {
+      MONGOC_ERROR ("scan: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_cursor_destroy (cursor);
+   bson_destroy (opts);
+   bson_destroy (filter);
+}
+
+static void *
+_ycsb_thread (void *p)
+{
+   ycsb_thread_context_t *ctx;
+   ycsb_op_t op;
+   char key[32];
+   int64_t start;
+   int i;
+
+   ctx = (ycsb_thread_context_t *) p;
+
+   for (i = 0; i < ctx->n_operations_to_run; i++) {
+      op = _choose_op (ctx);
+      if (op != YCSB_INSERT) {
+         _key (_choose_keynum (ctx), key, sizeof (key));
+      }
+
+      start = bson_get_monotonic_time ();
+
+      switch (op) {
+      case YCSB_READ:
+         _ycsb_read (ctx, key);
+         break;
+      case YCSB_UPDATE:
+         _ycsb_update (ctx, key);
+         break;
+      case YCSB_INSERT:
+         _ycsb_insert (ctx);
+         break;
+      case YCSB_SCAN:
+         _ycsb_scan (ctx, key);
+         break;
+      case YCSB_READ_MODIFY_WRITE:
+         _ycsb_read (ctx, key);
+         _ycsb_update (ctx, key);
+         break;
+      case YCSB_N_OPS:
+      default:
+         abort ();
+      }
+
+      perf_latencies_add (&ctx->latencies[op],
+                          bson_get_monotonic_time () - start);
+      ctx->counts[op]++;
+   }
+
+   return NULL;
+}
+
+/* load RECORD_COUNT records, the load phase of a YCSB run */
+static void
+_ycsb_load (ycsb_test_t *ycsb_test, mongoc_client_t *client)
+{
+   mongoc_collection_t *collection;
+   mongoc_bulk_operation_t *bulk;
+   char key[32];
+   char value[FIELD_LENGTH + 1];
+   uint64_t rng;
+   bson_t doc;
+   bson_error_t error;
+   int64_t i;
+
+   collection = mongoc_client_get_collection (client, "perftest", "usertable");
+   bulk = mongoc_collection_create_bulk_operation_with_opts (collection, NULL);
+   rng = 0x9E3779B97F4A7C15ULL;
+
+   for (i = 0; i < RECORD_COUNT; i++) {
+      _key (i, key, sizeof (key));
+      bson_init (&doc);
+      _record (&doc, key, &rng, value);
+      mongoc_bulk_operation_insert (bulk, &doc);
+      bson_destroy (&doc);
+   }
+
+   if (!mongoc_bulk_operation_execute (bulk, NULL, &error)) {
+      MONGOC_ERROR ("load: %s\n", error.message);
+      abort ();
+   }
+
+   atomic_store (&ycsb_test->n_records, RECORD_COUNT);
+
+   mongoc_bulk_operation_destroy (bulk);
+   mongoc_collection_destroy (collection);
+}
+
+static void
+ycsb_setup (perf_test_t *test)
+{
+   ycsb_test_t *ycsb_test;
+   ycsb_thread_context_t *ctx;
+   mongoc_uri_t *uri;
+   mongoc_client_t *client;
+   mongoc_database_t *db;
+   bson_t *cmd;
+   bson_error_t error;
+   double latest_zetan;
+   int i;
+   int op;
+
+   perf_test_setup (test);
+
+   ycsb_test = (ycsb_test_t *) test;
+   uri = perf_uri_new ();
+   ycsb_test->pool = mongoc_client_pool_new (uri);
+
+   client = mongoc_client_pool_pop (ycsb_test->pool);
+   db = mongoc_client_get_database (client, "perftest");
+   if (!mongoc_database_drop (db, &error)) {
+      MONGOC_ERROR ("database_drop: %s\n", error.message);
+      abort ();
+   }
+
+   mongoc_database_destroy (db);
+   _ycsb_load (ycsb_test, client);
+   mongoc_client_pool_push (ycsb_test->pool, client);
+
+   _zipfian_init (
+      &ycsb_test->scrambled, SCRAMBLED_ITEM_COUNT, SCRAMBLED_ZETAN);
+   latest_zetan = _zeta (0, RECORD_COUNT, 0.0);
+
+   ycsb_test->contexts = (ycsb_thread_context_t *) bson_malloc0 (
+      ycsb_test->n_threads * sizeof (ycsb_thread_context_t));
+
+   /* Warm up a connection per thread by popping all clients and sending one
+    * ping. */
+   cmd = BCON_NEW ("ping", BCON_INT32 (1));
+   for (i = 0; i < ycsb_test->n_threads; i++) {
+      ctx = &ycsb_test->contexts[i];
+      ctx->test = ycsb_test;
+      ctx->rng = _fnv_hash64 ((uint64_t) i + 1);
+      _zipfian_init (&ctx->latest, RECORD_COUNT, latest_zetan);
+      for (op = 0; op < YCSB_N_OPS; op++) {
+         perf_latencies_init (&ctx->latencies[op]);
+      }
+
+      ctx->client = mongoc_client_pool_pop (ycsb_test->pool);
+      if (!mongoc_client_command_simple (ctx->client,
+                                         "db",
+                                         cmd,
+                                         NULL /* read prefs */,
+                                         NULL /* reply */,
+                                         &error)) {
+         MONGOC_ERROR ("client_command_simple error: %s", error.message);
+         abort ();
+      }
+   }
+
+   for (i = 0; i < ycsb_test->n_threads; i++) {
+      mongoc_client_pool_push (ycsb_test->pool, ycsb_test->contexts[i].client);
+   }
+
+   for (op = 0; op < YCSB_N_OPS; op++) {
+      perf_latencies_init (&ycsb_test->latencies[op]);
+   }
+
+   perf_workers_init (&ycsb_test->workers, ycsb_test->n_threads);
+
+   bson_destroy (cmd);
+   mongoc_uri_destroy (uri);
+}
+
+static void
+ycsb_before (perf_test_t *test)
+{
+   ycsb_test_t *ycsb_test;
+   ycsb_thread_context_t *ctx;
+   int i;
+
+   perf_test_before (test);
+
+   ycsb_test = (ycsb_test_t *) test;
+   for (i = 0; i < ycsb_test->n_threads; i++) {
+      ctx = &ycsb_test->contexts[i];
+      ctx->client = mongoc_client_pool_pop (ycsb_test->pool);
+      ctx->collection =
+         mongoc_client_get_collection (ctx->client, "perftest", "usertable");
+      ctx->n_operations_to_run = OPERATION_COUNT / ycsb_test->n_threads;
+   }
+}
+
+static void
+ycsb_task (perf_test_t *test)
+{
+   ycsb_test_t *ycsb_test;
+   int64_t start;
+
+   ycsb_test = (ycsb_test_t *) test;
+   start = bson_get_monotonic_time ();
+
+   perf_workers_run (&ycsb_test->workers,
+                     _ycsb_thread,
+                     ycsb_test->contexts,
+                     sizeof (ycsb_thread_context_t));
+
+   ycsb_test->task_usec += bson_get_monotonic_time () - start;
+}
+
+static void
+ycsb_after (perf_test_t *test)
+{
+   ycsb_test_t *ycsb_test;
+   ycsb_thread_context_t *ctx;
+   int i;
+   int op;
+
+   ycsb_test = (ycsb_test_t *) test;
+   for (i = 0; i < ycsb_test->n_threads; i++) {
+      ctx = &ycsb_test->contexts[i];
+      mongoc_collection_destroy (ctx->collection);
+      mongoc_client_pool_push (ycsb_test->pool, ctx->client);
+      for (op = 0; op < YCSB_N_OPS; op++) {
+         perf_latencies_merge (&ycsb_test->latencies[op], &ctx->latencies[op]);
+         ctx->latencies[op].n = 0;
+         ycsb_test->counts[op] += ctx->counts[op];
+         ctx->counts[op] = 0;
+      }
+   }
+
+   perf_test_after (test);
+}
+
+static void
+ycsb_teardown (perf_test_t *test)
+{
+   ycsb_test_t *ycsb_test;
+   char name[64];
+   char prefix[32];
+   int i;
+   int op;
+
+   ycsb_test = (ycsb_test_t *) test;
+   perf_workers_report (test, &ycsb_test->workers);
+   perf_workers_destroy (&ycsb_test->workers);
+
+   /* each operation type's throughput and latencies */
+   for (op = 0; op < YCSB_N_OPS; op++) {
+      if (ycsb_test->counts[op] && ycsb_test->task_usec) {
+         bson_snprintf (
+            name, sizeof (name), "%s_ops_per_sec", YCSB_OP_NAMES[op]);
+         perf_test_add_metric (test,
+                               name,
+                               (double) ycsb_test->counts[op] * 1e6 /
+                                  (double) ycsb_test->task_usec);
+      }
+
+      bson_snprintf (prefix, sizeof (prefix), "%s_", YCSB_OP_NAMES[op]);
+      perf_latencies_report (test, prefix, &ycsb_test->latencies[op]);
+      perf_latencies_destroy (&ycsb_test->latencies[op]);
+      for (i = 0; i < ycsb_test->n_threads; i++) {
+         perf_latencies_destroy (&ycsb_test->contexts[i].latencies[op]);
+      }
+   }
+
+   mongoc_client_pool_destroy (ycsb_test->pool);
+   bson_free (ycsb_test->contexts);
+
+   perf_test_teardown (test);
+}
+
+static perf_test_t *
+ycsb_perf_new (const ycsb_workload_t *workload,
+               ycsb_distribution_t distribution,
+               int n_threads)
+{
+   ycsb_test_t *ycsb_test;
+   perf_test_t *test;
+
+   ycsb_test = (ycsb_test_t *) bson_malloc0 (sizeof (ycsb_test_t));
+   test = (perf_test_t *) ycsb_test;
+   ycsb_test->workload = workload;
+   ycsb_test->distribution = distribution;
+   ycsb_test->n_threads = n_threads;
+   bson_snprintf (ycsb_test->name,
+                  sizeof (ycsb_test->name),
+                  "YCSB/Workload:%s/Distribution:%s/Threads:%d",
+                  workload->name,
+                  YCSB_DISTRIBUTION_NAMES[distribution],
+                  n_threads);
+
+   /* ops_per_sec is operations per second */
+   perf_test_init (
+      test, ycsb_test->name, NULL /* data path */, OPERATION_COUNT);
+   test->setup = ycsb_setup;
+   test->before = ycsb_before;
+   test->task = ycsb_task;
+   test->after = ycsb_after;
+   test->teardown = ycsb_teardown;
+
+   return test;
+}
+
+
+void
+ycsb_perf (void)
+{
+   const int threads[] = {1, 10, 100};
+   const size_t n_workloads =
+      sizeof (YCSB_WORKLOADS) / sizeof (YCSB_WORKLOADS[0]);
+   const size_t n_threads = sizeof (threads) / sizeof (threads[0]);
+   perf_test_t **tests;
+   size_t n;
+   size_t i;
+   size_t j;
+
+   tests = (perf_test_t **) bson_malloc0 (
+      ((n_workloads + 1) * n_threads + 1) * sizeof (perf_test_t *));
+
+   n = 0;
+   for (i = 0; i < n_workloads; i++) {
+      for (j = 0; j < n_threads; j++) {
+         tests[n++] = ycsb_perf_new (
+            &YCSB_WORKLOADS[i], YCSB_WORKLOADS[i].distribution, threads[j]);
+      }
+   }
+
+   /* workload A with uniform keys, to compare with its Zipfian hot spots */
+   for (j = 0; j < n_threads; j++) {
+      tests[n++] = ycsb_perf_new (&YCSB_WORKLOADS[0], YCSB_UNIFORM, threads[j]);
+   }
+
+   tests[n] = NULL;
+
+   run_perf_tests (tests);
+
+   bson_free (tests);
+}
@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+
+# Copyright 2026-present MongoDB, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Compare benchmark throughput over TLS and plaintext connections.
+
+Generates a self-signed CA and server certificate, starts a plaintext mongod
+and a mongod with --tlsMode requireTLS, runs the same suites against each,
+and prints TLS throughput relative to plaintext."""
+
+import argparse
+import shutil
+import subprocess
+import sys
+import tempfile
+from os.path import dirname, join, realpath
+
+from mongod_launcher import Mongod, run_benchmarks
+
+DEFAULT_SUITES = ['driver', 'parallel-client', 'connection']
+
+
+def openssl(*args):
+    subprocess.check_call(('openssl', ) + args)
+
+
+def make_certs(cert_dir):
+    """Return (CA file, server PEM file), valid for localhost."""
+    ca_key = join(cert_dir, 'ca.key')
+    ca_pem = join(cert_dir, 'ca.pem')
+    server_key = join(cert_dir, 'server.key')
+    server_csr = join(cert_dir, 'server.csr')
+    server_crt = join(cert_dir, 'server.crt')
+    server_pem = join(cert_dir, 'server.pem')
+    ext = join(cert_dir, 'server.ext')
+
+    openssl('req', '-x509', '-newkey', 'rsa:2048', '-nodes', '-days', '2',
+            '-subj', '/CN=mongo-c-performance CA',
+            '-keyout', ca_key, '-out', ca_pem)
+    openssl('req', '-newkey', 'rsa:2048', '-nodes',
+            '-subj', '/CN=localhost',
+            '-keyout', server_key, '-out', server_csr)
+    with open(ext, 'w') as f:
+        f.write('subjectAltName=DNS:localhost,IP:127.0.0.1\n')
+
+    openssl('x509', '-req', '-days', '2', '-in', server_csr,
+            '-CA', ca_pem, '-CAkey', ca_key, '-CAcreateserial',
+            '-extfile', ext, '-out', server_crt)
+    with open(server_pem, 'w') as out:
+        for path in server_crt, server_key:
+            with open(path) as f:
+                out.write(f.read())
+
+    return ca_pem, server_pem
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('test_dir', help='path to performance-testdata')
+    parser.add_argument('--binary', default='./mongo-c-performance',
+                        help='path to mongo-c-performance')
+    parser.add_argument('--mongod', default='mongod',
+                        help='path to mongod')
+    parser.add_argument('--port', type=int, default=27100,
+                        help='plaintext port, TLS uses the next one')
+    parser.add_argument('--output', default='tls-results',
+                        help='directory for the results of both runs')
+    parser.add_argument('--suite', action='append',
+                        help='suites to run, default: %s'
+                        % ', '.join(DEFAULT_SUITES))
+    parser.add_argument('--quick', action='store_true')
+    args = parser.parse_args()
+
+    suites = args.suite or DEFAULT_SUITES
+    extra_args = ['--quick'] if args.quick else []
+    cert_dir = tempfile.mkdtemp(prefix='mongo-c-performance-certs-')
+    results = []
+    try:
+        ca_pem, server_pem = make_certs(cert_dir)
+        servers = [
+            ('plaintext', [], ''),
+            ('tls',
+             ['--tlsMode', 'requireTLS',
+              '--tlsCertificateKeyFile', server_pem,
+              '--tlsCAFile', ca_pem],
+             '?tls=true&tlsCAFile=%s' % ca_pem),
+        ]
+
+        for i, (name, mongod_args, uri_options) in enumerate(servers):
+            mongod = Mongod(args.mongod, args.port + i, mongod_args)
+            try:
+                uri = 'mongodb://%s/%s' % (mongod.host, uri_options)
+                results.append(run_benchmarks(args.binary,
+                                              args.test_dir,
+                                              uri,
+                                              suites,
+                                              join(args.output, name),
+                                              extra_args))
+            finally:
+                mongod.stop()
+    finally:
+        # the certificates' private keys
+        shutil.rmtree(cert_dir, ignore_errors=True)
+
+    print('\nThroughput relative to plaintext:')
+    compare = join(dirname(realpath(__file__)), 'compare-results.py')
+    subprocess.check_call([sys.executable, compare] + results)
+
+
+if __name__ == '__main__':
+    main()